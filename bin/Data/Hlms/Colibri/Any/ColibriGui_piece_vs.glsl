@@ -10,12 +10,28 @@
 	@property( colibri_text )
 		vulkan_layout( OGRE_TANGENT ) in uint tangent;
 		vulkan_layout( OGRE_BLENDINDICES ) in uint2 blendIndices;
+		vulkan_layout( OGRE_SPECULAR ) in float4 secondary_colour;
+		vulkan_layout( OGRE_BINORMAL ) in float2 binormal;
 	@end
 @end
 
+@property( colibri_instanced )
+@piece( custom_vs_uniformDeclaration )
+	@property( !use_read_only_buffer )
+		vulkan_layout( ogre_T3 ) uniform samplerBuffer colibriInstances;
+		#define colibriInstanceFetch( idx ) bufferFetch( colibriInstances, int( idx ) )
+	@else
+		ReadOnlyBufferF( 3, float4, colibriInstances );
+		#define colibriInstanceFetch( idx ) readOnlyFetch( colibriInstances, idx )
+	@end
+@end
+@end
+
 @piece( custom_vs_preExecution )
-	@property( !colibri_text )
-		uint colibriDrawId = inVs_drawId + ((uint(inVs_vertexId) - worldMaterialIdx[inVs_drawId].w) / 54u);
+	@property( !colibri_text && !colibri_unindexed && !colibri_instanced )
+		//Regular widgets are indexed, 16 vertices each. All their draws start at index 0.
+		//LabelBmp (unindexed) starts a new draw whenever its material changes.
+		uint colibriDrawId = inVs_drawId + ((uint(inVs_vertexId) - worldMaterialIdx[inVs_drawId].w) / 16u);
 		#undef finalDrawId
 		#define finalDrawId colibriDrawId
 	@end
@@ -33,11 +49,64 @@
 
 	@property( colibri_text )
 		uint vertId = (uint(inVs_vertexId) - worldMaterialIdx[inVs_drawId].w) % 6u;
-		outVs.uvText.x = (vertId <= 1u || vertId == 5u) ? 0.0f : float( blendIndices.x );
-		outVs.uvText.y = (vertId == 0u || vertId >= 4u) ? 0.0f : float( blendIndices.y );
+		//The quad is enlarged to also cover the shadow (binormal is its offset in texels)
+		outVs.uvText.x = (vertId <= 1u || vertId == 5u) ? min( binormal.x, 0.0f ) :
+							 ( float( blendIndices.x ) + max( binormal.x, 0.0f ) );
+		outVs.uvText.y = (vertId == 0u || vertId >= 4u) ? min( binormal.y, 0.0f ) :
+							 ( float( blendIndices.y ) + max( binormal.y, 0.0f ) );
 		outVs.pixelsPerRow		= blendIndices.x;
+		outVs.pixelRows			= blendIndices.y;
 		outVs.glyphOffsetStart	= tangent;
+		outVs.shadowOffset		= binormal;
+		outVs.shadowColour		= secondary_colour;
 	@end
 @end
 
+@property( colibri_instanced )
+@piece( custom_vs_posExecution )
+	//Rebuild the 3x3 grid from the widget's UiInstance record. vertex.xy is the column & row
+	{
+		uint instanceStart = worldMaterialIdx[inVs_drawId].w;
+		float4 outerRect	= colibriInstanceFetch( instanceStart );
+		float4 innerRect	= colibriInstanceFetch( instanceStart + 1u );
+		float4 orient0		= colibriInstanceFetch( instanceStart + 2u );
+		float4 orient1		= colibriInstanceFetch( instanceStart + 3u );
+		float4 clipRect		= colibriInstanceFetch( instanceStart + 4u );
+		uint4 uvGrid		= floatBitsToUint( colibriInstanceFetch( instanceStart + 5u ) );
+
+		uint2 cell = uint2( vertex.xy );
+		float2 gridPos;
+		gridPos.x = cell.x == 0u ? outerRect.x : ( cell.x == 1u ? innerRect.x :
+					( cell.x == 2u ? innerRect.z : outerRect.z ) );
+		gridPos.y = cell.y == 0u ? outerRect.y : ( cell.y == 1u ? innerRect.y :
+					( cell.y == 2u ? innerRect.w : outerRect.w ) );
+
+		gl_Position.x = orient0.x * gridPos.x + orient0.y * gridPos.y + orient0.z;
+		gl_Position.y = orient0.w * gridPos.x + orient1.x * gridPos.y + orient1.y;
+		gl_Position.zw = float2( 0.0f, 1.0f );
+
+		outVs.uv0.x = float( ( uvGrid[cell.x >> 1u] >> ( ( cell.x & 1u ) * 16u ) ) & 0xFFFFu ) / 65535.0f;
+		outVs.uv0.y = float( ( uvGrid[2u + ( cell.y >> 1u )] >> ( ( cell.y & 1u ) * 16u ) ) & 0xFFFFu ) / 65535.0f;
+
+		uint rgba = floatBitsToUint( orient1.z );
+		outVs.colour = float4( uint4( rgba, rgba >> 8u, rgba >> 16u, rgba >> 24u ) & 0xFFu ) / 255.0f;
+
+		float4 clipDistance;
+		clipDistance.x = ( gridPos.y - clipRect.y ) * clipRect.w; //Top
+		clipDistance.y = ( gridPos.x - clipRect.x ) * clipRect.z; //Left
+		clipDistance.z = 1.0f - clipDistance.y; //Right
+		clipDistance.w = 1.0f - clipDistance.x; //Bottom
+
+		@property( hlms_pso_clip_distances >= 4 )
+			gl_ClipDistance[0] = clipDistance.x;
+			gl_ClipDistance[1] = clipDistance.y;
+			gl_ClipDistance[2] = clipDistance.z;
+			gl_ClipDistance[3] = clipDistance.w;
+		@else
+			outVs.emulatedClipDistance = clipDistance;
+		@end
+	}
+@end
+@end
+
 @end
@@ -6,16 +6,23 @@
 	@property( colibri_text )
 		uint tangent [[attribute(VES_TANGENT)]];
 		uint2 blendIndices [[attribute(VES_BLEND_INDICES)]];
+		float4 secondary_colour [[attribute(VES_SPECULAR)]];
+		float2 binormal [[attribute(VES_BINORMAL)]];
 	@end
 @end
 
 @piece( custom_vs_uniformDeclaration )
 	, uint gl_VertexID	[[vertex_id]]
+	@property( colibri_instanced )
+		, device const float4 *colibriInstances [[buffer(TEX_SLOT_START+3)]]
+	@end
 @end
 
 @piece( custom_vs_preExecution )
-	@property( !colibri_text )
-		uint colibriDrawId = inVs_drawId + ((uint(gl_VertexID) - worldMaterialIdx[inVs_drawId].w) / 54u);
+	@property( !colibri_text && !colibri_unindexed && !colibri_instanced )
+		//Regular widgets are indexed, 16 vertices each. All their draws start at index 0.
+		//LabelBmp (unindexed) starts a new draw whenever its material changes.
+		uint colibriDrawId = inVs_drawId + ((uint(gl_VertexID) - worldMaterialIdx[inVs_drawId].w) / 16u);
 		#undef finalDrawId
 		#define finalDrawId colibriDrawId
 	@end
@@ -29,11 +36,60 @@
 
 	@property( colibri_text )
 		uint vertId = (uint(gl_VertexID) - worldMaterialIdx[inVs_drawId].w) % 6u;
-		outVs.uvText.x = (vertId <= 1u || vertId == 5u) ? 0.0f : float( input.blendIndices.x );
-		outVs.uvText.y = (vertId == 0u || vertId >= 4u) ? 0.0f : float( input.blendIndices.y );
+		//The quad is enlarged to also cover the shadow (binormal is its offset in texels)
+		outVs.uvText.x = (vertId <= 1u || vertId == 5u) ? min( input.binormal.x, 0.0f ) :
+							 ( float( input.blendIndices.x ) + max( input.binormal.x, 0.0f ) );
+		outVs.uvText.y = (vertId == 0u || vertId >= 4u) ? min( input.binormal.y, 0.0f ) :
+							 ( float( input.blendIndices.y ) + max( input.binormal.y, 0.0f ) );
 		outVs.pixelsPerRow		= input.blendIndices.x;
+		outVs.pixelRows			= input.blendIndices.y;
 		outVs.glyphOffsetStart	= input.tangent;
+		outVs.shadowOffset		= input.binormal;
+		outVs.shadowColour		= input.secondary_colour;
 	@end
 @end
 
+@property( colibri_instanced )
+@piece( custom_vs_posExecution )
+	//Rebuild the 3x3 grid from the widget's UiInstance record. position.xy is the column & row
+	{
+		uint instanceStart = worldMaterialIdx[inVs_drawId].w;
+		float4 outerRect	= colibriInstances[instanceStart];
+		float4 innerRect	= colibriInstances[instanceStart + 1u];
+		float4 orient0		= colibriInstances[instanceStart + 2u];
+		float4 orient1		= colibriInstances[instanceStart + 3u];
+		float4 clipRect		= colibriInstances[instanceStart + 4u];
+		uint4 uvGrid		= as_type<uint4>( colibriInstances[instanceStart + 5u] );
+
+		uint2 cell = uint2( input.position.xy );
+		float2 gridPos;
+		gridPos.x = cell.x == 0u ? outerRect.x : ( cell.x == 1u ? innerRect.x :
+					( cell.x == 2u ? innerRect.z : outerRect.z ) );
+		gridPos.y = cell.y == 0u ? outerRect.y : ( cell.y == 1u ? innerRect.y :
+					( cell.y == 2u ? innerRect.w : outerRect.w ) );
+
+		outVs.gl_Position.x = orient0.x * gridPos.x + orient0.y * gridPos.y + orient0.z;
+		outVs.gl_Position.y = orient0.w * gridPos.x + orient1.x * gridPos.y + orient1.y;
+		outVs.gl_Position.zw = float2( 0.0f, 1.0f );
+
+		outVs.uv0.x = float( ( uvGrid[cell.x >> 1u] >> ( ( cell.x & 1u ) * 16u ) ) & 0xFFFFu ) / 65535.0f;
+		outVs.uv0.y = float( ( uvGrid[2u + ( cell.y >> 1u )] >> ( ( cell.y & 1u ) * 16u ) ) & 0xFFFFu ) / 65535.0f;
+
+		uint rgba = as_type<uint>( orient1.z );
+		outVs.colour = float4( uint4( rgba, rgba >> 8u, rgba >> 16u, rgba >> 24u ) & 0xFFu ) / 255.0f;
+
+		float4 clipDistance;
+		clipDistance.x = ( gridPos.y - clipRect.y ) * clipRect.w; //Top
+		clipDistance.y = ( gridPos.x - clipRect.x ) * clipRect.z; //Left
+		clipDistance.z = 1.0f - clipDistance.y; //Right
+		clipDistance.w = 1.0f - clipDistance.x; //Bottom
+
+		outVs.gl_ClipDistance[0] = clipDistance.x;
+		outVs.gl_ClipDistance[1] = clipDistance.y;
+		outVs.gl_ClipDistance[2] = clipDistance.z;
+		outVs.gl_ClipDistance[3] = clipDistance.w;
+	}
+@end
+@end
+
 @end
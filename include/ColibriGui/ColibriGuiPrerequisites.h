@@ -60,10 +60,14 @@ namespace Colibri
 	class ShaperManager;
 	struct SkinInfo;
 	class SkinManager;
+	class SpatialGrid;
 	class Slider;
 	class Spinner;
+	class VirtualList;
+	class VirtualListDataSource;
 	class Widget;
 	class Window;
+	class WorkerPool;
 
 	namespace LogSeverity
 	{
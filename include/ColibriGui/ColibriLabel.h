@@ -38,6 +38,34 @@ namespace Colibri
 
 		typedef std::vector<uint32_t> PrivateAreaGlyphsVec;
 
+		/// Part of the text that changed through replaceText since glyphs were last updated
+		struct TextEdit
+		{
+			/// Range of bytes [start; end) of the new text that differs from the old one
+			size_t		start;
+			size_t		end;
+			/// New length minus old length of the whole text, in code units UTF16
+			ptrdiff_t	utf16Delta;
+			/// When false, the glyphs must be updated from scratch
+			bool		bPending;
+		};
+
+		/// What appendText did since glyphs were last updated
+		struct TextAppend
+		{
+			/// Number of glyphs at the front of m_shapes that belong to evicted text
+			size_t	numEvictedGlyphs;
+			/// Number of shaped RichText that were erased from the front of m_richText
+			size_t	numEvictedRichText;
+			/// Number of RichText at the back of m_richText that haven't been shaped yet
+			size_t	numNewRichText;
+			/// True if m_richText[0] was shaped, but its text was partially evicted.
+			/// Its glyphs are already counted in numEvictedGlyphs
+			bool	bFirstCut;
+			/// When false, the glyphs must be updated from scratch
+			bool	bPending;
+		};
+
 		std::string		m_text[States::NumStates];
 		RichTextVec		m_richText[States::NumStates];
 		ShapedGlyphVec	m_shapes[States::NumStates];
@@ -50,6 +78,65 @@ namespace Colibri
 		/// For internal use. Set to true if any of RichText uses background, false otherwise.
 		bool m_usesBackground;
 
+		TextEdit m_textEdits[States::NumStates];
+		/// Width (in pixels) the glyphs were last placed with, if they weren't displaced
+		/// by alignGlyphs afterwards. Negative otherwise.
+		/// Glyphs can only be placed incrementally after an edit if this matches
+		float m_plainLayoutWidth[States::NumStates];
+
+		TextAppend	m_textAppends[States::NumStates];
+		/// See setAppendLimits. 0 means unlimited
+		size_t		m_appendMaxLines;
+		size_t		m_appendMaxBytes;
+
+		/// Consecutive glyphs placed in the same line. See setLargeTextMode
+		struct LineRange
+		{
+			uint32_t glyphStart;
+			uint32_t glyphEnd;
+			/// Topmost pixel of this line and all the lines after it (relative to the Label)
+			float minTop;
+			/// Bottommost pixel of this line and all the lines before it (relative to the Label)
+			float maxBottom;
+		};
+		typedef std::vector<LineRange> LineRangeVec;
+
+		bool			m_largeTextMode;
+		/// True if m_requiredGlyphBudget is bigger than m_visibleGlyphBudget for any state
+		bool			m_glyphBudgetDirty;
+		/// Only filled in large text mode, and only for horizontal text
+		LineRangeVec	m_lines[States::NumStates];
+		/// Max number of glyphs _fillBuffersAndCommands emits per state in large text mode.
+		/// It can only grow in _updateDirtyGlyphs, otherwise ColibriManager may have
+		/// already sized the vertex buffer for this frame
+		size_t			m_visibleGlyphBudget[States::NumStates];
+		size_t			m_requiredGlyphBudget[States::NumStates];
+
+		/// A quad ready to be turned into vertices. See updateGlyphQuads
+		struct GlyphQuad
+		{
+			/// Corners in pixels relative to the Label, already snapped to pixels
+			Ogre::Vector2	topLeft;
+			Ogre::Vector2	bottomRight;
+			/// Index to m_shapes. Unused by backgrounds
+			uint32_t		glyphIdx;
+			uint32_t		offsetStart;
+			uint32_t		rgbaColour;
+			/// m_shadowDisplace in texels of the glyph, as 2 half floats (x in the lower bits).
+			/// 0 if there's no shadow
+			uint32_t		shadowOffset;
+			uint16_t		width;
+			uint16_t		height;
+		};
+		typedef std::vector<GlyphQuad> GlyphQuadVec;
+
+		/// Quads of the glyphs and backgrounds of m_glyphQuadsState, so that
+		/// _fillBuffersAndCommands only needs to transform and clip them
+		GlyphQuadVec	m_glyphQuads;
+		GlyphQuadVec	m_backgroundQuads;
+		/// States::NumStates if the quads must be built again
+		States::States	m_glyphQuadsState;
+
 	public:
 		/// When true (default) text will be clipped against the widget's size.
 		///
@@ -113,6 +200,72 @@ namespace Colibri
 		*/
 		colibri_virtual_l1 void updateGlyphs( States::States state, bool bPlaceGlyphs=true );
 
+		/** Called by updateGlyphs. If the only change since the glyphs were last updated was
+			done via replaceText, reshapes only the paragraphs that were edited and splices
+			them into m_shapes; then places only those paragraphs if possible and displaces
+			the ones after them.
+		@return
+			False if the glyphs must be updated from scratch. Nothing was done in that case
+		*/
+		bool updateGlyphsIncremental( States::States state, bool bPlaceGlyphs );
+
+		/** Called by updateGlyphs. If the only changes since the glyphs were last updated
+			were done via appendText, releases the glyphs of the evicted text and shapes
+			only the appended text; then places only the last paragraphs if possible and
+			displaces the rest.
+		@return
+			False if the glyphs must be updated from scratch. Nothing was done in that case
+		*/
+		bool updateGlyphsAppend( States::States state, bool bPlaceGlyphs );
+
+		/// Sets m_actualHorizAlignment & m_actualVertReadingDir after shaping
+		/// @param shapedDir Direction returned by ShaperManager::renderString
+		void updateActualDirections( States::States state,
+									 TextHorizAlignment::TextHorizAlignment shapedDir );
+
+		/** Places the glyphs in [firstGlyph; endGlyph] after they changed, without touching
+			the ones before. The glyphs after endGlyph are displaced vertically as a whole.
+			Only possible if the glyphs before firstGlyph were placed without alignment.
+		@param firstGlyph
+			Must be right after a newline
+		@param endGlyph
+			The newline after the glyphs that changed, or m_shapes[state].size()
+		@param oldEndY
+			caretPos.y of the glyph at endGlyph before the change
+		@return
+			False if the glyphs must be placed from scratch. Nothing was done in that case
+		*/
+		bool placeParagraphs( States::States state, size_t firstGlyph, size_t endGlyph,
+							  float oldEndY );
+
+		/// True if alignGlyphs doesn't displace the glyphs of this state
+		bool isAlignmentNoop( States::States state ) const;
+
+		/// Must be called every time the glyphs are moved.
+		/// Invalidates the cached quads and rebuilds m_lines
+		void notifyGlyphsMoved( States::States state );
+
+		/// Rebuilds m_lines from the placed glyphs, if in large text mode
+		void updateLineIndex( States::States state );
+
+		/// Forces updateGlyphQuads to build the quads again if they're from the given state
+		void invalidateGlyphQuads( States::States state );
+
+		/// Builds m_glyphQuads & m_backgroundQuads from m_currentState, if out of date
+		void updateGlyphQuads();
+		void updateBackgroundQuads();
+
+		/// Returns the first entry in m_glyphQuads whose glyphIdx is >= glyphIdx
+		size_t findFirstGlyphQuad( size_t glyphIdx ) const;
+
+		/// Calculates m_requiredGlyphBudget from m_lines and the size of our parent
+		void updateVisibleGlyphBudget( States::States state );
+
+		/// Returns the range of lines in m_lines[m_currentState] that may intersect
+		/// [clipTop; clipBottom] (in pixels, relative to the Label)
+		void findVisibleLines( float clipTop, float clipBottom, size_t &outFirstLine,
+							   size_t &outEndLine ) const;
+
 		/** Places the glyphs obtained from updateGlyphs at the correct position
 			(always assuming TextHorizAlignment::Left) considering word wrap
 			and size bounds.
@@ -122,6 +275,18 @@ namespace Colibri
 		*/
 		void placeGlyphs( States::States state, bool performAlignment=true );
 
+		/** Places the words that start after inOutWord, until reaching glyphEnd.
+			See placeGlyphs
+		@param inOutWord
+			The last placed word. Its endCaretPos is where the next word starts
+		@param largestHeight
+			Height of the line inOutWord is in
+		@param glyphEnd
+			Must be at the boundary of a word (e.g. right after a newline) or the end
+		*/
+		void placeWords( States::States state, Word &inOutWord, float largestHeight,
+						 size_t glyphEnd );
+
 		/** After calling placeGlyphs, this function realigns the text based on
 			TextHorizAlignment & TextVertAlignment
 		@param state
@@ -147,6 +312,8 @@ namespace Colibri
 							 uint16_t glyphWidth,
 							 uint16_t glyphHeight,
 							 uint32_t rgbaColour,
+							 uint32_t shadowRgbaColour,
+							 uint32_t shadowOffset,
 							 Ogre::Vector2 parentDerivedTL,
 							 Ogre::Vector2 parentDerivedBR,
 							 Ogre::Vector2 invSize,
@@ -214,8 +381,9 @@ namespace Colibri
 			colour as the text.
 		@remarks
 			This feature is controlled per Label, not per RichText entry.
-			There is no overhead for calling this function often.
-			Drawing the shadow may incur in higher GPU cost though, due to overdraw.
+			There is little overhead for calling this function often.
+			The shadow is drawn by the text shader, in the same quad as its glyph (which
+			is enlarged to fit both). Thus it takes no extra vertices.
 		@param enable
 			True to enable. False to disable.
 		@param shadowColour
@@ -228,11 +396,32 @@ namespace Colibri
 		void setShadowOutline( bool enable, Ogre::ColourValue shadowColour=Ogre::ColourValue::Black,
 							   const Ogre::Vector2 &shadowDisplace=Ogre::Vector2::UNIT_SCALE );
 
+		/** Large text mode is meant for Labels holding thousands of lines (logs, EULAs, etc)
+			of which only a few are visible at a time through the scroll of the parent Window.
+
+			The lines are indexed after placing the glyphs, so that only the ones that
+			intersect the clip rect are turned into vertices; and room in the vertex buffer is
+			only reserved for as many lines as fit in our parent, rather than for the whole text.
+		@remarks
+			Only horizontal text is virtualized. Vertical text is always emitted entirely.
+			Backgrounds (see RichText::noBackground) are always emitted entirely.
+		*/
+		void setLargeTextMode( bool bLargeTextMode );
+		bool getLargeTextMode() const;
+
 		/** Called by ColibriManager after we've told them we're dirty.
 			It will update m_shapes so we can correctly render text.
 		*/
 		void _updateDirtyGlyphs();
 
+		/** Called by ColibriManager when glyphs were moved to a different place in the atlas
+			(see ShaperManager::compactAtlas). If we're displaying any of them, our vertices
+			must be filled again.
+		@param sortedGlyphs
+			Glyphs that moved, sorted by pointer address
+		*/
+		void _notifyGlyphsRelocated( const std::vector<const CachedGlyph *> &sortedGlyphs );
+
 		/** Returns the max number of glyphs needed to render
 		@return
 			It's not the sum of all states, but rather the maximum of all states,
@@ -248,6 +437,61 @@ namespace Colibri
 		*/
 		void setText( const std::string &text, States::States forState=States::NumStates );
 
+		/** Replaces part of the text, e.g. when typing. Unlike setText, only the paragraphs
+			that were touched get shaped again, which matters when the text is long.
+		@remarks
+			The glyphs can only be updated incrementally if RichText wasn't customized.
+			Otherwise this behaves like setText (i.e. Rich Edit settings are cleared).
+			Glyphs can only be placed incrementally if the text is aligned to the top left
+			and is not vertical. Otherwise they're placed again from scratch (which is much
+			cheaper than shaping).
+		@param utf16Start
+			Where the text to replace starts, in codeunits UTF16. See getGlyphStartUtf16
+		@param utf16Length
+			Length of the text to replace, in codeunits UTF16. 0 to insert
+		@param utf8Text
+			Text to insert in its place. Must be UTF8. Can be empty to erase
+		@param forState
+			Use NumStates to affect all states
+		*/
+		void replaceText( size_t utf16Start, size_t utf16Length, const char *utf8Text,
+						  States::States forState=States::NumStates );
+
+		/** Appends text at the end, e.g. a new line of a chat or a log. Unlike setText, only
+			the appended text gets shaped, while the oldest lines are evicted if the text
+			grows past the limits set with setAppendLimits.
+		@remarks
+			Lines are the paragraphs separated by '\n'. The last line is never evicted,
+			even if on its own it goes past the byte limit.
+			Glyphs can only be placed incrementally if the text is aligned to the top left
+			and is not vertical. Otherwise they're placed again from scratch.
+			If the text is modified by other means (e.g. setText or replaceText) before
+			the glyphs get updated, everything is shaped again.
+		@param text
+			Text to append. Must be UTF8. It should end in '\n' if the next append is
+			supposed to start a new line
+		@param richText
+			Rich Edit settings for the appended text. Their offsets are relative to the
+			start of text. Rich Edit settings of the previous text are kept.
+			Null to use the default settings (see getDefaultRichText)
+		@param forState
+			Use NumStates to affect all states
+		*/
+		void appendText( const std::string &text, const RichTextVec *colibri_nullable richText = 0,
+						 States::States forState = States::NumStates );
+
+		/** Limits how much text appendText keeps. When the text goes past any of them,
+			the oldest lines are evicted (and the references to their glyphs released).
+			The limits are only enforced by appendText.
+		@param maxLines
+			Max number of lines. 0 for unlimited
+		@param maxBytes
+			Max length of the text, in bytes. 0 for unlimited
+		*/
+		void setAppendLimits( size_t maxLines, size_t maxBytes );
+		size_t getAppendMaxLines() const;
+		size_t getAppendMaxBytes() const;
+
 		/// Returns the text for the given state. When state == States::NumStates, it
 		/// returns the text from the current state
 		const std::string& getText( States::States state=States::NumStates );
@@ -404,12 +648,12 @@ namespace Colibri
 						TextVertAlignment::TextVertAlignment newVertPos=TextVertAlignment::Top,
 						States::States baseState=States::NumStates );
 
+		/// Emits m_backgroundQuads. updateGlyphQuads must've been called first
 		GlyphVertex* fillBackground( GlyphVertex * RESTRICT_ALIAS textVertBuffer,
 									 const Ogre::Vector2 halfWindowRes,
 									 const Ogre::Vector2 invWindowRes,
 									 const Ogre::Vector2 parentDerivedTL,
-									 const Ogre::Vector2 parentDerivedBR,
-									 const bool isHorizontal );
+									 const Ogre::Vector2 parentDerivedBR );
 
 		void _fillBuffersAndCommands(
 			UiVertex *colibri_nonnull *colibri_nonnull RESTRICT_ALIAS vertexBuffer,
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "ColibriGui/ColibriWidget.h"
+#include "ColibriGui/ColibriNavigationSearch.h"
 
 #include "OgreIdString.h"
 
@@ -110,6 +111,7 @@ namespace Colibri
 		size_t   m_numLabelsAndBmp;   /// Counts both Labels and LabelBmps
 		size_t   m_numTextGlyphs;     /// It's an upper bound. Current max number of glyphs may be lower
 		size_t   m_numTextGlyphsBmp;  /// It's an upper bound. Current max number of glyphs may be lower
+		size_t   m_numUnsharedGrids;  /// Widgets drawn with 54 vertices. See Renderable::m_unsharedGrid
 		LabelVec m_dirtyLabels;
 		LabelBmpVec m_dirtyLabelBmps;
 		WidgetVec m_dirtyWidgets;
@@ -128,6 +130,16 @@ namespace Colibri
 		/// @see	Widget::m_breadthFirst
 		WidgetVec m_breadthFirst[4];
 
+		/// Scratch memory for autosetNavigation
+		NavigationSearch m_navigationSearch;
+		WidgetVec        m_navigationChangedWidgets;
+		/// True while a breadth first executor is filling vertex buffers. Widgets then
+		/// collect their children into m_breadthFirst instead of filling them recursively.
+		///
+		/// @remark	For internal use.
+		/// @see	Widget::fillChildrenBuffers
+		bool m_collectingBreadthFirstFill;
+
 	protected:
 		LogListener	*m_logListener;
 		ColibriListener	*m_colibriListener;
@@ -151,8 +163,18 @@ namespace Colibri
 		Ogre::VaoManager			* colibri_nullable m_vaoManager;
 		Ogre::ObjectMemoryManager	* colibri_nullable m_objectMemoryManager;
 		Ogre::SceneManager			* colibri_nullable m_sceneManager;
+		/// Indexed Vao used by regular widgets. See ColibriOgreRenderable::createIndexBuffer
 		Ogre::VertexArrayObject		* colibri_nullable m_vao;
+		/// Same vertex buffer as m_vao, but without index buffer. Used by LabelBmp
+		Ogre::VertexArrayObject		* colibri_nullable m_vaoBmp;
 		Ogre::VertexArrayObject		* colibri_nullable m_textVao;
+		/// 54 vertices shared by all instanced widgets. See setInstancedWidgets
+		Ogre::VertexArrayObject		* colibri_nullable m_vaoInstanced;
+		Ogre::IndexBufferPacked		* colibri_nullable m_defaultIndexBuffer;
+		/// GPU copy of m_vertexBufferCpu readable by the vertex shader, where instanced
+		/// widgets store their UiInstance records. Only exists while m_instancedWidgets
+		/// is true. It's a ReadOnlyBufferPacked on Mali, TexBufferPacked everywhere else
+		Ogre::BufferPacked			* colibri_nullable m_instanceBuffer;
 		Ogre::IndirectBufferPacked	* colibri_nullable m_indirectBuffer;
 		Ogre::CommandBuffer			* colibri_nullable m_commandBuffer;
 		Ogre::HlmsDatablock			* colibri_nullable m_defaultTextDatablock[States::NumStates];
@@ -206,6 +228,35 @@ namespace Colibri
 		UiVertex		*m_vertexBufferBase;
 		GlyphVertex		*m_textVertexBufferBase;
 
+		/// CPU copy of the vertex buffers. Windows that didn't change since the last
+		/// prepareRenderCommands keep their range intact here, thus only dirty windows
+		/// get their vertices generated again. See Window::m_visualsDirty
+		UiVertex		* colibri_nullable m_vertexBufferCpu;
+		GlyphVertex		* colibri_nullable m_textVertexBufferCpu;
+		size_t			m_vertexBufferCpuSize;
+		size_t			m_textVertexBufferCpuSize;
+		/// GPU vertex buffers are multi-buffered, and each map() moves to the next copy.
+		/// Every time vertices are generated again, this is set to the number of copies
+		/// and decremented on each map, so all copies receive the new data.
+		size_t			m_pendingVertexUploads;
+		/// When true, all windows are filled regardless of their dirty flag
+		bool			m_allWindowsVisualsDirty;
+		/// See requestRedraw
+		bool			m_redrawRequested;
+		/// See setInstancedWidgets
+		bool			m_instancedWidgets;
+		/// See setSimdVertexFill
+		bool			m_simdVertexFill;
+		/// See getLastVertexFillMicroseconds
+		uint64_t		m_lastVertexFillMicroseconds;
+
+		/// See setWorkerPool
+		WorkerPool		* colibri_nullable m_workerPool;
+		/// Scratch lists used by prepareRenderCommands when m_workerPool is set.
+		/// m_parallelFillStarts holds the vertex & text vertex start of each window.
+		WindowVec				m_parallelFillWindows;
+		std::vector<uint32_t>	m_parallelFillStarts;
+
 #if COLIBRIGUI_DEBUG_MEDIUM
 		bool m_fillBuffersStarted;
 		bool m_renderingStarted;
@@ -226,10 +277,45 @@ namespace Colibri
 		void _updateDirtyLabels();
 
 	protected:
+		/// Number of vertices regular widgets (i.e. not Labels nor LabelBmp) write
+		uint32_t getVerticesPerWidget() const;
+
 		void checkVertexBufferCapacity();
 
+		/** Calculates the most vertices the given widget and its children can write
+			in _fillBuffersAndCommands. Same criteria as checkVertexBufferCapacity.
+			Windows cache the result, see Window::m_maxVertexCount
+		*/
+		void countMaxVertices( const Widget *widget, size_t &outNumVertices,
+							   size_t &outNumTextVertices ) const;
+
+		/// Returns true if the widget or any of its children fills its children
+		/// breadth first, which relies on m_breadthFirst and hence can't be
+		/// filled in parallel.
+		static bool isAnyBreadthFirst( const Widget *widget );
+
+		/// Serial path of prepareRenderCommands. Returns true if any window was filled
+		bool fillWindowsSerial( size_t &outNumVertices, size_t &outNumTextVertices );
+		/// Parallel path of prepareRenderCommands. See setWorkerPool
+		bool fillWindowsParallel( size_t &outNumVertices, size_t &outNumTextVertices );
+
+		/// Creates, resizes or destroys m_instanceBuffer to match m_instancedWidgets
+		/// and the size of the regular vertex buffer
+		void syncInstanceBuffer();
+		void destroyInstanceBuffer();
+
+		/** Links the keyboard navigable widgets in range [start; start + numWidgets)
+			with their closest sibling in each direction.
+		@param removedWidgets
+			Siblings that were removed from the container since the last call.
+			When not null, the neighbour search is only repeated around the siblings
+			that changed since the last call (and the list is cleared).
+			When null, the search is done from scratch for every sibling.
+			They're only compared by pointer, never dereferenced.
+		*/
 		template <typename T>
-		void autosetNavigation( const std::vector<T> &container, size_t start, size_t numWidgets );
+		void autosetNavigation( const std::vector<T> &container, size_t start, size_t numWidgets,
+								WidgetVec *colibri_nullable removedWidgets );
 
 		void autosetNavigation( Window *window );
 
@@ -254,11 +340,53 @@ namespace Colibri
 		Ogre::ObjectMemoryManager* getOgreObjectMemoryManager()		{ return m_objectMemoryManager; }
 		Ogre::SceneManager* getOgreSceneManager()					{ return m_sceneManager; }
 		Ogre::VertexArrayObject* getVao()							{ return m_vao; }
+		Ogre::VertexArrayObject* getVaoBmp()						{ return m_vaoBmp; }
+		Ogre::VertexArrayObject* getVaoInstanced()					{ return m_vaoInstanced; }
 		Ogre::VertexArrayObject* getTextVao()						{ return m_textVao; }
 		Ogre::HlmsDatablock * colibri_nonnull * colibri_nullable getDefaultTextDatablock()
 																	{ return m_defaultTextDatablock; }
 		Ogre::HlmsManager *getOgreHlmsManager();
 
+		/** When true, regular widgets (i.e. not Labels nor LabelBmp) write one compact UiInstance
+			record instead of their 16 vertices, and the 9-slice grid is built in the vertex
+			shader. This considerably reduces CPU work when lots of widgets change every frame
+			(e.g. animating thousands of list items).
+		@remarks
+			Requires the ColibriGui vertex shader pieces to support 'colibri_instanced'.
+			Default is false.
+		*/
+		void setInstancedWidgets( bool bInstanced );
+		bool getInstancedWidgets() const							{ return m_instancedWidgets; }
+
+		/** When true (the default) vertices are generated with SSE2 / NEON, if ColibriGui
+			was built with them (see ColibriSimd.h). When false the scalar path is used.
+		@remarks
+			Both paths produce the same vertices. This exists to compare them at runtime,
+			see getLastVertexFillMicroseconds.
+		*/
+		void setSimdVertexFill( bool bSimd );
+		bool getSimdVertexFill() const								{ return m_simdVertexFill; }
+
+		/// Returns how long the last prepareRenderCommands took to generate the vertices
+		/// of the windows that needed it (0 if none did). Upload time isn't included
+		uint64_t getLastVertexFillMicroseconds() const		{ return m_lastVertexFillMicroseconds; }
+
+		/** When set, prepareRenderCommands generates the vertices of each top-level window
+			in parallel through the given pool. The vertex ranges of each window are
+			reserved upfront based on the most vertices they could need, so there may be
+			small unused gaps between them.
+
+			Windows that have any widget with Widget::m_breadthFirst set are still filled
+			on the calling thread (after the rest).
+		@remarks
+			We don't take ownership. The pool must outlive this ColibriManager or be unset.
+			Pass a DefaultWorkerPool if you don't have your own job system.
+		@param workerPool
+			Null to fill all windows serially (default).
+		*/
+		void setWorkerPool( WorkerPool * colibri_nullable workerPool );
+		WorkerPool * colibri_nullable getWorkerPool() const			{ return m_workerPool; }
+
 		/// When true, swaps the controls for RTL languages such as arabic. That means spinners
 		/// increment when clicking left button, for example
 		void setSwapRTLControls( bool swapRtl );
@@ -477,6 +605,10 @@ namespace Colibri
 
 		void _setWidgetTransformsDirty();
 
+		/// Called by Renderable when it enters or leaves its 54 vertex path.
+		/// See Renderable::m_unsharedGrid
+		void _notifyUnsharedGrid( bool unsharedGrid );
+
 		/// If creating a custom label widget, this must be called on creation.
 		void _notifyLabelCreated( Label* label );
 
@@ -491,13 +623,41 @@ namespace Colibri
 		void _addDirtyLabel( Label *label );
 		void _addDirtyLabelBmp( LabelBmp *label );
 
+		/// Called by ShaperManager::compactAtlas. sortedGlyphs must be sorted by pointer address
+		void _notifyGlyphsRelocated( const std::vector<const CachedGlyph *> &sortedGlyphs );
+
 		/// Cannot be nullptr
 		void _stealKeyboardFocus( Widget *widget );
 
 		void update( float timeSinceLast );
+
+		/** Returns true if the next prepareRenderCommands + render would produce a different
+			image from the last render. i.e. something moved, changed state, scrolled, animated,
+			was created or destroyed; or requestRedraw was called.
+
+			When false, the app can skip rendering the UI altogether (e.g. skip compositing
+			a texture the UI was rendered to, or enable
+			CompositorPassColibriGuiDef::mSkipWhenClean).
+		@remarks
+			Call it after update().
+		*/
+		bool needsRedraw() const;
+
+		/** Forces needsRedraw to return true until the next render. Use it when something
+			we can't track changed, e.g. you modified a datablock or a texture used by a skin.
+		*/
+		void requestRedraw();
+
 		void prepareRenderCommands();
 		void render();
 
+		/** Fills the vertices of the given top-level window and its children,
+			starting at the given offsets into the CPU vertex buffers.
+		@remarks
+			For internal use. Called from prepareRenderCommands, possibly from worker threads.
+		*/
+		void _fillWindowBuffers( Window *window, uint32_t vertexStart, uint32_t textVertexStart );
+
 		const UiVertex* _getVertexBufferBase() const
 		{
 			COLIBRI_ASSERT_HIGH( m_fillBuffersStarted );
@@ -0,0 +1,90 @@
+
+#pragma once
+
+#include "ColibriGui/ColibriWidget.h"
+
+COLIBRI_ASSUME_NONNULL_BEGIN
+
+namespace Colibri
+{
+	/**
+	@class NavigationSearch
+		Used by ColibriManager::autosetNavigation to find, for each keyboard navigable widget,
+		the closest navigable sibling after it in each direction
+		(stored in Widget::m_navClosest).
+
+		Comparing every widget against every sibling is O(N²). Instead the siblings are
+		placed in a k-d tree over their rects, and the search skips every node that can't
+		contain a sibling after the widget, nor one in a direction that could be closer
+		than what was already found.
+
+		The result is exactly the same as comparing against every sibling: distances and
+		angles are evaluated with the same code, and ties go to the sibling with the lowest
+		index (which is the one the exhaustive search would have found first).
+	*/
+	class NavigationSearch
+	{
+		struct Entry
+		{
+			Widget       *widget;
+			Ogre::Vector2 topLeft;
+			Ogre::Vector2 bottomRight;
+			uint32_t      idx;
+		};
+
+		struct Node
+		{
+			/// Bounds of the rects of all the widgets under this node
+			Ogre::Vector2 minTopLeft;
+			Ogre::Vector2 maxBottomRight;
+			/// Highest Widget::m_navIndex of all the widgets under this node
+			uint32_t maxIdx;
+			/// When numEntries == 0 this is an inner node, and firstEntry & firstEntry + 1
+			/// are the indices to its children in m_nodes. Otherwise it's a leaf and
+			/// [firstEntry; firstEntry + numEntries) is the range in m_entries.
+			uint32_t firstEntry;
+			uint32_t numEntries;
+		};
+
+		std::vector<Entry>    m_entries;
+		std::vector<Node>     m_nodes;
+		std::vector<uint32_t> m_stack;
+
+		bool m_built;
+
+		void buildNode( uint32_t nodeIdx, uint32_t firstEntry, uint32_t numEntries );
+
+		/** Returns a lower bound of the distance between the widget and any of the widgets
+			under the given node. Returns std::numeric_limits<float>::max() if none of them
+			can be closer than what the widget already found in any direction.
+		*/
+		static float getLowerBound( const Node &node, const Widget *widget );
+
+	public:
+		NavigationSearch();
+
+		/// Removes all widgets. Widgets must be added again and then call build()
+		void clear();
+
+		/// Adds a sibling to search. Its Widget::m_navIndex must already be set
+		void addWidget( Widget *widget );
+
+		/// Builds the tree. Must be called after all widgets have been added,
+		/// and before findClosestSiblings. Does nothing if it's already built.
+		void build();
+		bool isBuilt() const { return m_built; }
+
+		/// Searches among all added siblings for the widget's closest ones
+		/// after it (by Widget::m_navIndex), overwriting Widget::m_navClosest
+		void findClosestSiblings( Widget *widget );
+
+		/// Sets Widget::m_navClosest to null and its distances to infinity
+		static void resetClosestSiblings( Widget *widget );
+
+		/// Replaces the closest siblings of widget with the given sibling, for all the
+		/// directions where the sibling is closer. Assumes the sibling is after the widget.
+		static void evaluateSibling( Widget *widget, Widget *sibling );
+	};
+}  // namespace Colibri
+
+COLIBRI_ASSUME_NONNULL_END
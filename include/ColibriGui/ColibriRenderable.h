@@ -8,8 +8,7 @@
 
 namespace Ogre
 {
-	struct CbDrawCallStrip;
-	struct CbDrawStrip;
+	struct CbDrawCall;
 	class HlmsColibri;
 }
 
@@ -27,6 +26,9 @@ namespace Colibri
 		float			centerAspectRatio;
 		Ogre::ColourValue defaultColour;
 		Ogre::IdString	materialName;
+		/// Bitmask of the cells (1u << GridLocations) whose UVs don't line up with the grid
+		/// lines shared by all cells. See SkinManager::findUnsharedGridCells
+		uint16_t		unsharedGridCells;
 	};
 
 	struct UiVertex
@@ -47,9 +49,35 @@ namespace Colibri
 		uint16_t height;
 		uint32_t offset;
 		uint32_t rgbaColour;
+		/// Colour of the shadow drawn under the glyph. Alpha 0 when there's no shadow.
+		/// See Label::setShadowOutline
+		uint32_t shadowRgbaColour;
+		/// Displacement of the shadow in texels of the glyph, as half floats.
+		/// The quad is enlarged to cover the shadow as well
+		uint16_t shadowOffset[2];
 		float clipDistance[Borders::NumBorders];
 	};
 
+	/** Compact per-widget record written instead of vertices when rendering instanced
+		(see ColibriManager::setInstancedWidgets). The vertex shader rebuilds the 3x3 grid
+		from it. It's stored in the widget's slot of the regular vertex stream, hence it
+		must be a multiple of sizeof( UiVertex ); and it's read as float4s by the shader.
+	*/
+	struct UiInstance
+	{
+		float outerTopLeftBottomRight[4];
+		float innerTopLeftBottomRight[4];
+		/// Derived orientation (2x3). Canvas aspect ratio & Y flip are already baked in
+		float orientation[6];
+		uint32_t rgbaColour;
+		uint32_t padding;
+		/// Top left corner of the clipping region and the inverse of its size
+		float clipTopLeft[2];
+		float clipInvSize[2];
+		/// 4 columns then 4 rows of the grid's UVs, 16-bit unorm, two per uint32_t
+		uint32_t uvGrid[4];
+	};
+
 	/** @ingroup Api_Backend
 	@class ApiEncapsulatedObjects
 		This structure encapsulates API-specific pointers required for rendering.
@@ -76,11 +104,19 @@ namespace Colibri
 		//therefore the material ID)
 		Ogre::HlmsDatablock			*lastDatablock;
 		int							baseInstanceAndIndirectBuffers;
-		Ogre::CbDrawCallStrip		* colibri_nullable drawCmd;
-		Ogre::CbDrawStrip			* colibri_nullable drawCountPtr;
+		//Either a CbDrawCallIndexed (regular widgets) or CbDrawCallStrip (text & LabelBmp)
+		Ogre::CbDrawCall			* colibri_nullable drawCmd;
+		//Points to the primCount of the last CbDrawIndexed or CbDrawStrip in indirectDraw
+		uint32_t					* colibri_nullable drawPrimCount;
+		//Points to the instanceCount of the same draw as drawPrimCount
+		uint32_t					* colibri_nullable drawInstanceCount;
+		//sizeof( CbDrawIndexed ) or sizeof( CbDrawStrip ), whichever was last written to indirectDraw
+		uint32_t lastIndirectDrawSize;
 		uint32_t primCount;
 		uint32_t basePrimCount[2]; //[0] = regular widgets, [1] = text
 		uint32_t nextFirstVertex;
+		//Instanced widgets can only be merged into the same draw if their drawIds are contiguous
+		uint32_t nextBaseInstance;
 	};
 
 	/**
@@ -101,20 +137,29 @@ namespace Colibri
 		Ogre::ColourValue m_colour;
 
 	protected:
-		/// WARNING: Most of the code assumes m_numVertices is hardcoded to 6*9;
+		/// WARNING: Most of the code assumes m_numVertices is hardcoded to 16
+		/// (a 4x4 grid drawn with the shared 9-slice index buffer);
 		/// this value is dynamic because certain widgets (such as Labels) can
 		/// have arbitrary number of vertices and the rest of the code
-		/// also acknowledges that!
+		/// also acknowledges that! (they're drawn without index buffer)
 		uint32_t			m_numVertices;
 		uint32_t			m_currVertexBufferOffset;
 
 		bool				m_visualsEnabled;
+		/// True when a visible cell of the grid doesn't share its edges with its
+		/// neighbours (see StateInformation::unsharedGridCells). Such widgets can't use
+		/// the 16 vertex grid, and are drawn unindexed as 9 independent quads (54 vertices)
+		bool				m_unsharedGrid;
+
+		/// Recalculates m_unsharedGrid and switches between the grid and the 54 vertex path
+		void updateGridUvSharing();
 
 	public:
 		/// @copydoc Widget::addChildrenCommands
 		void _addCommands( ApiEncapsulatedObjects &apiObject, bool collectingBreadthFirst );
 
 	protected:
+		/// Writes 6 unindexed vertices. Used by LabelBmp and grids with unshared UVs.
 		inline void addQuad( UiVertex * RESTRICT_ALIAS vertexBuffer,
 							 Ogre::Vector2 topLeft,
 							 Ogre::Vector2 bottomRight,
@@ -127,12 +172,53 @@ namespace Colibri
 							 float invCanvasAspectRatio,
 							 Matrix2x3 parentRot );
 
+		/** Writes the 16 vertices (4x4 grid) of a 9-slice widget.
+			They're meant to be drawn with the index buffer from
+			ColibriOgreRenderable::createIndexBuffer
+		*/
+		inline void addGrid( UiVertex * RESTRICT_ALIAS vertexBuffer,
+							 Ogre::Vector2 outerTopLeft,
+							 Ogre::Vector2 innerTopLeft,
+							 Ogre::Vector2 innerBottomRight,
+							 Ogre::Vector2 outerBottomRight,
+							 const Ogre::Vector4 * RESTRICT_ALIAS uvTopLeftBottomRight,
+							 uint8_t *rgbaColour,
+							 Ogre::Vector2 parentDerivedTL,
+							 Ogre::Vector2 parentDerivedBR,
+							 Ogre::Vector2 invSize,
+							 float canvasAspectRatio,
+							 float invCanvasAspectRatio,
+							 Matrix2x3 derivedRot );
+
+		/// Instanced counterpart of addGrid. Writes one UiInstance record
+		inline void addInstance( UiInstance * RESTRICT_ALIAS instance,
+								 Ogre::Vector2 outerTopLeft,
+								 Ogre::Vector2 innerTopLeft,
+								 Ogre::Vector2 innerBottomRight,
+								 Ogre::Vector2 outerBottomRight,
+								 const Ogre::Vector4 * RESTRICT_ALIAS uvTopLeftBottomRight,
+								 uint8_t *rgbaColour,
+								 Ogre::Vector2 parentDerivedTL,
+								 Ogre::Vector2 invSize,
+								 float canvasAspectRatio,
+								 float invCanvasAspectRatio,
+								 const Matrix2x3 &derivedRot );
+
 		void _notifyCanvasChanged() override;
 
 		void stateChanged( States::States newState ) override;
 
 	public:
 		Renderable( ColibriManager *manager );
+		~Renderable() override;
+
+		/// Returns the cells of the 3x3 grid (in the same format as
+		/// StateInformation::unsharedGridCells) that take up space on screen,
+		/// i.e. the center plus the borders whose size isn't 0
+		static uint16_t getVisibleGridCells( const StateInformation &stateInfo );
+
+		/// See m_unsharedGrid
+		bool hasUnsharedGridUv() const { return m_unsharedGrid; }
 
 		/** Disables drawing this widget, but it is still active. That means you can click on it,
 			highlight it, navigate to it via the keyboard, etc; as if everything were normal.
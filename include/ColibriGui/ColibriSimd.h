@@ -0,0 +1,89 @@
+
+#pragma once
+
+#include "ColibriGui/ColibriGuiPrerequisites.h"
+
+#if !defined( COLIBRI_DISABLE_SIMD )
+	#if defined( __SSE2__ ) || defined( _M_X64 ) || defined( _M_AMD64 ) || \
+		( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+		#define COLIBRI_SIMD_SSE2
+		#include <emmintrin.h>
+	#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ ) || defined( _M_ARM64 )
+		#define COLIBRI_SIMD_NEON
+		#include <arm_neon.h>
+	#endif
+#endif
+
+#if defined( COLIBRI_SIMD_SSE2 ) || defined( COLIBRI_SIMD_NEON )
+	#define COLIBRI_SIMD
+#endif
+
+#ifdef COLIBRI_SIMD
+
+namespace Colibri
+{
+	/** Minimal 4-wide float wrappers used by the vertex fill kernels
+		(Renderable::addGrid, Renderable::addQuad, Label::addQuad).
+
+		Only what those kernels need is exposed. SSE2 is always available on x86-64
+		and NEON on ARM64, thus no runtime dispatch is needed.
+		ColibriManager::setSimdVertexFill switches to the scalar path at runtime, to
+		compare both. Define COLIBRI_DISABLE_SIMD (CMake: COLIBRIGUI_DISABLE_SIMD) to
+		leave the SIMD path out of the build.
+	*/
+	namespace Simd
+	{
+#if defined( COLIBRI_SIMD_SSE2 )
+		typedef __m128 float4;
+
+		inline float4 set( float x, float y, float z, float w ) { return _mm_setr_ps( x, y, z, w ); }
+		inline float4 set1( float a ) { return _mm_set1_ps( a ); }
+		inline float4 setBits( uint32_t x, uint32_t y, uint32_t z, uint32_t w )
+		{
+			return _mm_castsi128_ps( _mm_setr_epi32( static_cast<int>( x ), static_cast<int>( y ),
+													 static_cast<int>( z ), static_cast<int>( w ) ) );
+		}
+		inline float4 add( float4 a, float4 b ) { return _mm_add_ps( a, b ); }
+		inline float4 sub( float4 a, float4 b ) { return _mm_sub_ps( a, b ); }
+		inline float4 mul( float4 a, float4 b ) { return _mm_mul_ps( a, b ); }
+		/// Returns a * b + c
+		inline float4 madd( float4 a, float4 b, float4 c ) { return _mm_add_ps( _mm_mul_ps( a, b ), c ); }
+		inline void store( void *dst, float4 a ) { _mm_storeu_ps( reinterpret_cast<float *>( dst ), a ); }
+		inline void transpose( float4 &a, float4 &b, float4 &c, float4 &d )
+		{
+			_MM_TRANSPOSE4_PS( a, b, c, d );
+		}
+#else
+		typedef float32x4_t float4;
+
+		inline float4 set( float x, float y, float z, float w )
+		{
+			const float values[4] = { x, y, z, w };
+			return vld1q_f32( values );
+		}
+		inline float4 set1( float a ) { return vdupq_n_f32( a ); }
+		inline float4 setBits( uint32_t x, uint32_t y, uint32_t z, uint32_t w )
+		{
+			const uint32_t values[4] = { x, y, z, w };
+			return vreinterpretq_f32_u32( vld1q_u32( values ) );
+		}
+		inline float4 add( float4 a, float4 b ) { return vaddq_f32( a, b ); }
+		inline float4 sub( float4 a, float4 b ) { return vsubq_f32( a, b ); }
+		inline float4 mul( float4 a, float4 b ) { return vmulq_f32( a, b ); }
+		/// Returns a * b + c
+		inline float4 madd( float4 a, float4 b, float4 c ) { return vmlaq_f32( c, a, b ); }
+		inline void store( void *dst, float4 a ) { vst1q_f32( reinterpret_cast<float *>( dst ), a ); }
+		inline void transpose( float4 &a, float4 &b, float4 &c, float4 &d )
+		{
+			const float32x4x2_t ab = vtrnq_f32( a, b );  // a0 b0 a2 b2 | a1 b1 a3 b3
+			const float32x4x2_t cd = vtrnq_f32( c, d );  // c0 d0 c2 d2 | c1 d1 c3 d3
+			a = vcombine_f32( vget_low_f32( ab.val[0] ), vget_low_f32( cd.val[0] ) );
+			b = vcombine_f32( vget_low_f32( ab.val[1] ), vget_low_f32( cd.val[1] ) );
+			c = vcombine_f32( vget_high_f32( ab.val[0] ), vget_high_f32( cd.val[0] ) );
+			d = vcombine_f32( vget_high_f32( ab.val[1] ), vget_high_f32( cd.val[1] ) );
+		}
+#endif
+	}  // namespace Simd
+}  // namespace Colibri
+
+#endif
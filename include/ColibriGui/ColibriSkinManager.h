@@ -70,6 +70,17 @@ namespace Colibri
 									   StateInformation &stateInfo,
 									   const char *skinName, const char *filename );
 
+		/** Renderable draws the 3x3 grid with 16 vertices, thus adjacent cells must share
+			their edges in UV space. That holds for skins built with "enclosing" or with
+			contiguous per-cell UVs, but not e.g. for "all".
+		@param stateInfo
+			Its UVs must not have been shrunk by half a texel yet
+		@return
+			Bitmask for StateInformation::unsharedGridCells
+		*/
+		static uint16_t findUnsharedGridCells( const StateInformation &stateInfo,
+											   const Ogre::Vector2 &texResolution );
+
 		void loadSkins( const rapidjson::Value &skinsValue, const char *filename );
 		void loadSkinPacks( const rapidjson::Value &packsValue, const rapidjson::Value &skinsValue,
 							const char *filename );
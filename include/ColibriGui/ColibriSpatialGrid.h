@@ -0,0 +1,107 @@
+
+#pragma once
+
+#include "ColibriGui/ColibriWidget.h"
+
+COLIBRI_ASSUME_NONNULL_BEGIN
+
+namespace Colibri
+{
+	/**
+	@class SpatialGrid
+		Uniform grid over the local rects (m_position, m_size) of the child widgets of a Window.
+		Child windows are not indexed.
+
+		It lets the Window find the children overlapping its visible scroll region
+		(for culling) or the mouse cursor (for hit-testing) without looking at every child,
+		which matters when a window has thousands of them (e.g. a scrolled inventory).
+
+		Children moving or resizing are updated incrementally. Adding, removing or reordering
+		children rebuilds the grid the next time it is queried.
+
+		See Window::setSpatialIndexEnabled
+	*/
+	class SpatialGrid
+	{
+		/// Inclusive range of cells a child was inserted into
+		struct CellRange
+		{
+			uint16_t minX;
+			uint16_t minY;
+			uint16_t maxX;
+			uint16_t maxY;
+
+			bool operator!=( const CellRange &other ) const
+			{
+				return minX != other.minX || minY != other.minY ||  //
+					   maxX != other.maxX || maxY != other.maxY;
+			}
+		};
+
+		typedef std::vector<uint32_t> IndexVec;
+		typedef std::pair<Widget const *, uint32_t> WidgetIndexPair;
+
+		Window *m_window;
+
+		Ogre::Vector2 m_origin;
+		Ogre::Vector2 m_invCellSize;
+		uint16_t      m_numCols;
+		uint16_t      m_numRows;
+
+		/// Each cell contains indices to m_window->getChildren()
+		std::vector<IndexVec> m_cells;
+		/// m_cellRanges[i] is the range m_window->getChildren()[i] was inserted into
+		std::vector<CellRange> m_cellRanges;
+		/// Sorted by pointer, so we can find the index of a child that moved
+		std::vector<WidgetIndexPair> m_childIndices;
+
+		WidgetVec m_movedChildren;
+		IndexVec  m_queryResults;
+
+		/// Children that were not culled in the last fill, in the same order as in m_children
+		WidgetVec m_visibleChildren;
+
+		bool m_needsRebuild;
+		/// When true, the children in m_visibleChildren are no longer
+		/// known and all children must be flagged as culled before filling.
+		bool m_cullAllChildren;
+
+		static bool compareWidgetIndexPair( const WidgetIndexPair &a, const WidgetIndexPair &b );
+
+		inline uint16_t getCell( float value, float origin, float invCellSize, uint16_t numCells ) const;
+		CellRange getCellRange( const Ogre::Vector2 &topLeft, const Ogre::Vector2 &bottomRight ) const;
+
+		void insert( uint32_t childIdx, const CellRange &range );
+		void remove( uint32_t childIdx, const CellRange &range );
+
+		void rebuild();
+		/// Rebuilds the grid or applies pending moves, whatever is needed
+		void update();
+
+	public:
+		SpatialGrid( Window *window );
+
+		/// Must be called when children are added, removed or reordered
+		void _notifyChildrenChanged();
+		/// Must be called when a child's position or size changed
+		void _notifyChildMoved( Widget *child );
+
+		/** Returns the indices (into m_window->getChildren()) of all the child widgets
+			whose rect may be overlapping the input rect, in local space of the window
+			(i.e. same space as Widget::getLocalTopLeft).
+		@remarks
+			The result is sorted in ascending order and contains no duplicates.
+			It is conservative: some returned children may not actually overlap.
+			The returned reference is valid until the next call.
+		*/
+		const std::vector<uint32_t> &query( const Ogre::Vector2 &topLeft,
+											const Ogre::Vector2 &bottomRight );
+
+		/// See m_visibleChildren
+		WidgetVec &_getVisibleChildren() { return m_visibleChildren; }
+		/// Returns m_cullAllChildren, and resets it back to false
+		bool _consumeCullAllChildren();
+	};
+}  // namespace Colibri
+
+COLIBRI_ASSUME_NONNULL_END
@@ -0,0 +1,140 @@
+
+#pragma once
+
+#include "ColibriGui/ColibriWidget.h"
+
+COLIBRI_ASSUME_NONNULL_BEGIN
+
+namespace Colibri
+{
+	class VirtualList;
+
+	/**
+	@class VirtualListDataSource
+		Provides the items a VirtualList displays. See VirtualList::setDataSource
+	*/
+	class VirtualListDataSource
+	{
+	public:
+		virtual ~VirtualListDataSource();
+
+		/// Returns the total number of items. It can be very large
+		virtual size_t getNumItems( VirtualList *list ) = 0;
+
+		/** Creates the widget used to display a row. It must be a child of the list, e.g.
+			@code
+				return manager->createWidget<Button>( list );
+			@endcode
+			Only as many rows as fit in the view (plus overscan) are ever created.
+			They get reused to display other items as the user scrolls.
+		@remarks
+			The list sets the position & size of the row. It also hides rows that are
+			not in use, thus don't rely on the hidden flag of the row.
+		*/
+		virtual Widget *createRow( VirtualList *list ) = 0;
+
+		/// Fills the row with the contents of the given item.
+		/// Called when a row starts displaying a different item, or the item changed.
+		virtual void bindRow( VirtualList *list, Widget *row, size_t itemIdx ) = 0;
+	};
+
+	/** @ingroup Controls
+	@class VirtualList
+		Displays a list with a very large number of items (e.g. leaderboards, logs) where
+		creating a widget per item is not feasible.
+
+		Only the rows that are visible (plus a few above and below, see setOverscan)
+		exist as widgets. As the parent window scrolls, rows that go out of view are
+		reused to display the items coming into view. Thus the cost of scrolling depends
+		on how many rows fit in the view, not on how many items there are.
+
+		The parent must be the Window that scrolls. The list takes care of setting its own
+		height (number of items * row height) and the scrollable area of the window.
+		Set the width of the list via setSize; the height will be overwritten.
+
+		All rows have the same height. They're placed at the top left corner of the list,
+		one below the other, and span its whole width.
+	*/
+	class VirtualList : public Widget
+	{
+		VirtualListDataSource *colibri_nullable m_dataSource;
+
+		float  m_rowHeight;
+		size_t m_overscan;
+		size_t m_numItems;
+
+		/// m_activeRows[i] is displaying item m_firstItem + i
+		size_t    m_firstItem;
+		WidgetVec m_activeRows;
+		/// Rows that aren't displaying anything. They're hidden, waiting to be reused
+		WidgetVec m_freeRows;
+		/// Scratch memory for updateRows
+		WidgetVec m_tmpRows;
+
+		/// Scroll and view size of the parent window, and our width,
+		/// the last time rows were placed. If they change, rows must be updated
+		Ogre::Vector2 m_lastScroll;
+		Ogre::Vector2 m_lastViewSize;
+		float         m_lastWidth;
+
+		/// When true, the number of items changed or the existing items need to be bound again
+		bool m_dataDirty;
+		/// When true, all rows must be placed again (e.g. the row height changed)
+		bool m_layoutDirty;
+
+		Window *getParentWindow();
+
+		/// Updates our size and the scrollable area of the parent window
+		void updateScrollableArea();
+
+		/// Ensures the items in view (plus overscan) have a row and no other item has one
+		void updateRows( bool bRebindAll, bool bRelayoutAll );
+
+		void placeRow( Widget *row, size_t itemIdx );
+
+	public:
+		VirtualList( ColibriManager *manager );
+
+		void _initialize() override;
+		void _destroy() override;
+
+		/// Sets the object that provides the items. Rows created by the previous
+		/// data source are destroyed. Can be null.
+		/// The list doesn't take ownership; it must outlive the list (or be unset).
+		void setDataSource( VirtualListDataSource *colibri_nullable dataSource );
+		VirtualListDataSource *colibri_nullable getDataSource() const { return m_dataSource; }
+
+		/// Sets the height of every row, in virtual canvas units
+		void  setRowHeight( float rowHeight );
+		float getRowHeight() const { return m_rowHeight; }
+
+		/** Sets how many rows are kept above and below the ones in view.
+			Higher values avoid binding rows every time a new item comes into view while
+			scrolling slowly (and allow keyboard navigation to reach the next row
+			before it's visible), at the cost of more widgets.
+			The default is 2.
+		@param numRows
+		*/
+		void   setOverscan( size_t numRows );
+		size_t getOverscan() const { return m_overscan; }
+
+		/// Call this when items were added, removed, or many of them changed.
+		/// The number of items is queried again and all rows will be bound again.
+		void notifyDataChanged();
+		/// Call this when a single item changed. Binds it again if it has a row.
+		void notifyItemChanged( size_t itemIdx );
+
+		size_t getNumItems() const { return m_numItems; }
+
+		/// Returns the row displaying the given item. Null if the item has no row,
+		/// i.e. it is too far from the view.
+		Widget *colibri_nullable getRow( size_t itemIdx ) const;
+
+		/// Scrolls the parent window the least amount needed for the item to be fully in view
+		void scrollToItem( size_t itemIdx, bool bAnimated );
+
+		void _update( float timeSinceLast ) override;
+	};
+}  // namespace Colibri
+
+COLIBRI_ASSUME_NONNULL_END
@@ -66,6 +66,7 @@ namespace Colibri
 		friend class Renderable;
 		friend class Label;
 		friend class LabelBmp;
+		friend class NavigationSearch;
 
 		struct WidgetActionListenerRecord
 		{
@@ -97,6 +98,23 @@ namespace Colibri
 
 		Widget * colibri_nullable	m_nextWidget[Borders::NumBorders];
 		bool							m_autoSetNextWidget[Borders::NumBorders];
+
+		/// Closest keyboard navigable sibling in each direction (only looking at the siblings
+		/// after us) found by the last ColibriManager::autosetNavigation, plus what it was
+		/// computed from. This way the next time it runs, it only searches again around
+		/// the siblings that were added, removed or changed. See NavigationSearch
+		Widget * colibri_nullable	m_navClosest[Borders::NumBorders];
+		float						m_navClosestDistance[Borders::NumBorders];
+		Ogre::Vector2				m_navPosition;
+		Ogre::Vector2				m_navSize;
+		/// Our index among our siblings in the last autosetNavigation.
+		/// std::numeric_limits<uint32_t>::max() if it never ran on us
+		uint32_t					m_navIndex;
+		bool						m_navNavigable;
+		/// Only valid while autosetNavigation runs. True if we're new, moved, resized or
+		/// our navigability changed since the last time
+		bool						m_navChanged;
+
 		bool					m_hidden;
 		/// calculateChildrenSize will ignore a children widgets with this set to true
 		bool m_ignoreFromChildrenSize;
@@ -267,6 +285,22 @@ namespace Colibri
 		void _setParent( Widget *parent );
 		Widget * colibri_nonnull getParent() const				{ return m_parent; }
 
+		/** Flags the root window of our hierarchy so that its vertices get filled again
+			in ColibriManager::prepareRenderCommands. Colibri calls this automatically
+			whenever something affecting the vertices changes (transform, state, colour,
+			skin, text, scroll, etc).
+
+			Custom widgets that alter their visuals behind Colibri's back must call it.
+		*/
+		void _setVisualsDirty();
+
+		/** Flags our root window so that ColibriManager counts again the most vertices
+			it may need. Must be called when a widget is attached or detached, or when
+			the max number of glyphs of a Label or LabelBmp grows.
+			See Window::m_maxVertexCount
+		*/
+		void _setVertexCountsDirty();
+
 		virtual bool isRenderable() const	{ return false; }
 		virtual bool isWindow() const		{ return false; }
 		virtual bool isLabel() const		{ return false; }
@@ -503,8 +537,32 @@ namespace Colibri
 											  const Ogre::Vector2 &parentCurrentScrollPos,
 											  const Matrix2x3 &parentRot );
 	protected:
+		/** Fills the vertices of all our children. Vertices are written in the same order
+			addChildrenCommands will later issue them (depth first or breadth first), so
+			that consecutive widgets sharing the same material end up contiguous in the
+			vertex buffer and can be rendered with a single draw.
+		@param currentScrollPos
+			Our own scroll, in canvas space. See getCurrentScroll
+		@see	Widget::addChildrenCommands
+		*/
+		void fillChildrenBuffers( UiVertex * colibri_nonnull * colibri_nonnull
+								  RESTRICT_ALIAS vertexBuffer,
+								  GlyphVertex * colibri_nonnull * colibri_nonnull
+								  RESTRICT_ALIAS textVertBuffer,
+								  const Ogre::Vector2 &currentScrollPos );
+
 		void addNonRenderableCommands( ApiEncapsulatedObjects &apiObject, bool collectingBreadthFirst );
 
+		/// Returns the spatial index of our children, if we're a Window and it's enabled.
+		/// See Window::setSpatialIndexEnabled
+		SpatialGrid *colibri_nullable getSpatialGrid() const;
+
+		/// Hit-tests the cursor against the given child (and its children) for _setIdleCursorMoved.
+		/// inOutFocusPair is overwritten if the child (or one of its children) is under the cursor.
+		void setIdleCursorMovedOnChild( Widget *widget, const Ogre::Vector2 &newPosNdc,
+										const Ogre::Vector2 &currentScroll,
+										FocusPair &inOutFocusPair );
+
 		/** There are 3 rendering modes we can idenfity:
 			1. Depth First. This guarantees Widgets are rendered in correct order.
 			2. Executor Breadth First. When this->m_breadthFirst is set, this widget
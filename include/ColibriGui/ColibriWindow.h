@@ -18,6 +18,7 @@ namespace Colibri
 	class Window : public Renderable
 	{
 		friend class ColibriManager;
+		friend class Widget;
 
 		Ogre::Vector2 m_currentScroll;
 		/// For smooth scrolling, m_nextScroll contains the scroll destination,
@@ -37,9 +38,33 @@ namespace Colibri
 		/// When true, all of our immediate children (widgets or windows)
 		/// are not dirty, but one of our children's child is.
 		bool		m_childrenNavigationDirty;
+		/// Child widgets destroyed since the last time their navigation was updated.
+		/// Dangling pointers: only to be compared against. See ColibriManager::autosetNavigation
+		WidgetVec	m_removedNavigationWidgets;
+
+		/// When true, this window or one of its children changed in a way that affects
+		/// its vertices, and thus must be filled again in prepareRenderCommands.
+		/// Only meaningful on windows without a parent. See Widget::_setVisualsDirty
+		bool		m_visualsDirty;
+		/// Range of vertices (UI and text) this window and all its children were
+		/// filled into the last time. If the window is not dirty and its range
+		/// still starts at the same location, the range is reused as is.
+		uint32_t	m_vertexStart;
+		uint32_t	m_vertexCount;
+		uint32_t	m_textVertexStart;
+		uint32_t	m_textVertexCount;
+		/// Upper bound of the vertices (UI and text) this window and all its children
+		/// may write. Used to reserve its range when filling windows in parallel.
+		/// Only meaningful on windows without a parent. See Widget::_setVertexCountsDirty
+		uint32_t	m_maxVertexCount;
+		uint32_t	m_maxTextVertexCount;
+		bool		m_maxVertexCountsDirty;
 
 		WindowVec m_childWindows;
 
+		/// See setSpatialIndexEnabled
+		SpatialGrid *colibri_nullable m_spatialGrid;
+
 		Widget *colibri_nullable m_arrows[Borders::NumBorders];
 		bool                            m_scrollArrowsVisibility[Borders::NumBorders];
 		float                           m_scrollArrowProportion[Borders::NumBorders];
@@ -62,6 +87,15 @@ namespace Colibri
 		void evaluateScrollArrowVisibility( Borders::Borders border );
 		void createScrollArrow( Borders::Borders border );
 
+		/// Returns the indices of the child widgets that may be under the given
+		/// position. See SpatialGrid::query
+		/// Only valid if canQueryChildrenAt returns true
+		const std::vector<uint32_t> &queryChildrenAt( const Ogre::Vector2 &posNdc );
+
+		/// The spatial grid only knows about translation & scale. Returns false if we (or
+		/// a parent) are rotated, in which case all children must be tested one by one
+		bool canQueryChildrenAt() const;
+
 	public:
 		Window( ColibriManager *manager );
 		~Window() override;
@@ -187,6 +221,26 @@ namespace Colibri
 		void setConsumeCursor( bool bConsumeCursor ) { m_clickable = bConsumeCursor; }
 		bool getConsumeCursor() const { return m_clickable; }
 
+		/** When enabled, the window keeps a uniform grid over the rects of its child widgets,
+			so that culling and cursor hit-testing only look at the children overlapping the
+			visible scroll region or the cursor, instead of every child.
+
+			Worth it for windows with many children of which only a few are visible at a time
+			(e.g. a scrolled inventory with thousands of slots). For windows with few
+			children it's just overhead.
+
+			The grid is updated incrementally when children move or get resized, and
+			rebuilt when children are added, removed or reordered.
+
+			The default value is false.
+		@remarks
+			Child windows are not indexed and are always visited.
+			Breadth first windows (see Widget::setBreadthFirst) don't use the grid for culling.
+		@param bEnabled
+		*/
+		void setSpatialIndexEnabled( bool bEnabled );
+		bool getSpatialIndexEnabled() const { return m_spatialGrid != 0; }
+
 		void _updateDerivedTransformOnly( const Ogre::Vector2 &parentPos,
 										  const Matrix2x3     &parentRot ) override;
 
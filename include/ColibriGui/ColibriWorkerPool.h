@@ -0,0 +1,87 @@
+
+#pragma once
+
+#include "ColibriGui/ColibriGuiPrerequisites.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+COLIBRI_ASSUME_NONNULL_BEGIN
+
+namespace Colibri
+{
+	/**
+	@class WorkerPool
+		Interface ColibriManager uses to spread work across threads.
+		Implement it to route the work through your own job system, or use DefaultWorkerPool.
+
+		See ColibriManager::setWorkerPool
+	*/
+	class WorkerPool
+	{
+	public:
+		class Job
+		{
+		public:
+			virtual ~Job();
+
+			/// Jobs of the same parallelFor may be executed concurrently from different threads
+			virtual void execute( size_t jobIdx ) = 0;
+		};
+
+		virtual ~WorkerPool();
+
+		/** Calls job->execute( i ) for every i in range [0; numJobs), in any order and from any
+			thread (including the caller's).
+		@remarks
+			Must not return until all of them have finished.
+		*/
+		virtual void parallelFor( Job *job, size_t numJobs ) = 0;
+	};
+
+	/**
+	@class DefaultWorkerPool
+		Simple built-in WorkerPool. Threads are created once and sleep while there is no work.
+		The thread calling parallelFor also executes jobs.
+	*/
+	class DefaultWorkerPool final : public WorkerPool
+	{
+		std::vector<std::thread> m_threads;
+
+		std::mutex				m_mutex;
+		std::condition_variable m_workAvailable;
+		std::condition_variable m_workFinished;
+
+		Job * colibri_nullable m_job;
+		size_t		m_numJobs;
+		size_t		m_nextJob;
+		size_t		m_numJobsPending;
+		/// Incremented every parallelFor, so that sleeping threads know there's new work
+		uint32_t	m_generation;
+		bool		m_exit;
+
+		void workerThread();
+
+		/// Executes jobs from the current parallelFor until there are none left to start.
+		/// lock must own m_mutex, and still owns it on return.
+		void executeJobs( std::unique_lock<std::mutex> &lock );
+
+	public:
+		/**
+		@param numThreads
+			Number of threads to create, without counting the thread calling parallelFor.
+			Use std::numeric_limits<size_t>::max() to use std::thread::hardware_concurrency() - 1.
+			0 means everything runs on the calling thread.
+		*/
+		DefaultWorkerPool( size_t numThreads );
+		~DefaultWorkerPool() override;
+
+		size_t getNumThreads() const { return m_threads.size(); }
+
+		void parallelFor( Job *job, size_t numJobs ) override;
+	};
+}  // namespace Colibri
+
+COLIBRI_ASSUME_NONNULL_END
@@ -22,23 +22,48 @@ namespace Ogre
 	class ColibriOgreRenderable : public MovableObject, public Renderable
 	{
 	public:
-		static VertexArrayObject* createVao( uint32 vertexCount, VaoManager *vaoManager );
+		static VertexArrayObject* createVao( uint32 vertexCount, IndexBufferPacked *indexBuffer,
+											 VaoManager *vaoManager );
 		static VertexArrayObject* createTextVao( uint32 vertexCount, VaoManager *vaoManager );
+		/** Creates a Vao without index buffer that reads from the same vertex buffer as 'vao'.
+			Used by widgets with an arbitrary number of vertices (e.g. LabelBmp)
+			which can't use the shared 9-slice index buffer.
+		@remarks
+			Must be destroyed with destroySharedVao, *before* 'vao' is destroyed.
+		*/
+		static VertexArrayObject* createUnindexedVao( VertexArrayObject *vao,
+													  VaoManager *vaoManager );
+		/** Creates an immutable Vao with the 54 vertices of one 9-slice grid, shared by all
+			instanced widgets. Each vertex only stores its column & row (0..3) in the 4x4 grid
+			in its position, the rest is read from the widget's Colibri::UiInstance record.
+		*/
+		static VertexArrayObject* createInstancedVao( VaoManager *vaoManager );
 		static void destroyVao( VertexArrayObject *vao, VaoManager *vaoManager );
+		/// Destroys a Vao created with createUnindexedVao. The vertex buffer is left untouched.
+		static void destroySharedVao( VertexArrayObject *vao, VaoManager *vaoManager );
 	protected:
 		void setVao( VertexArrayObject *vao );
 
+		/** Toggles the magic custom parameter that tells HlmsColibri to expand our
+			9-slice grid in the vertex shader. Reassigns the datablock so the change
+			is accounted in our hash.
+		*/
+		void setInstanced( bool bInstanced );
+
 	public:
 		ColibriOgreRenderable( IdType id, ObjectMemoryManager *objectMemoryManager,
 							   SceneManager* manager, uint8 renderQueueId,
 							   Colibri::ColibriManager *colibriManager );
 		virtual ~ColibriOgreRenderable();
 
-		/** Creates a prefilled index buffer to be used & reused for rendering.
+		/** Creates a prefilled index buffer to be used & reused for rendering
+			all regular widgets (16 vertices laid out as a 4x4 grid each).
 		@param vaoManager
 		@return
+			Immutable 16-bit index buffer with 6 * 9 indices per widget,
+			large enough for 65536 / 16 widgets per draw.
 		*/
-		//static Ogre::IndexBufferPacked* createIndexBuffer( VaoManager *vaoManager );
+		static Ogre::IndexBufferPacked* createIndexBuffer( VaoManager *vaoManager );
 
 		//Overrides from MovableObject
 		virtual const String& getMovableType(void) const;
@@ -32,12 +32,17 @@ namespace Ogre
 
 		bool mSetsResolution;
 		AspectRatioMode mAspectRatioMode;
+		/// When true, the pass does nothing on frames where ColibriManager::needsRedraw
+		/// returns false. Only use it if the render target keeps the last UI image
+		/// (i.e. it's a texture dedicated to the UI that isn't cleared every frame).
+		bool mSkipWhenClean;
 
 	public:
 		CompositorPassColibriGuiDef( CompositorTargetDef *parentTargetDef ) :
 			CompositorPassDef( PASS_CUSTOM, parentTargetDef ),
 			mSetsResolution( true ),
-			mAspectRatioMode( ArNone )
+			mAspectRatioMode( ArNone ),
+			mSkipWhenClean( false )
 		{
 			mProfilingId = "Colibri Gui";
 
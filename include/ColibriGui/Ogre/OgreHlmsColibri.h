@@ -48,6 +48,11 @@ namespace Ogre
 		UI widget, and "6373" for text widgets. We only look for the presence of the key, and we
 		don't care about the value.
 
+		Two more magic numbers refine the UI widget path: "6374" for widgets whose vertices
+		are not indexed (LabelBmp), and "6375" for widgets rendered as instances (see
+		Colibri::ColibriManager::setInstancedWidgets) whose 9-slice grid is expanded in
+		the vertex shader from one Colibri::UiInstance record.
+
 		This works because basically all UI widgets follow a different path from regular Unlit,
 		and all text widgets follow a different path from the other two (so there's a total of 3 paths).
 
@@ -59,10 +64,19 @@ namespace Ogre
 	*/
 	class HlmsColibri : public HlmsUnlit
     {
+	public:
+		/// Maximum number of pages of the glyph atlas the text shaders can read from
+		static const size_t MaxGlyphAtlasPages = 4u;
+
 	protected:
 		// It's ReadOnlyBufferPacked on Mali
 		// It's TexBufferPacked everywhere else
-		BufferPacked *mGlyphAtlasBuffer;
+		// Unused pages are null
+		BufferPacked *mGlyphAtlasBuffers[MaxGlyphAtlasPages];
+		// Holds Colibri::UiInstance records. Same buffer type rules as mGlyphAtlasBuffer
+		BufferPacked *mInstanceBuffer;
+		// See Colibri::ShaperManager::setGlyphSdfReferenceSize
+		bool mGlyphSdf;
 
 #if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
 		virtual void setupRootLayout( RootLayout &rootLayout );
@@ -86,13 +100,28 @@ namespace Ogre
 					 HlmsTypes type, const String &typeName );
 		virtual ~HlmsColibri();
 
-		void setGlyphAtlasBuffer( BufferPacked *texBuffer );
+		void setGlyphAtlasBuffer( size_t pageIdx, BufferPacked *texBuffer );
+
+		/// Returns the texture slot used by each page of the glyph atlas.
+		/// Slot 3 is skipped because the instance buffer uses it.
+		static uint16 getGlyphAtlasSlot( size_t pageIdx );
+		void setInstanceBuffer( BufferPacked *texBuffer );
+
+		/// When true, text shaders treat the glyph atlas as distance fields.
+		/// Only affects text created afterwards. See Colibri::ShaperManager::setGlyphSdfReferenceSize
+		void setGlyphSdf( bool bSdf );
+		bool getGlyphSdf() const { return mGlyphSdf; }
 
 		/// Returns true if the GPU supports TexBufferPacked sizes so small
 		/// that we need a ReadOnlyBuffer instead.
 		static bool needsReadOnlyBuffer( const RenderSystemCapabilities *caps,
 										 const VaoManager               *vaoManager );
 
+		/**
+		@param baseVertex
+			For instanced widgets, it's the index (in float4 units) to the widget's
+			Colibri::UiInstance record in the instance buffer instead.
+		*/
 		uint32 fillBuffersForColibri( const HlmsCache *cache,
 									  const QueuedRenderable &queuedRenderable,
 									  bool casterPass, uint32 baseVertex,
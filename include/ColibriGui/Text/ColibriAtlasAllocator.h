@@ -0,0 +1,79 @@
+
+#pragma once
+
+#include "ColibriGui/ColibriGuiPrerequisites.h"
+
+#include <map>
+#include <set>
+
+COLIBRI_ASSUME_NONNULL_BEGIN
+
+namespace Colibri
+{
+	/**
+	@class AtlasAllocator
+		Manages the space of a linear buffer (the glyph atlas) in bytes.
+
+		Space is taken from the end of the used region (a bump pointer) unless a block
+		freed earlier can hold it, in which case the smallest such block is used (best fit).
+
+		Free blocks are indexed both by offset and by size, thus allocating and freeing
+		is O(log N) where N is the number of free blocks. Freed blocks are merged with
+		their free neighbours immediately, and given back to the bump pointer if they're
+		at the end of the used region, so fragments don't accumulate over time.
+	*/
+	class AtlasAllocator
+	{
+		/// Key is offset, value is size
+		typedef std::map<size_t, size_t> FreeBlockMap;
+		/// Pairs of size & offset
+		typedef std::set<std::pair<size_t, size_t> > FreeBlockSet;
+
+		FreeBlockMap m_freeByOffset;
+		FreeBlockSet m_freeBySize;
+		size_t       m_freeBytes;
+
+		size_t m_offsetPtr;
+		size_t m_capacity;
+
+		void addFreeBlock( size_t offset, size_t sizeBytes );
+		void removeFreeBlock( FreeBlockMap::iterator itor );
+
+	public:
+		/**
+		@param reservedBytes
+			Bytes at the beginning of the buffer that are never handed out
+		*/
+		AtlasAllocator( size_t reservedBytes );
+
+		/** Finds space for sizeBytes
+		@param sizeBytes
+			Zero-sized allocations always succeed and don't take space
+		@param outOffset [out]
+			Offset to the start of the allocation
+		@return
+			False if there is no space left. Grow the capacity and try again.
+		*/
+		bool allocate( size_t sizeBytes, size_t &outOffset );
+
+		/// Returns space taken with allocate
+		void deallocate( size_t offset, size_t sizeBytes );
+
+		/// Returns true if allocate( sizeBytes ) would succeed
+		bool canAllocate( size_t sizeBytes ) const;
+
+		/// Sets the size of the buffer. Can only grow it
+		void   setCapacity( size_t capacity );
+		size_t getCapacity() const { return m_capacity; }
+
+		/// Everything at or after this offset is free
+		size_t getUsedEnd() const { return m_offsetPtr; }
+
+		/// Returns the number of free blocks before the used end. Useful to measure fragmentation
+		size_t getNumFreeBlocks() const { return m_freeByOffset.size(); }
+		/// Returns the total size of free blocks before the used end
+		size_t getFreeBlockBytes() const { return m_freeBytes; }
+	};
+}  // namespace Colibri
+
+COLIBRI_ASSUME_NONNULL_END
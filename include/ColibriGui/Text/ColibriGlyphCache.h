@@ -0,0 +1,115 @@
+
+#pragma once
+
+#include "ColibriGui/ColibriGuiPrerequisites.h"
+
+#include <vector>
+
+COLIBRI_ASSUME_NONNULL_BEGIN
+
+namespace Colibri
+{
+	struct CachedGlyph
+	{
+		uint32_t codepoint;
+		uint32_t ptSize;
+		/// The upper 8 bits are the page of the atlas, the rest the offset in bytes in that page
+		uint32_t offsetStart;
+		float bearingX;
+		float bearingY;
+		uint16_t width;
+		uint16_t height;
+		float newlineSize;
+		float regionUp;
+		uint16_t font;
+		uint32_t refCount;
+
+		/// Intrusive list of unreferenced glyphs (refCount == 0), owned by GlyphCache.
+		/// Also used to chain free slots. Don't touch.
+		CachedGlyph *colibri_nullable lruPrev;
+		CachedGlyph *colibri_nullable lruNext;
+
+		size_t getSizeBytes() const;
+
+		uint32_t getAtlasPage() const { return offsetStart >> 24u; }
+		uint32_t getOffsetInPage() const { return offsetStart & 0xFFFFFFu; }
+
+		bool isCodepointInPrivateArea() const;
+
+		/*bool operator < ( const CachedGlyph &other ) const;
+		friend bool operator < ( const CachedGlyph &a, const uint64_t &codePointSize );
+		friend bool operator < ( const uint64_t &codePointSize, const CachedGlyph &b );*/
+	};
+
+	/**
+	@class GlyphCache
+		Storage of all the CachedGlyph of ShaperManager, keyed by codepoint, ptSize and font.
+
+		Lookups use an open addressing hash table (linear probing, backward shift deletion)
+		instead of a tree, since acquiring & releasing glyphs happens for every glyph of every
+		string that gets shaped.
+
+		Glyphs with refCount == 0 are kept in a list sorted by the time they were released,
+		so finding which glyph to evict when the atlas runs out of space is O(1).
+		Always change CachedGlyph::refCount through addRef & release so that the list
+		stays in sync.
+
+		Pointers to glyphs remain valid until they're erased.
+	*/
+	class GlyphCache
+	{
+		/// Slots of the hash table. Null means empty. Size is always a power of 2
+		std::vector<CachedGlyph *> m_table;
+		size_t                     m_numGlyphs;
+
+		/// Glyphs are allocated in blocks so that pointers to them are stable
+		std::vector<CachedGlyph *>    m_blocks;
+		CachedGlyph *colibri_nullable m_freeSlots;
+
+		/// Least recently released glyph is m_lruFirst
+		CachedGlyph *colibri_nullable m_lruFirst;
+		CachedGlyph *colibri_nullable m_lruLast;
+		size_t                        m_numUnreferenced;
+
+		static size_t hash( uint32_t codepoint, uint32_t ptSize, uint32_t font );
+
+		/// Returns the slot where the glyph is, or the empty slot where it should go
+		size_t findSlot( uint32_t codepoint, uint32_t ptSize, uint32_t font ) const;
+
+		void rehash( size_t newCapacity );
+
+		void lruPushBack( CachedGlyph *glyph );
+		void lruRemove( CachedGlyph *glyph );
+
+	public:
+		GlyphCache();
+		~GlyphCache();
+
+		/// Returns null if not found
+		CachedGlyph *colibri_nullable find( uint32_t codepoint, uint32_t ptSize,
+											uint32_t font ) const;
+
+		/// Adds a copy of the glyph to the cache. There must not be a glyph with the same
+		/// codepoint, ptSize & font already. Its refCount must be 0, thus it starts as the
+		/// most recently released glyph.
+		CachedGlyph *insert( const CachedGlyph &glyph );
+
+		/// Removes the glyph from the cache. The pointer is no longer valid afterwards
+		void erase( CachedGlyph *glyph );
+
+		void addRef( CachedGlyph *glyph );
+		void release( CachedGlyph *glyph );
+
+		/// Returns the unreferenced glyph that has been released for the longest time.
+		/// Null if all glyphs are in use.
+		CachedGlyph *colibri_nullable getLeastRecentlyUsed() const { return m_lruFirst; }
+
+		/// Appends all glyphs in the cache to outGlyphs, in no particular order
+		void getAllGlyphs( std::vector<const CachedGlyph *> &outGlyphs ) const;
+
+		size_t getNumGlyphs() const { return m_numGlyphs; }
+		size_t getNumUnreferenced() const { return m_numUnreferenced; }
+	};
+}  // namespace Colibri
+
+COLIBRI_ASSUME_NONNULL_END
@@ -0,0 +1,54 @@
+
+#pragma once
+
+#include "ColibriGui/ColibriGuiPrerequisites.h"
+
+#include <vector>
+
+COLIBRI_ASSUME_NONNULL_BEGIN
+
+namespace Colibri
+{
+	/**
+	@class GlyphSdf
+		Turns a rasterized (anti-aliased) glyph into a signed distance field, so that it
+		can be drawn at any size from a single atlas entry.
+
+		Uses an exact Euclidean distance transform (Felzenszwalb & Huttenlocher) seeded
+		with the coverage of edge pixels, which is O(N) and doesn't need FreeType's
+		own SDF renderer (FreeType >= 2.11).
+	*/
+	class GlyphSdf
+	{
+		std::vector<float>    m_gridOuter;
+		std::vector<float>    m_gridInner;
+		std::vector<float>    m_f;
+		std::vector<float>    m_z;
+		std::vector<uint32_t> m_v;
+
+		/// Transforms a 1D squared distance function in-place
+		void edt1d( float *grid, size_t offset, size_t stride, size_t length );
+		/// Transforms grid (squared distances) in-place
+		void edt( std::vector<float> &grid, size_t width, size_t height );
+
+	public:
+		/** Generates the distance field
+		@param coverage
+			Glyph bitmap. 0 is outside, 255 is inside
+		@param width
+		@param height
+		@param pitch
+			Bytes between rows of coverage
+		@param spread
+			Distance in pixels at which the field saturates. The output is
+			padded by this many pixels in every direction
+		@param outSdf [out]
+			( width + 2 * spread ) * ( height + 2 * spread ) bytes. 128 is the edge of
+			the glyph, higher values are inside
+		*/
+		void generate( const uint8_t *colibri_nullable coverage, size_t width, size_t height,
+					   int32_t pitch, size_t spread, std::vector<uint8_t> &outSdf );
+	};
+}  // namespace Colibri
+
+COLIBRI_ASSUME_NONNULL_END
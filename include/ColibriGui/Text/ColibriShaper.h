@@ -2,6 +2,7 @@
 #pragma once
 
 #include "ColibriGui/ColibriGuiPrerequisites.h"
+#include "ColibriGui/Text/ColibriGlyphCache.h"
 #include "OgreVector2.h"
 
 #include "hb.h"
@@ -37,6 +38,16 @@ namespace Colibri
 		uint32_t clusterStart;
 		uint32_t clusterLength;
 		CachedGlyph const *glyph;
+		/// The metrics of glyph must be multiplied by this. It's 1 unless the glyph was
+		/// rasterized at a different size (see ShaperManager::setGlyphSdfReferenceSize)
+		float glyphScale;
+
+		float getBearingX() const { return glyph->bearingX * glyphScale; }
+		float getBearingY() const { return glyph->bearingY * glyphScale; }
+		/// Size on screen. The size in the atlas is glyph->width
+		float getWidth() const { return glyph->width * glyphScale; }
+		float getHeight() const { return glyph->height * glyphScale; }
+		float getNewlineSize() const { return glyph->newlineSize * glyphScale; }
 	};
 	typedef std::vector<ShapedGlyph> ShapedGlyphVec;
 
@@ -62,6 +73,11 @@ namespace Colibri
 		FontSize	m_ptSize; //Font size in points
 		uint16_t	m_fontIdx;
 
+		std::string	m_fontLocation;
+		/// 0 if the font file couldn't be read
+		uint64_t	m_fontFileHash;
+		bool		m_fontFileHashCalculated;
+
 		size_t renderWithSubstituteFont( const uint16_t *utf16Str, size_t stringLength,
 										 hb_direction_t dir, uint32_t richTextIdx,
 										 uint32_t clusterOffset, ShapedGlyphVec &outShapes,
@@ -79,6 +95,17 @@ namespace Colibri
 		void setFontSize( FontSize ptSize );
 		FontSize getFontSize() const;
 
+		/// Index used to identify this font in the glyph cache
+		uint16_t getFontIdx() const { return m_fontIdx; }
+		FT_Face getFreeTypeFace() const { return m_ftFont; }
+		/// Path the font was loaded from
+		const std::string &getFontLocation() const { return m_fontLocation; }
+
+		/// Returns a hash of the contents of the font file. It's calculated the first
+		/// time this is called, which requires reading the whole file.
+		/// Returns 0 if the file couldn't be read.
+		uint64_t getFontFileHash();
+
 		size_t renderString( const uint16_t *utf16Str, size_t stringLength, hb_direction_t dir,
 							 uint32_t richTextIdx, uint32_t clusterOffset, ShapedGlyphVec &outShapes,
 							 bool &bOutHasPrivateUse, bool substituteIfNotFound );
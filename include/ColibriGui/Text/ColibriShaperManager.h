@@ -2,11 +2,15 @@
 #pragma once
 
 #include "ColibriGui/ColibriGuiPrerequisites.h"
+#include "ColibriGui/Text/ColibriAtlasAllocator.h"
+#include "ColibriGui/Text/ColibriGlyphCache.h"
+#include "ColibriGui/Text/ColibriGlyphSdf.h"
+#include "ColibriGui/Text/ColibriShapingCache.h"
 
 #include "OgrePrerequisites.h"
 
-#include <vector>
 #include <map>
+#include <vector>
 #include <string>
 
 COLIBRI_ASSUME_NONNULL_BEGIN
@@ -22,6 +26,7 @@ namespace Ogre
 {
 	class BufferPacked;
 	class HlmsColibri;
+	class StagingBuffer;
 	class VaoManager;
 }
 
@@ -31,29 +36,6 @@ namespace Ogre
 
 namespace Colibri
 {
-	struct CachedGlyph
-	{
-		uint32_t codepoint;
-		uint32_t ptSize;
-		uint32_t offsetStart;
-		float bearingX;
-		float bearingY;
-		uint16_t width;
-		uint16_t height;
-		float newlineSize;
-		float regionUp;
-		uint16_t font;
-		uint32_t refCount;
-
-		size_t getSizeBytes() const;
-
-		bool isCodepointInPrivateArea() const;
-
-		/*bool operator < ( const CachedGlyph &other ) const;
-		friend bool operator < ( const CachedGlyph &a, const uint64_t &codePointSize );
-		friend bool operator < ( const uint64_t &codePointSize, const CachedGlyph &b );*/
-	};
-
 	typedef std::vector<ShapedGlyph> ShapedGlyphVec;
 
 	class ShaperManager
@@ -62,51 +44,97 @@ namespace Colibri
 		typedef std::vector<Shaper *>  ShaperVec;
 		typedef std::vector<BmpFont *> BmpFontVec;
 
+		struct AtlasUploadStats
+		{
+			/// Number of ranges of glyph data that changed (before merging them)
+			size_t numDirtyRanges;
+			/// Number of copies issued to the GPU buffers (after merging them)
+			size_t numCopies;
+			/// Bytes copied, including the gaps between merged ranges
+			size_t numBytes;
+
+			AtlasUploadStats() : numDirtyRanges( 0u ), numCopies( 0u ), numBytes( 0u ) {}
+		};
+
+		struct ShapingCacheStats
+		{
+			/// Calls to renderString that reused a cached result
+			size_t numHits;
+			/// Calls to renderString that had to shape the string
+			size_t numMisses;
+
+			ShapingCacheStats() : numHits( 0u ), numMisses( 0u ) {}
+		};
+
 	protected:
 		struct Range
 		{
 			size_t	offset;
 			size_t	size;
+
+			bool operator < ( const Range &other ) const { return offset < other.offset; }
 		};
-		struct GlyphKey
+		FT_Library	m_ftLibrary;
+		ColibriManager	*m_colibriManager;
+
+		GlyphCache	m_glyphCache;
+
+		typedef std::vector<Range> RangeVec;
+
+		/// The glyph atlas is split in pages, each one its own GPU buffer.
+		/// Growing means adding a page, so existing glyphs are never moved nor uploaded again.
+		struct AtlasPage
+		{
+			uint8_t			*data;
+			AtlasAllocator	allocator;
+			RangeVec		dirtyRanges; //NOT sorted?
+			Ogre::BufferPacked *colibri_nullable buffer;
+			/// Glyphs that live in this page, keyed by their offset in the page.
+			/// Used by compactAtlas to find the glyphs at the end of the page
+			std::map<uint32_t, CachedGlyph *> glyphsByOffset;
+
+			AtlasPage() : data( 0 ), allocator( 1u ), buffer( 0 ) {}
+		};
+		typedef std::vector<AtlasPage> AtlasPageVec;
+
+		AtlasPageVec	m_atlasPages;
+		size_t			m_atlasPageSize;
+
+		/// Kept across frames so the same (persistently mapped, ring buffer)
+		/// staging memory is reused for every upload
+		Ogre::StagingBuffer *colibri_nullable m_atlasStagingBuffer;
+		AtlasUploadStats	m_lastAtlasUploadStats;
+		AtlasUploadStats	m_totalAtlasUploadStats;
+
+		struct PrewarmGlyph
 		{
 			uint32_t codepoint;
 			uint32_t ptSize;
-			uint32_t fontIdx;
-			GlyphKey( uint32_t _codepoint, uint32_t _ptSize, uint32_t _fontIdx ) :
-				codepoint( _codepoint ), ptSize( _ptSize ), fontIdx( _fontIdx )
-			{
-				COLIBRI_ASSERT_MEDIUM( fontIdx != 0 );
-			}
-
-			bool operator < ( const GlyphKey &other ) const
-			{
-				if( this->codepoint != other.codepoint )
-					return this->codepoint < other.codepoint;
-
-				if( this->ptSize != other.ptSize )
-					return this->ptSize < other.ptSize;
-
-				if( this->fontIdx != other.fontIdx )
-					return this->fontIdx < other.fontIdx;
-
-				return false;
-			}
+			uint16_t font;
 		};
+		typedef std::vector<PrewarmGlyph> PrewarmGlyphVec;
 
-		FT_Library	m_ftLibrary;
-		ColibriManager	*m_colibriManager;
+		/// When non-zero, all glyphs are rasterized at this size as distance fields
+		FontSize	m_sdfReferenceSize;
+		GlyphSdf	m_glyphSdf;
+		std::vector<uint8_t> m_sdfScratch;
 
-		typedef std::map<GlyphKey, CachedGlyph> CachedGlyphMap;
-		CachedGlyphMap	m_glyphCache;
+		/// Glyphs requested via queueGlyphPrewarm. font is an index to m_shapers
+		PrewarmGlyphVec	m_prewarmQueue;
 
-		typedef std::vector<Range> RangeVec;
+		/// Results of renderString, shared by all Labels. See setShapingCacheLimits
+		ShapingCache		m_shapingCache;
+		size_t				m_shapingCacheMaxEntries;
+		size_t				m_shapingCacheMaxGlyphs;
+		ShapingCacheStats	m_shapingCacheStats;
+
+		/// See setSimpleTextFastPath
+		bool					m_simpleTextFastPath;
+		std::vector<uint16_t>	m_utf16Scratch;
 
-		uint8_t		*m_glyphAtlas;
-		RangeVec	m_freeRanges; //NOT sorted
-		size_t		m_offsetPtr;
-		size_t		m_atlasCapacity;
-		RangeVec	m_dirtyRanges; //NOT sorted?
+		/// Bytes compactAtlas may move every frame. 0 to disable
+		size_t	m_atlasCompactionBudget;
+		std::vector<const CachedGlyph *> m_relocatedGlyphs;
 
 		VertReadingDir::VertReadingDir m_preferredVertReadingDir;
 
@@ -123,19 +151,41 @@ namespace Colibri
 
 		uint32_t m_dpi;
 
-		Ogre::BufferPacked *colibri_nullable m_glyphAtlasBuffer;
 		Ogre::HlmsColibri *colibri_nullable  m_hlms;
 		Ogre::VaoManager *colibri_nullable   m_vaoManager;
 
-		void growAtlas( size_t sizeBytes );
-		size_t getAtlasOffset( size_t sizeBytes );
+		void addAtlasPage( size_t sizeBytes );
+		/// The last page must not contain glyphs
+		void removeLastAtlasPage();
+		/// Last resort when there are no pages left to add. Requires reuploading the page
+		void growLastAtlasPage( size_t sizeBytes );
+		bool canAllocateFromAtlas( size_t sizeBytes ) const;
+		/// Returns true on success. outOffset is encoded as in CachedGlyph::offsetStart
+		bool allocateFromAtlas( size_t sizeBytes, uint32_t &outOffset );
+		/// Returns an offset encoded as in CachedGlyph::offsetStart.
+		/// Returns std::numeric_limits<uint32_t>::max() if the atlas can't hold it.
+		uint32_t getAtlasOffset( size_t sizeBytes );
+		void destroyAtlasBuffer( Ogre::BufferPacked *buffer );
+		/// Sorts the ranges and merges the ones closer than gapTolerance bytes
+		static void mergeDirtyRanges( RangeVec &inOutRanges, size_t gapTolerance );
+		/** Places a rasterized glyph in the atlas and adds it to the cache
+		@param newGlyph
+			Everything but offsetStart, font & refCount must be filled
+		@param bitmap
+			newGlyph.getSizeBytes() bytes of pixel data
+		*/
+		CachedGlyph *addGlyph( CachedGlyph &newGlyph, uint16_t fontIdx,
+							   const uint8_t *colibri_nullable bitmap );
 		CachedGlyph *createGlyph( FT_Face font, uint32_t codepoint, uint32_t ptSize, uint16_t fontIdx,
 								  bool bDummy );
 		/// Used only for private areas
 		CachedGlyph *createRasterGlyph( FT_Face font, uint32_t codepoint, uint32_t ptSize,
 										uint16_t fontIdx );
-		void         destroyGlyph( CachedGlyphMap::iterator glyphIt );
-		void mergeContiguousBlocks( RangeVec::iterator blockToMerge, RangeVec &blocks );
+		void         destroyGlyph( CachedGlyph *glyph );
+
+		/// Evicts least recently used entries of m_shapingCache until there are no more
+		/// than maxEntries & maxGlyphs, releasing their glyphs
+		void trimShapingCache( size_t maxEntries, size_t maxGlyphs );
 
 	public:
 		ShaperManager( ColibriManager *colibriManager );
@@ -144,6 +194,17 @@ namespace Colibri
 		void setOgre( Ogre::HlmsColibri * colibri_nullable hlms,
 					  Ogre::VaoManager * colibri_nullable vaoManager );
 
+		/** Sets the size in bytes of each page of the glyph atlas. A new page is added
+			when the existing ones are full, thus bigger pages mean less pages but
+			more memory wasted in the last one.
+			Only affects pages created afterwards.
+		@param pageSize
+			Must be less than 16MB. Default is 4MB.
+		*/
+		void   setGlyphAtlasPageSize( size_t pageSize );
+		size_t getGlyphAtlasPageSize() const { return m_atlasPageSize; }
+		size_t getNumGlyphAtlasPages() const { return m_atlasPages.size(); }
+
 		void     setDPI( uint32_t dpi );
 		uint32_t getDPI() const { return m_dpi; }
 
@@ -212,6 +273,62 @@ namespace Colibri
 
 		void flushReleasedGlyphs();
 
+		/** Queues glyphs to be rasterized ahead of time by prewarmQueuedGlyphs, so that
+			the first time a Label shows them doesn't stall on rasterization.
+			Useful at startup or on level load with the character sets that are known
+			to be needed (digits, Latin-1, the strings of the current language, etc).
+		@param font
+			Index to getShapers(). 0 is the default font
+		@param ptSize
+			Size in points, as in RichText::ptSize
+		@param firstCodepoint
+			First codepoint (UTF-32) of the range
+		@param lastCodepoint
+			Last codepoint of the range, inclusive
+		*/
+		void queueGlyphPrewarm( uint16_t font, FontSize ptSize, uint32_t firstCodepoint,
+								uint32_t lastCodepoint );
+		/// Queues every codepoint in utf8Str. See the other overload
+		void queueGlyphPrewarm( uint16_t font, FontSize ptSize, const char *utf8Str );
+
+		/** Rasterizes all glyphs queued with queueGlyphPrewarm that aren't cached yet, and
+			puts them in the atlas. Prewarmed glyphs stay cached while unused like released
+			glyphs do, thus they may be evicted if the atlas runs out of space.
+		@remarks
+			Rasterization is spread across the threads of ColibriManager::getWorkerPool
+			if there is one (each thread opens its own copy of the fonts). Otherwise it
+			happens on the calling thread. Either way this function doesn't return until
+			all glyphs are in the atlas.
+			Codepoints map directly to glyphs; contextual forms & ligatures produced by
+			shaping aren't prewarmed, and neither are codepoints missing from the font.
+		*/
+		void prewarmQueuedGlyphs();
+
+		/** Writes every glyph in the cache (metrics & pixels) to a file, so that
+			loadGlyphCache can skip rasterizing them on the next run.
+		@remarks
+			Glyphs are keyed by a hash of the contents of their font file, their size,
+			the DPI and the render mode, thus the file remains valid even if fonts are
+			added in a different order or one of them is replaced.
+		@param filePath
+			Full path to a writable location. The file is overwritten
+		@return
+			False if the file couldn't be written
+		*/
+		bool saveGlyphCache( const char *filePath );
+
+		/** Loads the glyphs saved with saveGlyphCache into the cache & the atlas.
+			Glyphs whose font is no longer loaded (or whose file changed), or that were
+			saved with a different DPI are skipped; they'll be rasterized when needed.
+			Loaded glyphs stay cached while unused like released glyphs do.
+		@param filePath
+			Full path to the file
+		@return
+			Number of glyphs loaded. 0 if the file doesn't exist, is from an incompatible
+			version, or is corrupt
+		*/
+		size_t loadGlyphCache( const char *filePath );
+
 		/**
 		@brief renderString
 		@param utf8Str
@@ -234,11 +351,88 @@ namespace Colibri
 			VertReadingDir::VertReadingDir vertReadingDir, ShapedGlyphVec &outShapes,
 			bool &bOutHasPrivateUse );
 
+		/** Sets how many results of renderString are kept, so that strings that are already
+			shown elsewhere (or were recently) don't have to be shaped again.
+		@remarks
+			Cached results keep their glyphs referenced, thus they can't be evicted from the
+			atlas until the cache lets go of them (which happens automatically if the atlas
+			runs out of space).
+			Strings longer than 256 bytes are never cached.
+		@param maxEntries
+			Max number of different strings. Default is 2048. 0 disables the cache
+		@param maxGlyphs
+			Max sum of glyphs of all strings. Default is 32768
+		*/
+		void setShapingCacheLimits( size_t maxEntries, size_t maxGlyphs );
+		size_t getShapingCacheMaxEntries() const { return m_shapingCacheMaxEntries; }
+		size_t getShapingCacheMaxGlyphs() const { return m_shapingCacheMaxGlyphs; }
+
+		/// Drops all cached results of renderString. Called automatically when something
+		/// that affects shaping changes (fonts, features, default direction, etc)
+		void clearShapingCache();
+
+		const ShapingCacheStats &getShapingCacheStats() const { return m_shapingCacheStats; }
+
+		/** When enabled (the default), strings that are plain ASCII and whose reading
+			direction is LTR (or auto) skip BiDi analysis and ICU's UTF-16 conversion,
+			since they always end up as a single LTR run. They go straight to HarfBuzz.
+		@remarks
+			The output is the same either way. This exists to compare both paths
+			when profiling.
+		*/
+		void setSimpleTextFastPath( bool bEnable );
+		bool getSimpleTextFastPath() const { return m_simpleTextFastPath; }
+
 		TextHorizAlignment::TextHorizAlignment getDefaultTextDirection() const;
 		VertReadingDir::VertReadingDir getPreferredVertReadingDir() const;
 
+		/// Uploads the glyphs created since the last call. All changes are merged into
+		/// as few copies as possible and go through a single staging buffer.
+		/// See getLastAtlasUploadStats
 		void updateGpuBuffers();
 
+		/// Returns what the last call to updateGpuBuffers uploaded
+		const AtlasUploadStats &getLastAtlasUploadStats() const { return m_lastAtlasUploadStats; }
+		/// Returns the sum of all calls to updateGpuBuffers
+		const AtlasUploadStats &getTotalAtlasUploadStats() const { return m_totalAtlasUploadStats; }
+
+		/** Moves glyphs from the end of the last page of the atlas into free space
+			closer to the beginning (of an earlier page, or of the same page), and removes
+			the last page once it's empty.
+			Over time releasing and acquiring glyphs of different sizes leaves holes in
+			the atlas and extra pages that can't be removed because of a few glyphs
+			at the end of them.
+		@remarks
+			Moved glyphs must be uploaded again, and the Labels using them must regenerate
+			their vertices. Thus this is meant to be called every frame with a small budget.
+			ColibriManager::update calls it for you if setAtlasCompactionBudget is non-zero.
+		@param maxBytes
+			Stop once this many bytes have been moved. At least one glyph is moved if possible
+		@return
+			Number of bytes that were moved
+		*/
+		size_t compactAtlas( size_t maxBytes );
+
+		/// Sets how many bytes of glyphs compactAtlas may move every frame.
+		/// 0 (the default) disables compaction.
+		void   setAtlasCompactionBudget( size_t bytesPerFrame );
+		size_t getAtlasCompactionBudget() const { return m_atlasCompactionBudget; }
+
+		/** Rasterizes glyphs once at ptSize as signed distance fields, and draws text of
+			every size from them. Text of many different sizes (or animated size) then
+			shares the same atlas entries, instead of rasterizing every glyph once per size.
+		@remarks
+			Must be called before any glyph is created, i.e. before creating Labels.
+			Small text looks slightly softer than when rasterized at its actual size.
+		@param ptSize
+			Size at which glyphs are rasterized. 0 (the default) disables distance fields.
+			Text much bigger than this will look rounded at the corners.
+		*/
+		void     setGlyphSdfReferenceSize( FontSize ptSize );
+		FontSize getGlyphSdfReferenceSize() const { return m_sdfReferenceSize; }
+		/// Returns a value that changes if the way glyphs are rasterized changes
+		uint32_t getGlyphRenderMode() const;
+
 		void prepareToRender();
 
 		Ogre::HlmsColibri *colibri_nullable getOgreHlms() { return m_hlms; }
@@ -0,0 +1,103 @@
+
+#pragma once
+
+#include "ColibriGui/Text/ColibriShaper.h"
+
+COLIBRI_ASSUME_NONNULL_BEGIN
+
+namespace Colibri
+{
+	/// Everything that affects the result of shaping a RichText run, except alignment
+	/// (which is applied later by Label)
+	struct ShapingCacheKey
+	{
+		const char *utf8Str;
+		uint32_t    length;
+		uint32_t    ptSize;
+		uint16_t    font;
+		/// UBiDiLevel the paragraph was analyzed with
+		uint8_t     horizDir;
+		bool        vertical;
+	};
+
+	struct ShapingCacheEntry
+	{
+		std::string    utf8Str;
+		uint32_t       ptSize;
+		uint16_t       font;
+		uint8_t        horizDir;
+		bool           vertical;
+		uint64_t       hash;
+
+		/// Result of ShaperManager::renderString. Each glyph holds a reference
+		ShapedGlyphVec shapes;
+		TextHorizAlignment::TextHorizAlignment actualDir;
+		bool           hasPrivateUse;
+
+		/// Owned by ShapingCache. Don't touch.
+		ShapingCacheEntry *colibri_nullable nextInBucket;
+		ShapingCacheEntry *colibri_nullable lruPrev;
+		ShapingCacheEntry *colibri_nullable lruNext;
+	};
+
+	/**
+	@class ShapingCache
+		Results of shaping strings (BiDi analysis + HarfBuzz) so that Labels showing the
+		same text ("OK", "Cancel", repeated table cells, etc) don't shape it again.
+
+		It's only a container. ShaperManager decides what goes in, keeps the references
+		of the glyphs, and evicts the least recently used entries to stay within its limits.
+
+		Pointers to entries remain valid until they're erased.
+	*/
+	class ShapingCache
+	{
+		/// Chained hash table. Size is always a power of 2
+		std::vector<ShapingCacheEntry *> m_buckets;
+		size_t                           m_numEntries;
+		/// Sum of the number of shapes of all entries
+		size_t                           m_numGlyphs;
+
+		/// Least recently used is m_lruFirst
+		ShapingCacheEntry *colibri_nullable m_lruFirst;
+		ShapingCacheEntry *colibri_nullable m_lruLast;
+
+		static uint64_t hash( const ShapingCacheKey &key );
+		static bool     equals( const ShapingCacheEntry &entry, const ShapingCacheKey &key,
+								uint64_t keyHash );
+
+		void rehash( size_t newNumBuckets );
+
+		void lruPushBack( ShapingCacheEntry *entry );
+		void lruRemove( ShapingCacheEntry *entry );
+
+	public:
+		ShapingCache();
+		~ShapingCache();
+
+		/// Returns null if not found. Otherwise the entry becomes the most recently used
+		ShapingCacheEntry *colibri_nullable find( const ShapingCacheKey &key );
+
+		/** Adds a new entry. There must not be one with the same key already.
+		@param shapes
+			Copied into the entry. The caller must add a reference to each glyph
+		*/
+		ShapingCacheEntry *insert( const ShapingCacheKey &key,
+								   ShapedGlyphVec::const_iterator shapesBegin,
+								   ShapedGlyphVec::const_iterator shapesEnd,
+								   TextHorizAlignment::TextHorizAlignment actualDir,
+								   bool hasPrivateUse );
+
+		/// Removes the entry. The caller must release the references of its glyphs first.
+		/// The pointer is no longer valid afterwards
+		void erase( ShapingCacheEntry *entry );
+
+		/// Null if empty
+		ShapingCacheEntry *colibri_nullable getLeastRecentlyUsed() const { return m_lruFirst; }
+
+		size_t getNumEntries() const { return m_numEntries; }
+		size_t getNumGlyphs() const { return m_numGlyphs; }
+	};
+}  // namespace Colibri
+
+COLIBRI_ASSUME_NONNULL_END
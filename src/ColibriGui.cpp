@@ -393,7 +393,9 @@ namespace Demo
                                          LogicSystem **outLogicSystem )
     {
         ColibriGuiGameState *gfxGameState = new ColibriGuiGameState(
-        "Empty Project Example" );
+        "Empty Project Example\n"
+        "Press F6 to benchmark vertex generation (SIMD vs scalar). Results go to the log\n"
+        "Press F7 to benchmark shaping ASCII labels (fast path vs BiDi + ICU)" );
 
         GraphicsSystem *graphicsSystem = new ColibriGuiGraphicsSystem( gfxGameState );
 
@@ -3,15 +3,6 @@
 #include "ColibriGui/ColibriLabel.h"
 #include "ColibriGui/ColibriManager.h"
 
-#if defined( __clang__ )
-#	pragma clang diagnostic push
-#	pragma clang diagnostic ignored "-Wsign-conversion"
-#endif
-#include "unicode/unistr.h"
-#if defined( __clang__ )
-#	pragma clang diagnostic pop
-#endif
-
 #define TODO_text_edit
 
 namespace Colibri
@@ -289,9 +280,6 @@ namespace Colibri
 
 			if( !isAtLimit )
 			{
-				const std::string &oldText = m_label->getText();
-				UnicodeString uStr( UnicodeString::fromUTF8( oldText ) );
-
 				size_t lastCursorPosToDelete = m_cursorPos;
 				if( keyCode == KeyCode::Backspace )
 				{
@@ -318,18 +306,10 @@ namespace Colibri
 				m_label->getGlyphStartUtf16( lastCursorPosToDelete, lastGlyphStart, lastGlyphLength );
 
 				size_t glyphLength = lastGlyphStart + lastGlyphLength - firstGlyphStart;
-				if( glyphLength > 0 )
-				{
-					uStr.remove( static_cast<int32_t>( firstGlyphStart ),
-								 static_cast<int32_t>( glyphLength ) );
-				}
-
-				// Convert back to UTF8
-				std::string result;
-				uStr.toUTF8String( result );
-				m_label->setText( result );
+				// Only the paragraph being edited gets reshaped
+				m_label->replaceText( firstGlyphStart, glyphLength, "" );
 				if( m_placeholder )
-					m_placeholder->setVisualsEnabled( result.empty() );
+					m_placeholder->setVisualsEnabled( m_label->getText().empty() );
 				m_manager->callActionListeners( this, Action::ValueChanged );
 			}
 			else if( m_label->getGlyphCount() == 0u && !m_label->getText().empty() )
@@ -403,10 +383,6 @@ namespace Colibri
 
 		if( !bReplaceContents )
 		{
-			const std::string &oldText = m_label->getText();
-			UnicodeString uStr( UnicodeString::fromUTF8( oldText ) );
-			UnicodeString appendText( UnicodeString::fromUTF8( text ) );
-
 			oldGlyphCount = m_label->getGlyphCount();
 
 			// Convert m_cursorPos from glyph to code units
@@ -414,15 +390,10 @@ namespace Colibri
 			size_t glyphLength;
 			m_label->getGlyphStartUtf16( m_cursorPos, glyphStart, glyphLength );
 
-			// Append the text
-			uStr.insert( static_cast<int32_t>( glyphStart ), appendText );
-
-			// Convert back to UTF8
-			std::string result;
-			uStr.toUTF8String( result );
-			m_label->setText( result );
+			// Insert the text. Only the paragraph being edited gets reshaped
+			m_label->replaceText( glyphStart, 0u, text );
 			if( m_placeholder )
-				m_placeholder->setVisualsEnabled( result.empty() );
+				m_placeholder->setVisualsEnabled( m_label->getText().empty() );
 		}
 		else
 		{
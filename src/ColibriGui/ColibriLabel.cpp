@@ -10,20 +10,80 @@
 
 #include "unicode/unistr.h"
 
+#include <algorithm>
+
 namespace Colibri
 {
+	/// Advances utf8Str by utf16Length code units UTF16. Stops at the end of the string.
+	/// Returns the number of bytes advanced
+	static size_t utf16ToUtf8Offset( const char *utf8Str, size_t utf8Length, size_t utf16Length )
+	{
+		size_t i = 0u;
+		while( i < utf8Length && utf16Length > 0u )
+		{
+			const uint8_t c = static_cast<uint8_t>( utf8Str[i] );
+			// 4-byte sequences are surrogate pairs in UTF16
+			utf16Length -= c >= 0xF0u && utf16Length > 1u ? 2u : 1u;
+			++i;
+			while( i < utf8Length && ( static_cast<uint8_t>( utf8Str[i] ) & 0xC0u ) == 0x80u )
+				++i;
+		}
+		return i;
+	}
+	//-------------------------------------------------------------------------
+	/// Returns the number of code units UTF16 needed to encode the UTF8 string
+	static size_t countUtf16( const char *utf8Str, size_t utf8Length )
+	{
+		size_t retVal = 0u;
+		for( size_t i = 0u; i < utf8Length; ++i )
+		{
+			const uint8_t c = static_cast<uint8_t>( utf8Str[i] );
+			if( ( c & 0xC0u ) != 0x80u )
+				retVal += c >= 0xF0u ? 2u : 1u;
+		}
+		return retVal;
+	}
+	//-------------------------------------------------------------------------
+	/// Returns the index of the first glyph in [first; last) whose clusterStart is >= utf16Pos
+	/// Glyphs must be sorted by clusterStart
+	static size_t findFirstGlyphAt( const ShapedGlyphVec &shapes, size_t first, size_t last,
+									size_t utf16Pos )
+	{
+		while( first < last )
+		{
+			const size_t mid = first + ( last - first ) / 2u;
+			if( shapes[mid].clusterStart < utf16Pos )
+				first = mid + 1u;
+			else
+				last = mid;
+		}
+		return first;
+	}
+	//-------------------------------------------------------------------------
+	/// Lines within this distance (in pixels) of the clip rect are considered visible, to
+	/// account for snapping glyphs to pixels and for the shadow
+	static float getLineCullMargin( bool shadowOutline, const Ogre::Vector2 &shadowDisplace )
+	{
+		return 1.0f + ( shadowOutline ? Ogre::Math::Abs( shadowDisplace.y ) : 0.0f );
+	}
+	//-------------------------------------------------------------------------
 	inline void getCorners( const ShapedGlyph &shapedGlyph, Ogre::Vector2 &topLeft,
 							Ogre::Vector2 &bottomRight )
 	{
 		topLeft = shapedGlyph.caretPos + shapedGlyph.offset +
-				  Ogre::Vector2( shapedGlyph.glyph->bearingX, -shapedGlyph.glyph->bearingY );
+				  Ogre::Vector2( shapedGlyph.getBearingX(), -shapedGlyph.getBearingY() );
 		bottomRight =
-			Ogre::Vector2( topLeft.x + shapedGlyph.glyph->width, topLeft.y + shapedGlyph.glyph->height );
+			Ogre::Vector2( topLeft.x + shapedGlyph.getWidth(), topLeft.y + shapedGlyph.getHeight() );
 	}
 
 	Label::Label( ColibriManager *manager ) :
 		Renderable( manager ),
 		m_usesBackground( false ),
+		m_appendMaxLines( 0u ),
+		m_appendMaxBytes( 0u ),
+		m_largeTextMode( false ),
+		m_glyphBudgetDirty( false ),
+		m_glyphQuadsState( States::NumStates ),
 		m_clipTextToWidget( true ),
 		m_shadowOutline( false ),
 		m_shadowColour( Ogre::ColourValue::Black ),
@@ -55,6 +115,11 @@ namespace Colibri
 #if COLIBRIGUI_DEBUG_MEDIUM
 			m_glyphsAligned[i] = true;
 #endif
+			m_textEdits[i].bPending = false;
+			m_textAppends[i].bPending = false;
+			m_plainLayoutWidth[i] = -1.0f;
+			m_visibleGlyphBudget[i] = 0u;
+			m_requiredGlyphBudget[i] = 0u;
 		}
 
 		m_numVertices = 0;
@@ -203,8 +268,49 @@ namespace Colibri
 		m_shadowOutline = enable;
 		m_shadowColour = shadowColour;
 		m_shadowDisplace = shadowDisplace;
+		invalidateGlyphQuads( m_currentState );
+		_setVisualsDirty();
+
+		if( m_largeTextMode )
+		{
+			// The margin around the clip rect depends on the shadow
+			for( size_t i = 0; i < States::NumStates; ++i )
+				updateVisibleGlyphBudget( static_cast<States::States>( i ) );
+		}
+	}
+	//-------------------------------------------------------------------------
+	void Label::setLargeTextMode( bool bLargeTextMode )
+	{
+		if( m_largeTextMode == bLargeTextMode )
+			return;
+
+		m_largeTextMode = bLargeTextMode;
+
+		for( size_t i = 0; i < States::NumStates; ++i )
+		{
+			m_lines[i].clear();
+			if( bLargeTextMode )
+			{
+				// Start from what ColibriManager already made room for
+				m_visibleGlyphBudget[i] = m_shapes[i].size();
+				if( !m_glyphsDirty[i] && m_glyphsPlaced[i] )
+					updateLineIndex( static_cast<States::States>( i ) );
+			}
+			else
+			{
+				// Keep emitting within the budget until ColibriManager makes room for everything
+				m_requiredGlyphBudget[i] = m_shapes[i].size();
+				if( !m_glyphBudgetDirty && !isAnyStateDirty() )
+					m_manager->_addDirtyLabel( this );
+				m_glyphBudgetDirty = true;
+			}
+		}
+
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
+	bool Label::getLargeTextMode() const { return m_largeTextMode; }
+	//-------------------------------------------------------------------------
 	void Label::setDefaultFontSize( FontSize defaultFontSize )
 	{
 		if( m_defaultFontSize != defaultFontSize )
@@ -264,6 +370,8 @@ namespace Colibri
 			{
 				m_richText[forState][richTextTextIdx].rgba32 = m_colour.getAsABGR();
 			}
+			invalidateGlyphQuads( forState );
+			_setVisualsDirty();
 		}
 	}
 	//-------------------------------------------------------------------------
@@ -320,10 +428,434 @@ namespace Colibri
 		}
 	}
 	//-------------------------------------------------------------------------
+	bool Label::updateGlyphsIncremental( States::States state, bool bPlaceGlyphs )
+	{
+		const TextEdit edit = m_textEdits[state];
+		m_textEdits[state].bPending = false;
+
+		if( !edit.bPending )
+			return false;
+
+		ShapedGlyphVec &shapes = m_shapes[state];
+
+		// Paragraphs can only be told apart by clusterStart if glyphs are in logical order.
+		// RTL runs are reversed (and BiDi analysis may span across paragraphs)
+		{
+			ShapedGlyphVec::const_iterator itor = shapes.begin();
+			ShapedGlyphVec::const_iterator endt = shapes.end();
+			while( itor != endt && !itor->isRtl )
+				++itor;
+			if( itor != endt )
+				return false;
+		}
+
+		validateRichText( state );
+
+		const std::string &text = m_text[state];
+
+		// Expand the edit to whole paragraphs
+		size_t paraStart = std::min( edit.start, text.size() );
+		while( paraStart > 0u && text[paraStart - 1u] != '\n' )
+			--paraStart;
+		size_t paraEnd = text.find( '\n', std::min( edit.end, text.size() ) );
+		if( paraEnd == std::string::npos )
+			paraEnd = text.size();
+
+		const size_t paraStart16 = countUtf16( text.c_str(), paraStart );
+		const size_t paraEnd16 =
+			paraStart16 + countUtf16( text.c_str() + paraStart, paraEnd - paraStart );
+		const size_t oldParaEnd16 = static_cast<size_t>( ptrdiff_t( paraEnd16 ) - edit.utf16Delta );
+
+		const size_t firstGlyph = findFirstGlyphAt( shapes, 0u, shapes.size(), paraStart16 );
+		const size_t oldEndGlyph = findFirstGlyphAt( shapes, firstGlyph, shapes.size(), oldParaEnd16 );
+
+		ShaperManager *shaperManager = m_manager->getShaperManager();
+
+		RichText richText = m_richText[state][0];
+		richText.offset = 0u;
+		richText.length = static_cast<uint32_t>( paraEnd - paraStart );
+
+		ShapedGlyphVec newShapes;
+		bool bHasPrivateUse = false;
+		shaperManager->renderString( text.c_str() + paraStart, richText, 0u, m_vertReadingDir,
+									 newShapes, bHasPrivateUse );
+
+		{
+			ShapedGlyphVec::const_iterator itor = newShapes.begin();
+			ShapedGlyphVec::const_iterator endt = newShapes.end();
+			while( itor != endt && !itor->isRtl )
+				++itor;
+			if( itor != endt )
+			{
+				// The actual direction of the whole text may have changed too
+				for( itor = newShapes.begin(); itor != endt; ++itor )
+					shaperManager->releaseGlyph( itor->glyph );
+				return false;
+			}
+		}
+
+		// Remember where the paragraph after the edit used to start
+		const float oldNextParagraphY =
+			oldEndGlyph < shapes.size() ? shapes[oldEndGlyph].caretPos.y : 0.0f;
+
+		for( size_t i = firstGlyph; i < oldEndGlyph; ++i )
+			shaperManager->releaseGlyph( shapes[i].glyph );
+
+		{
+			ShapedGlyphVec::iterator itor = newShapes.begin();
+			ShapedGlyphVec::iterator endt = newShapes.end();
+			while( itor != endt )
+			{
+				itor->clusterStart += static_cast<uint32_t>( paraStart16 );
+				++itor;
+			}
+
+			itor = shapes.begin() + ptrdiff_t( oldEndGlyph );
+			endt = shapes.end();
+			while( itor != endt )
+			{
+				itor->clusterStart =
+					static_cast<uint32_t>( ptrdiff_t( itor->clusterStart ) + edit.utf16Delta );
+				++itor;
+			}
+		}
+
+		shapes.erase( shapes.begin() + ptrdiff_t( firstGlyph ),
+					  shapes.begin() + ptrdiff_t( oldEndGlyph ) );
+		shapes.insert( shapes.begin() + ptrdiff_t( firstGlyph ), newShapes.begin(),
+					   newShapes.end() );
+
+		const size_t newEndGlyph = firstGlyph + newShapes.size();
+
+		m_richText[state][0].glyphStart = 0u;
+		m_richText[state][0].glyphEnd = static_cast<uint32_t>( shapes.size() );
+
+		PrivateAreaGlyphsVec *privateAreaGlyphs = getPrivateAreaGlyphs( state );
+		if( privateAreaGlyphs )
+			privateAreaGlyphs->clear();
+
+		if( ( privateAreaGlyphs || bHasPrivateUse ) && shaperManager->getDefaultBmpFontForRaster() )
+		{
+			// Indices after the edit moved. Collect them all again
+			ShapedGlyphVec::const_iterator itor = shapes.begin();
+			ShapedGlyphVec::const_iterator endt = shapes.end();
+			while( itor != endt )
+			{
+				if( itor->isPrivateArea )
+				{
+					if( !privateAreaGlyphs )
+						privateAreaGlyphs = createPrivateAreaGlyphs( state );
+					privateAreaGlyphs->push_back( uint32_t( itor - shapes.begin() ) );
+				}
+				++itor;
+			}
+		}
+
+		// m_actualHorizAlignment & m_actualVertReadingDir remain the same: all text is LTR
+
+		m_glyphsDirty[state] = false;
+
+		if( !bPlaceGlyphs )
+			return true;
+
+		if( !placeParagraphs( state, firstGlyph, newEndGlyph, oldNextParagraphY ) )
+			placeGlyphs( state );
+
+		return true;
+	}
+	//-------------------------------------------------------------------------
+	bool Label::placeParagraphs( States::States state, size_t firstGlyph, size_t endGlyph,
+								 float oldEndY )
+	{
+		ShapedGlyphVec &shapes = m_shapes[state];
+
+		const float layoutWidth = m_size.x * ( 2.0f * m_manager->getHalfWindowResolution().x /
+											   m_manager->getCanvasSize().x );
+
+		// Glyphs before firstGlyph must already be where they need to be
+		if( firstGlyph == 0u || !shapes[firstGlyph - 1u].isNewline || !isAlignmentNoop( state ) ||
+			m_plainLayoutWidth[state] != layoutWidth )
+		{
+			return false;
+		}
+
+		_setVisualsDirty();
+
+		// Resume placing from the newline preceding firstGlyph, with the same starting
+		// height as placeGlyphs. placeWords advances past that newline the same way it does
+		// when placing everything
+		const float largestHeight = findLineMaxHeight( shapes.begin(), state );
+
+		Word nextWord;
+		memset( &nextWord, 0, sizeof( Word ) );
+		nextWord.offset = firstGlyph - 1u;
+		nextWord.length = 0u;
+		nextWord.endCaretPos = shapes[firstGlyph - 1u].caretPos;
+		nextWord.startCaretPos = nextWord.endCaretPos;
+
+		const bool hasNextParagraph = endGlyph < shapes.size();
+
+		placeWords( state, nextWord, largestHeight, hasNextParagraph ? endGlyph + 1u : shapes.size() );
+
+		if( hasNextParagraph )
+		{
+			// The newline at endGlyph is placed. Everything after it
+			// keeps its layout, just displaced vertically
+			const float displacement = shapes[endGlyph].caretPos.y - oldEndY;
+			if( displacement != 0.0f )
+			{
+				ShapedGlyphVec::iterator itor = shapes.begin() + ptrdiff_t( endGlyph + 1u );
+				ShapedGlyphVec::iterator endt = shapes.end();
+				while( itor != endt )
+				{
+					itor->caretPos.y += displacement;
+					++itor;
+				}
+			}
+		}
+
+		m_glyphsPlaced[state] = true;
+#if COLIBRIGUI_DEBUG_MEDIUM
+		m_glyphsAligned[state] = true;
+#endif
+
+		notifyGlyphsMoved( state );
+
+		if( state == m_currentState )
+			populateRasterPrivateArea();
+
+		return true;
+	}
+	//-------------------------------------------------------------------------
+	bool Label::updateGlyphsAppend( States::States state, bool bPlaceGlyphs )
+	{
+		const TextAppend append = m_textAppends[state];
+		m_textAppends[state].bPending = false;
+
+		if( !append.bPending )
+			return false;
+
+		validateRichText( state );
+
+		ShaperManager *shaperManager = m_manager->getShaperManager();
+
+		ShapedGlyphVec &shapes = m_shapes[state];
+		RichTextVec &richTexts = m_richText[state];
+
+		COLIBRI_ASSERT_LOW( append.numEvictedGlyphs <= shapes.size() );
+		COLIBRI_ASSERT_LOW( append.numNewRichText <= richTexts.size() );
+
+		// Height the first line that is kept was placed with. See placeGlyphs
+		float oldFirstLineHeight = 0.0f;
+		if( append.numEvictedGlyphs != 0u && append.numEvictedGlyphs < shapes.size() )
+		{
+			size_t paragraphStart = append.numEvictedGlyphs;
+			while( paragraphStart > 0u && !shapes[paragraphStart - 1u].isNewline )
+				--paragraphStart;
+			oldFirstLineHeight =
+				findLineMaxHeight( shapes.begin() + ptrdiff_t( paragraphStart ), state );
+		}
+
+		// Release the glyphs of the evicted text
+		{
+			ShapedGlyphVec::const_iterator itor = shapes.begin();
+			ShapedGlyphVec::const_iterator endt = itor + ptrdiff_t( append.numEvictedGlyphs );
+			while( itor != endt )
+			{
+				shaperManager->releaseGlyph( itor->glyph );
+				++itor;
+			}
+			shapes.erase( shapes.begin(), endt );
+		}
+
+		const size_t numOldRichText = richTexts.size() - append.numNewRichText;
+		const size_t firstUncutRichText = append.bFirstCut ? 1u : 0u;
+
+		{
+			const uint32_t numEvictedGlyphs = static_cast<uint32_t>( append.numEvictedGlyphs );
+			for( size_t i = firstUncutRichText; i < numOldRichText; ++i )
+			{
+				richTexts[i].glyphStart -= numEvictedGlyphs;
+				richTexts[i].glyphEnd -= numEvictedGlyphs;
+			}
+
+			const uint32_t numEvictedRichText = static_cast<uint32_t>( append.numEvictedRichText );
+			if( numEvictedRichText != 0u )
+			{
+				ShapedGlyphVec::iterator itor = shapes.begin();
+				ShapedGlyphVec::iterator endt = shapes.end();
+				while( itor != endt )
+				{
+					itor->richTextIdx -= numEvictedRichText;
+					++itor;
+				}
+			}
+		}
+
+		bool bHasPrivateUse = false;
+		TextHorizAlignment::TextHorizAlignment actualDir = m_actualHorizAlignment[state];
+
+		if( append.bFirstCut )
+		{
+			// What's left of the first RichText must be shaped again
+			RichText &richText = richTexts[0];
+			ShapedGlyphVec newShapes;
+			bool bOutHasPrivateUse = false;
+			shaperManager->renderString( m_text[state].c_str() + richText.offset, richText, 0u,
+										 m_vertReadingDir, newShapes, bOutHasPrivateUse );
+			bHasPrivateUse |= bOutHasPrivateUse;
+
+			shapes.insert( shapes.begin(), newShapes.begin(), newShapes.end() );
+
+			const uint32_t numNewGlyphs = static_cast<uint32_t>( newShapes.size() );
+			richText.glyphStart = 0u;
+			richText.glyphEnd = numNewGlyphs;
+			for( size_t i = 1u; i < numOldRichText; ++i )
+			{
+				richTexts[i].glyphStart += numNewGlyphs;
+				richTexts[i].glyphEnd += numNewGlyphs;
+			}
+		}
+
+		const size_t firstNewGlyph = shapes.size();
+
+		for( size_t i = numOldRichText; i < richTexts.size(); ++i )
+		{
+			RichText &richText = richTexts[i];
+			richText.glyphStart = static_cast<uint32_t>( shapes.size() );
+			bool bOutHasPrivateUse = false;
+			actualDir = shaperManager->renderString( m_text[state].c_str() + richText.offset,
+													 richText, static_cast<uint32_t>( i ),
+													 m_vertReadingDir, shapes, bOutHasPrivateUse );
+			richText.glyphEnd = static_cast<uint32_t>( shapes.size() );
+			bHasPrivateUse |= bOutHasPrivateUse;
+		}
+
+		PrivateAreaGlyphsVec *privateAreaGlyphs = getPrivateAreaGlyphs( state );
+		if( privateAreaGlyphs )
+			privateAreaGlyphs->clear();
+
+		if( ( privateAreaGlyphs || bHasPrivateUse ) && shaperManager->getDefaultBmpFontForRaster() )
+		{
+			// Indices of the glyphs that were kept moved. Collect them all again
+			ShapedGlyphVec::const_iterator itor = shapes.begin();
+			ShapedGlyphVec::const_iterator endt = shapes.end();
+			while( itor != endt )
+			{
+				if( itor->isPrivateArea )
+				{
+					if( !privateAreaGlyphs )
+						privateAreaGlyphs = createPrivateAreaGlyphs( state );
+					privateAreaGlyphs->push_back( uint32_t( itor - shapes.begin() ) );
+				}
+				++itor;
+			}
+		}
+
+		// Same as updateGlyphs: the direction of the last RichText wins
+		if( append.numNewRichText != 0u )
+			updateActualDirections( state, actualDir );
+
+		m_glyphsDirty[state] = false;
+
+		if( !bPlaceGlyphs )
+			return true;
+
+		const float layoutWidth = m_size.x * ( 2.0f * m_manager->getHalfWindowResolution().x /
+											   m_manager->getCanvasSize().x );
+
+		if( append.bFirstCut || firstNewGlyph == 0u || !isAlignmentNoop( state ) ||
+			m_plainLayoutWidth[state] != layoutWidth )
+		{
+			placeGlyphs( state );
+			return true;
+		}
+
+		if( append.numEvictedGlyphs != 0u )
+		{
+			// The kept text was spaced with the height of the whole paragraph it belonged to.
+			// If the eviction changed that height its lines must be spaced again
+			const float firstLineHeight = findLineMaxHeight( shapes.begin(), state );
+			if( firstLineHeight != oldFirstLineHeight )
+			{
+				placeGlyphs( state );
+				return true;
+			}
+
+			// The text that was kept starts at the beginning of a line.
+			// Move it up so that line becomes the first one. See placeGlyphs
+			const float displacement = firstLineHeight - shapes.front().caretPos.y;
+			if( displacement != 0.0f )
+			{
+				ShapedGlyphVec::iterator itor = shapes.begin();
+				ShapedGlyphVec::iterator endt = itor + ptrdiff_t( firstNewGlyph );
+				while( itor != endt )
+				{
+					itor->caretPos.y += displacement;
+					++itor;
+				}
+			}
+		}
+
+		// The appended text may continue the last line. Place from its beginning
+		size_t lineStart = firstNewGlyph;
+		while( lineStart > 0u && !shapes[lineStart - 1u].isNewline )
+			--lineStart;
+
+		if( !placeParagraphs( state, lineStart, shapes.size(), 0.0f ) )
+			placeGlyphs( state );
+
+		return true;
+	}
+	//-------------------------------------------------------------------------
+	void Label::updateActualDirections( States::States state,
+										TextHorizAlignment::TextHorizAlignment shapedDir )
+	{
+		ShaperManager *shaperManager = m_manager->getShaperManager();
+
+		if( m_horizAlignment == TextHorizAlignment::Natural )
+		{
+			if( m_vertReadingDir == VertReadingDir::ForceTTB )
+				m_actualHorizAlignment[state] = TextHorizAlignment::Right;
+			else if( m_vertReadingDir == VertReadingDir::ForceTTBLTR )
+				m_actualHorizAlignment[state] = TextHorizAlignment::Left;
+			else if( shapedDir == TextHorizAlignment::Mixed )
+				m_actualHorizAlignment[state] = shaperManager->getDefaultTextDirection();
+			else
+				m_actualHorizAlignment[state] = shapedDir;
+		}
+		else
+			m_actualHorizAlignment[state] = m_horizAlignment;
+
+		if( m_vertReadingDir != VertReadingDir::Disabled )
+		{
+			if( m_vertReadingDir == VertReadingDir::ForceTTB ||
+				m_vertReadingDir == VertReadingDir::ForceTTBLTR )
+			{
+				m_actualVertReadingDir[state] = m_vertReadingDir;
+			}
+			else
+				m_actualVertReadingDir[state] = shaperManager->getPreferredVertReadingDir();
+		}
+		else
+			m_actualVertReadingDir[state] = m_vertReadingDir;
+	}
+	//-------------------------------------------------------------------------
 	void Label::updateGlyphs( States::States state, bool bPlaceGlyphs )
 	{
 		const size_t prevNumGlyphs = m_shapes[state].size();
 
+		if( updateGlyphsIncremental( state, bPlaceGlyphs ) ||
+			updateGlyphsAppend( state, bPlaceGlyphs ) )
+		{
+			if( m_shapes[state].size() > prevNumGlyphs )
+			{
+				m_manager->_notifyNumGlyphsIsDirty();
+				_setVertexCountsDirty();
+			}
+			return;
+		}
+
 		ShaperManager *shaperManager = m_manager->getShaperManager();
 
 		{
@@ -357,6 +889,12 @@ namespace Colibri
 #endif
 					m_actualHorizAlignment[state] = m_actualHorizAlignment[i];
 					m_actualVertReadingDir[state] = m_actualVertReadingDir[i];
+					m_plainLayoutWidth[state] = m_plainLayoutWidth[i];
+					if( m_largeTextMode )
+					{
+						m_lines[state] = m_lines[i];
+						updateVisibleGlyphBudget( state );
+					}
 
 					ShapedGlyphVec::const_iterator itor = m_shapes[state].begin();
 					ShapedGlyphVec::const_iterator end = m_shapes[state].end();
@@ -452,32 +990,7 @@ namespace Colibri
 				++itor;
 			}
 
-			if( m_horizAlignment == TextHorizAlignment::Natural )
-			{
-				if( m_vertReadingDir == VertReadingDir::ForceTTB )
-					m_actualHorizAlignment[state] = TextHorizAlignment::Right;
-				else if( m_vertReadingDir == VertReadingDir::ForceTTBLTR )
-					m_actualHorizAlignment[state] = TextHorizAlignment::Left;
-				else if( actualHorizAlignment == TextHorizAlignment::Mixed )
-					m_actualHorizAlignment[state] = shaperManager->getDefaultTextDirection();
-				else
-					m_actualHorizAlignment[state] = actualHorizAlignment;
-			}
-			else
-				m_actualHorizAlignment[state] = m_horizAlignment;
-
-			if( m_vertReadingDir != VertReadingDir::Disabled )
-			{
-				if( m_vertReadingDir == VertReadingDir::ForceTTB ||
-					m_vertReadingDir == VertReadingDir::ForceTTBLTR )
-				{
-					m_actualVertReadingDir[state] = m_vertReadingDir;
-				}
-				else
-					m_actualVertReadingDir[state] = shaperManager->getPreferredVertReadingDir();
-			}
-			else
-				m_actualVertReadingDir[state] = m_vertReadingDir;
+			updateActualDirections( state, actualHorizAlignment );
 		}
 
 		m_glyphsDirty[state] = false;
@@ -487,13 +1000,15 @@ namespace Colibri
 
 		const size_t currNumGlyphs = m_shapes[state].size();
 		if( currNumGlyphs > prevNumGlyphs )
+		{
 			m_manager->_notifyNumGlyphsIsDirty();
+			_setVertexCountsDirty();
+		}
 	}
 	//-------------------------------------------------------------------------
 	void Label::placeGlyphs( States::States state, bool performAlignment )
 	{
-		const Ogre::Vector2 bottomRight =
-			m_size * ( 2.0f * m_manager->getHalfWindowResolution() / m_manager->getCanvasSize() );
+		_setVisualsDirty();
 
 		Word nextWord;
 		memset( &nextWord, 0, sizeof( Word ) );
@@ -507,55 +1022,91 @@ namespace Colibri
 		else
 			nextWord.endCaretPos.x += largestHeight * 0.5f * vertReadDirSign;
 
+		placeWords( state, nextWord, largestHeight, m_shapes[state].size() );
+
+		m_glyphsPlaced[state] = true;
+#if COLIBRIGUI_DEBUG_MEDIUM
+		m_glyphsAligned[state] = false;
+#endif
+
+		if( m_actualVertReadingDir[state] == VertReadingDir::Disabled &&
+			( !performAlignment || isAlignmentNoop( state ) ) )
+		{
+			m_plainLayoutWidth[state] = m_size.x * ( 2.0f * m_manager->getHalfWindowResolution().x /
+													 m_manager->getCanvasSize().x );
+		}
+		else
+		{
+			m_plainLayoutWidth[state] = -1.0f;
+		}
+
+		if( performAlignment )
+			alignGlyphs( state );
+		else
+			notifyGlyphsMoved( state );
+
+		if( state == m_currentState )
+			populateRasterPrivateArea();
+	}
+	//-------------------------------------------------------------------------
+	void Label::placeWords( States::States state, Word &inOutWord, float largestHeight,
+							size_t glyphEnd )
+	{
+		const Ogre::Vector2 bottomRight =
+			m_size * ( 2.0f * m_manager->getHalfWindowResolution() / m_manager->getCanvasSize() );
+
+		const float vertReadDirSign =
+			m_actualVertReadingDir[state] == VertReadingDir::ForceTTB ? -1.0f : 1.0f;
+
 		bool multipleWordsInLine = false;
 
-		while( findNextWord( nextWord, state ) )
+		while( inOutWord.offset + inOutWord.length < glyphEnd && findNextWord( inOutWord, state ) )
 		{
 			if( m_linebreakMode == LinebreakMode::WordWrap )
 			{
 				if( m_actualVertReadingDir[state] == VertReadingDir::Disabled )
 				{
 					float caretAtEndOfWord =
-						nextWord.endCaretPos.x - nextWord.lastAdvance.x + nextWord.lastCharWidth;
-					float distBetweenWords = nextWord.endCaretPos.x - nextWord.startCaretPos.x;
+						inOutWord.endCaretPos.x - inOutWord.lastAdvance.x + inOutWord.lastCharWidth;
+					float distBetweenWords = inOutWord.endCaretPos.x - inOutWord.startCaretPos.x;
 					if( caretAtEndOfWord > bottomRight.x &&
 						( distBetweenWords <= bottomRight.x || multipleWordsInLine ) &&
-						!m_shapes[state][nextWord.offset].isNewline )
+						!m_shapes[state][inOutWord.offset].isNewline )
 					{
-						float caretReturn = nextWord.startCaretPos.x;
-						float wordLength = nextWord.endCaretPos.x - nextWord.startCaretPos.x;
+						float caretReturn = inOutWord.startCaretPos.x;
+						float wordLength = inOutWord.endCaretPos.x - inOutWord.startCaretPos.x;
 
 						// Return to left.
-						nextWord.startCaretPos.x -= caretReturn;
-						nextWord.endCaretPos.x -= caretReturn;
+						inOutWord.startCaretPos.x -= caretReturn;
+						inOutWord.endCaretPos.x -= caretReturn;
 						// Calculate alignment
-						nextWord.startCaretPos.x = 0.0f;
-						nextWord.startCaretPos.y += largestHeight;
-						nextWord.endCaretPos.x = nextWord.startCaretPos.x + wordLength;
-						nextWord.endCaretPos.y = nextWord.startCaretPos.y;
+						inOutWord.startCaretPos.x = 0.0f;
+						inOutWord.startCaretPos.y += largestHeight;
+						inOutWord.endCaretPos.x = inOutWord.startCaretPos.x + wordLength;
+						inOutWord.endCaretPos.y = inOutWord.startCaretPos.y;
 						multipleWordsInLine = false;
 					}
 				}
 				else
 				{
 					float caretAtEndOfWord =
-						nextWord.endCaretPos.y - nextWord.lastAdvance.y + nextWord.lastCharWidth;
-					float distBetweenWords = nextWord.endCaretPos.y - nextWord.startCaretPos.y;
+						inOutWord.endCaretPos.y - inOutWord.lastAdvance.y + inOutWord.lastCharWidth;
+					float distBetweenWords = inOutWord.endCaretPos.y - inOutWord.startCaretPos.y;
 					if( caretAtEndOfWord > bottomRight.y &&
 						( distBetweenWords <= bottomRight.y || multipleWordsInLine ) &&
-						!m_shapes[state][nextWord.offset].isNewline )
+						!m_shapes[state][inOutWord.offset].isNewline )
 					{
-						float caretReturn = nextWord.startCaretPos.y;
-						float wordLength = nextWord.endCaretPos.y - nextWord.startCaretPos.y;
+						float caretReturn = inOutWord.startCaretPos.y;
+						float wordLength = inOutWord.endCaretPos.y - inOutWord.startCaretPos.y;
 
 						// Return to top.
-						nextWord.startCaretPos.y -= caretReturn;
-						nextWord.endCaretPos.y -= caretReturn;
+						inOutWord.startCaretPos.y -= caretReturn;
+						inOutWord.endCaretPos.y -= caretReturn;
 						// Calculate alignment
-						nextWord.startCaretPos.x += largestHeight * vertReadDirSign;
-						nextWord.startCaretPos.y = 0.0f;
-						nextWord.endCaretPos.x = nextWord.startCaretPos.x;
-						nextWord.endCaretPos.y = nextWord.startCaretPos.y + wordLength;
+						inOutWord.startCaretPos.x += largestHeight * vertReadDirSign;
+						inOutWord.startCaretPos.y = 0.0f;
+						inOutWord.endCaretPos.x = inOutWord.startCaretPos.x;
+						inOutWord.endCaretPos.y = inOutWord.startCaretPos.y + wordLength;
 						multipleWordsInLine = false;
 					}
 				}
@@ -563,10 +1114,10 @@ namespace Colibri
 
 			multipleWordsInLine = true;
 
-			Ogre::Vector2 caretPos = nextWord.startCaretPos;
+			Ogre::Vector2 caretPos = inOutWord.startCaretPos;
 
-			ShapedGlyphVec::iterator itor = m_shapes[state].begin() + ptrdiff_t( nextWord.offset );
-			ShapedGlyphVec::iterator end = itor + ptrdiff_t( nextWord.length );
+			ShapedGlyphVec::iterator itor = m_shapes[state].begin() + ptrdiff_t( inOutWord.offset );
+			ShapedGlyphVec::iterator end = itor + ptrdiff_t( inOutWord.length );
 
 			while( itor != end )
 			{
@@ -591,39 +1142,173 @@ namespace Colibri
 					if( m_actualVertReadingDir[state] == VertReadingDir::Disabled )
 					{
 						// Return to left. Newlines are zero width.
-						nextWord.startCaretPos.x = 0.0f;
-						nextWord.endCaretPos.x = 0.0f;
+						inOutWord.startCaretPos.x = 0.0f;
+						inOutWord.endCaretPos.x = 0.0f;
 						// Calculate alignment
-						nextWord.startCaretPos.x = 0.0f;
-						nextWord.startCaretPos.y += largestHeight;
+						inOutWord.startCaretPos.x = 0.0f;
+						inOutWord.startCaretPos.y += largestHeight;
 					}
 					else
 					{
 						// Return to top. Newlines are zero width.
-						nextWord.startCaretPos.y = 0.0f;
-						nextWord.endCaretPos.y = 0.0f;
+						inOutWord.startCaretPos.y = 0.0f;
+						inOutWord.endCaretPos.y = 0.0f;
 						// Calculate alignment
-						nextWord.startCaretPos.x += largestHeight * vertReadDirSign;
-						nextWord.startCaretPos.y = 0.0f;
+						inOutWord.startCaretPos.x += largestHeight * vertReadDirSign;
+						inOutWord.startCaretPos.y = 0.0f;
 					}
-					nextWord.endCaretPos = nextWord.startCaretPos;
+					inOutWord.endCaretPos = inOutWord.startCaretPos;
 					multipleWordsInLine = false;
 				}
 
 				++itor;
 			}
 		}
+	}
+	//-------------------------------------------------------------------------
+	bool Label::isAlignmentNoop( States::States state ) const
+	{
+		return m_actualVertReadingDir[state] == VertReadingDir::Disabled &&
+			   m_actualHorizAlignment[state] == TextHorizAlignment::Left &&
+			   ( m_vertAlignment == TextVertAlignment::Top ||
+				 m_vertAlignment == TextVertAlignment::Natural );
+	}
+	//-------------------------------------------------------------------------
+	void Label::notifyGlyphsMoved( States::States state )
+	{
+		invalidateGlyphQuads( state );
+		updateLineIndex( state );
+	}
+	//-------------------------------------------------------------------------
+	void Label::updateLineIndex( States::States state )
+	{
+		if( !m_largeTextMode )
+			return;
 
-		m_glyphsPlaced[state] = true;
-#if COLIBRIGUI_DEBUG_MEDIUM
-		m_glyphsAligned[state] = false;
-#endif
+		LineRangeVec &lines = m_lines[state];
+		lines.clear();
+
+		if( m_actualVertReadingDir[state] == VertReadingDir::Disabled )
+		{
+			const ShapedGlyphVec &shapes = m_shapes[state];
+			const size_t numGlyphs = shapes.size();
+
+			// placeGlyphs never moves the caret up, thus lines are contiguous
+			size_t i = 0u;
+			while( i < numGlyphs )
+			{
+				LineRange line;
+				line.glyphStart = static_cast<uint32_t>( i );
+				line.minTop = std::numeric_limits<float>::max();
+				line.maxBottom = -std::numeric_limits<float>::max();
+
+				const float caretY = shapes[i].caretPos.y;
+				while( i < numGlyphs && shapes[i].caretPos.y == caretY )
+				{
+					Ogre::Vector2 topLeft, bottomRight;
+					getCorners( shapes[i], topLeft, bottomRight );
+					line.minTop = std::min( line.minTop, topLeft.y );
+					line.maxBottom = std::max( line.maxBottom, bottomRight.y );
+					++i;
+				}
+				line.glyphEnd = static_cast<uint32_t>( i );
+
+				if( !lines.empty() )
+					line.maxBottom = std::max( line.maxBottom, lines.back().maxBottom );
+				lines.push_back( line );
+			}
+
+			// Tall glyphs may overlap the previous lines. Make minTop monotonic
+			// so that both minTop and maxBottom can be binary searched
+			size_t lineIdx = lines.size();
+			while( lineIdx > 1u )
+			{
+				--lineIdx;
+				lines[lineIdx - 1u].minTop =
+					std::min( lines[lineIdx - 1u].minTop, lines[lineIdx].minTop );
+			}
+		}
+
+		updateVisibleGlyphBudget( state );
+	}
+	//-------------------------------------------------------------------------
+	void Label::updateVisibleGlyphBudget( States::States state )
+	{
+		const LineRangeVec &lines = m_lines[state];
+
+		size_t budget = m_shapes[state].size();
+
+		if( !lines.empty() && m_parent )
+		{
+			// We can't see more than what fits in our parent. See _fillBuffersAndCommands
+			const float cullMargin = getLineCullMargin( m_shadowOutline, m_shadowDisplace );
+			const float visibleHeight =
+				m_parent->getSizeAfterClipping().y *
+					( 2.0f * m_manager->getHalfWindowResolution().y / m_manager->getCanvasSize().y ) +
+				cullMargin * 2.0f + 1.0f;
+
+			// The worst case is a clip rect that starts right at the bottom of a line
+			// (moving it further down would leave that line out). Check all of them
+			budget = 0u;
+			const size_t numLines = lines.size();
+			size_t firstLine = 0u;
+			size_t endLine = 0u;
+			for( size_t i = 0u; i < numLines; ++i )
+			{
+				const float clipTop = lines[i].maxBottom;
+				while( lines[firstLine].maxBottom < clipTop )
+					++firstLine;
+				while( endLine < numLines && lines[endLine].minTop <= clipTop + visibleHeight )
+					++endLine;
+				if( endLine > firstLine )
+				{
+					budget = std::max<size_t>(
+						budget, lines[endLine - 1u].glyphEnd - lines[firstLine].glyphStart );
+				}
+			}
+		}
+
+		m_requiredGlyphBudget[state] = budget;
+
+		if( budget <= m_visibleGlyphBudget[state] )
+			m_visibleGlyphBudget[state] = budget;
+		else
+		{
+			if( !m_glyphBudgetDirty && !isAnyStateDirty() )
+				m_manager->_addDirtyLabel( this );
+			m_glyphBudgetDirty = true;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void Label::findVisibleLines( float clipTop, float clipBottom, size_t &outFirstLine,
+								  size_t &outEndLine ) const
+	{
+		const LineRangeVec &lines = m_lines[m_currentState];
 
-		if( performAlignment )
-			alignGlyphs( state );
+		// First line whose maxBottom >= clipTop
+		size_t first = 0u;
+		size_t last = lines.size();
+		while( first < last )
+		{
+			const size_t mid = first + ( last - first ) / 2u;
+			if( lines[mid].maxBottom < clipTop )
+				first = mid + 1u;
+			else
+				last = mid;
+		}
+		outFirstLine = first;
 
-		if( state == m_currentState )
-			populateRasterPrivateArea();
+		// First line whose minTop > clipBottom
+		last = lines.size();
+		while( first < last )
+		{
+			const size_t mid = first + ( last - first ) / 2u;
+			if( lines[mid].minTop <= clipBottom )
+				first = mid + 1u;
+			else
+				last = mid;
+		}
+		outEndLine = first;
 	}
 	//-------------------------------------------------------------------------
 	void Label::alignGlyphs( States::States state )
@@ -632,6 +1317,8 @@ namespace Colibri
 			alignGlyphsHorizReadingDir( state );
 		else
 			alignGlyphsVertReadingDir( state );
+
+		notifyGlyphsMoved( state );
 	}
 	//-------------------------------------------------------------------------
 	void Label::alignGlyphsHorizReadingDir( States::States state )
@@ -885,12 +1572,74 @@ namespace Colibri
 	//-------------------------------------------------------------------------
 	inline void Label::addQuad( GlyphVertex *RESTRICT_ALIAS vertexBuffer, Ogre::Vector2 topLeft,
 								Ogre::Vector2 bottomRight, uint16_t glyphWidth, uint16_t glyphHeight,
-								uint32_t rgbaColour, Ogre::Vector2 parentDerivedTL,
-								Ogre::Vector2 parentDerivedBR, Ogre::Vector2 invSize, uint32_t offset,
+								uint32_t rgbaColour, uint32_t shadowRgbaColour, uint32_t shadowOffset,
+								Ogre::Vector2 parentDerivedTL, Ogre::Vector2 parentDerivedBR,
+								Ogre::Vector2 invSize, uint32_t offset,
 								float canvasAspectRatio, float invCanvasAspectRatio,
 								Matrix2x3 derivedRot )
 	{
 		TODO_this_is_a_workaround_neg_y;
+#ifdef COLIBRI_SIMD
+		if( m_manager->getSimdVertexFill() )
+		{
+			// The 4 corners in order TL, BL, BR, TR. Each lane is one corner.
+			// GlyphVertex is not 16-byte sized, thus only the math is vectorized.
+			const Simd::float4 cornerX =
+				Simd::set( topLeft.x, topLeft.x, bottomRight.x, bottomRight.x );
+			const Simd::float4 cornerY =
+				Simd::set( topLeft.y, bottomRight.y, bottomRight.y, topLeft.y );
+
+			// Same as Widget::mul followed by the aspect ratio correction & Y flip
+			const Simd::float4 posX = Simd::madd(
+				cornerX, Simd::set1( derivedRot.m[0][0] ),
+				Simd::madd( cornerY, Simd::set1( derivedRot.m[0][1] * invCanvasAspectRatio ),
+							Simd::set1( derivedRot.m[0][2] ) ) );
+			const Simd::float4 posY = Simd::madd(
+				cornerX, Simd::set1( -derivedRot.m[1][0] * canvasAspectRatio ),
+				Simd::madd( cornerY, Simd::set1( -derivedRot.m[1][1] ),
+							Simd::set1( -derivedRot.m[1][2] * canvasAspectRatio ) ) );
+
+			Simd::float4 clip0 = Simd::mul( Simd::sub( cornerY, Simd::set1( parentDerivedTL.y ) ),
+											Simd::set1( invSize.y ) );
+			Simd::float4 clip1 = Simd::mul( Simd::sub( cornerX, Simd::set1( parentDerivedTL.x ) ),
+											Simd::set1( invSize.x ) );
+			Simd::float4 clip2 = Simd::mul( Simd::sub( Simd::set1( parentDerivedBR.x ), cornerX ),
+											Simd::set1( invSize.x ) );
+			Simd::float4 clip3 = Simd::mul( Simd::sub( Simd::set1( parentDerivedBR.y ), cornerY ),
+											Simd::set1( invSize.y ) );
+			Simd::transpose( clip0, clip1, clip2, clip3 );
+
+			float cornerPos[2][4];
+			float cornerClip[4][Borders::NumBorders];
+			Simd::store( cornerPos[0], posX );
+			Simd::store( cornerPos[1], posY );
+			Simd::store( cornerClip[0], clip0 );
+			Simd::store( cornerClip[1], clip1 );
+			Simd::store( cornerClip[2], clip2 );
+			Simd::store( cornerClip[3], clip3 );
+
+			const size_t c_quadCorners[6] = { 0u, 1u, 2u, 2u, 3u, 0u };
+			for( size_t i = 0u; i < 6u; ++i )
+			{
+				const size_t corner = c_quadCorners[i];
+				vertexBuffer->x = cornerPos[0][corner];
+				vertexBuffer->y = cornerPos[1][corner];
+				// Every vertex carries the full size. The vertex shader derives the UVs
+				// from the vertex ID, and the width doubles as the row pitch of the glyph
+				vertexBuffer->width = glyphWidth;
+				vertexBuffer->height = glyphHeight;
+				vertexBuffer->offset = offset;
+				vertexBuffer->rgbaColour = rgbaColour;
+				vertexBuffer->shadowRgbaColour = shadowRgbaColour;
+				vertexBuffer->shadowOffset[0] = static_cast<uint16_t>( shadowOffset & 0xFFFFu );
+				vertexBuffer->shadowOffset[1] = static_cast<uint16_t>( shadowOffset >> 16u );
+				memcpy( vertexBuffer->clipDistance, cornerClip[corner],
+						sizeof( cornerClip[corner] ) );
+				++vertexBuffer;
+			}
+			return;
+		}
+#endif
 		Ogre::Vector2 tmp2d;
 
 #define COLIBRI_ADD_VERTEX( _x, _y, _u, _v, clipDistanceTop, clipDistanceLeft, clipDistanceRight, \
@@ -903,6 +1652,9 @@ namespace Colibri
 	vertexBuffer->height = glyphHeight; \
 	vertexBuffer->offset = offset; \
 	vertexBuffer->rgbaColour = rgbaColour; \
+	vertexBuffer->shadowRgbaColour = shadowRgbaColour; \
+	vertexBuffer->shadowOffset[0] = static_cast<uint16_t>( shadowOffset & 0xFFFFu ); \
+	vertexBuffer->shadowOffset[1] = static_cast<uint16_t>( shadowOffset >> 16u ); \
 	vertexBuffer->clipDistance[Borders::Top] = clipDistanceTop; \
 	vertexBuffer->clipDistance[Borders::Left] = clipDistanceLeft; \
 	vertexBuffer->clipDistance[Borders::Right] = clipDistanceRight; \
@@ -972,9 +1724,9 @@ namespace Colibri
 		word.endCaretPos += firstGlyph.advance;
 		word.lastAdvance = firstGlyph.advance;
 		if( m_actualVertReadingDir[state] == VertReadingDir::Disabled )
-			word.lastCharWidth = firstGlyph.glyph->width;
+			word.lastCharWidth = firstGlyph.getWidth();
 		else
-			word.lastCharWidth = firstGlyph.glyph->height;
+			word.lastCharWidth = firstGlyph.getHeight();
 		const bool isRtl = firstGlyph.isRtl;
 		++itor;
 
@@ -986,9 +1738,9 @@ namespace Colibri
 				word.endCaretPos += shapedGlyph.advance;
 				word.lastAdvance = shapedGlyph.advance;
 				if( m_actualVertReadingDir[state] == VertReadingDir::Disabled )
-					word.lastCharWidth = shapedGlyph.glyph->width;
+					word.lastCharWidth = shapedGlyph.getWidth();
 				else
-					word.lastCharWidth = shapedGlyph.glyph->height;
+					word.lastCharWidth = shapedGlyph.getHeight();
 				++itor;
 			}
 		}
@@ -1026,35 +1778,92 @@ namespace Colibri
 		ShapedGlyphVec::const_iterator endt = m_shapes[state].end();
 		while( itor != endt && !itor->isNewline )
 		{
-			largestHeight = std::max( itor->glyph->newlineSize, largestHeight );
+			largestHeight = std::max( itor->getNewlineSize(), largestHeight );
 			++itor;
 		}
 
 		// The newline itself has its own height, make sure it's considered
 		if( itor != endt )
-			largestHeight = std::max( itor->glyph->newlineSize, largestHeight );
+			largestHeight = std::max( itor->getNewlineSize(), largestHeight );
 
 		return largestHeight;
 	}
 	//-------------------------------------------------------------------------
-	GlyphVertex *Label::fillBackground( GlyphVertex *RESTRICT_ALIAS textVertBuffer,
-										const Ogre::Vector2 halfWindowRes,
-										const Ogre::Vector2 invWindowRes,
-										const Ogre::Vector2 parentDerivedTL,
-										const Ogre::Vector2 parentDerivedBR, const bool isHorizontal )
+	void Label::invalidateGlyphQuads( States::States state )
 	{
-		const Ogre::Vector2 invSize = 1.0f / ( parentDerivedBR - parentDerivedTL );
+		if( m_glyphQuadsState == state )
+			m_glyphQuadsState = States::NumStates;
+	}
+	//-------------------------------------------------------------------------
+	void Label::updateGlyphQuads()
+	{
+		if( m_glyphQuadsState == m_currentState )
+			return;
 
-		// Snap position to pixels
-		Ogre::Vector2 derivedTopLeft = m_derivedTopLeft;
-		derivedTopLeft = ( derivedTopLeft + 1.0f ) * halfWindowRes;
-		derivedTopLeft.x = roundf( derivedTopLeft.x );
-		derivedTopLeft.y = roundf( derivedTopLeft.y );
-		derivedTopLeft = derivedTopLeft * invWindowRes - 1.0f;
+		m_glyphQuadsState = m_currentState;
+		m_glyphQuads.clear();
 
-		const Matrix2x3 derivedRot = m_derivedOrientation;
-		const float canvasAr = m_manager->getCanvasAspectRatio();
-		const float invCanvasAr = m_manager->getCanvasInvAspectRatio();
+		const ShapedGlyphVec &shapes = m_shapes[m_currentState];
+		const RichTextVec &richTexts = m_richText[m_currentState];
+
+		m_glyphQuads.reserve( shapes.size() );
+
+		ShapedGlyphVec::const_iterator itor = shapes.begin();
+		ShapedGlyphVec::const_iterator endt = shapes.end();
+
+		while( itor != endt )
+		{
+			const ShapedGlyph &shapedGlyph = *itor;
+
+			if( !shapedGlyph.isNewline && !shapedGlyph.isTab && !shapedGlyph.isPrivateArea )
+			{
+				GlyphQuad quad;
+				getCorners( shapedGlyph, quad.topLeft, quad.bottomRight );
+
+				const Ogre::Vector2 glyphSize = quad.bottomRight - quad.topLeft;
+
+				// Snap each glyph to pixels too
+				quad.topLeft.x = roundf( quad.topLeft.x );
+				quad.topLeft.y = roundf( quad.topLeft.y );
+				quad.bottomRight = quad.topLeft + glyphSize;
+
+				quad.glyphIdx = static_cast<uint32_t>( itor - shapes.begin() );
+				quad.offsetStart = shapedGlyph.glyph->offsetStart;
+				quad.rgbaColour = richTexts[shapedGlyph.richTextIdx].rgba32;
+				quad.shadowOffset = 0u;
+				if( m_shadowOutline )
+				{
+					const Ogre::Vector2 shadowOffset = m_shadowDisplace / shapedGlyph.glyphScale;
+					quad.shadowOffset = Ogre::Bitwise::floatToHalf( shadowOffset.x ) |
+										( uint32_t( Ogre::Bitwise::floatToHalf( shadowOffset.y ) )
+										  << 16u );
+				}
+				quad.width = shapedGlyph.glyph->width;
+				quad.height = shapedGlyph.glyph->height;
+				m_glyphQuads.push_back( quad );
+			}
+
+			++itor;
+		}
+
+		updateBackgroundQuads();
+	}
+	//-------------------------------------------------------------------------
+	void Label::updateBackgroundQuads()
+	{
+		m_backgroundQuads.clear();
+
+		if( !m_usesBackground )
+			return;
+
+		const bool isHorizontal = m_actualVertReadingDir[m_currentState] == VertReadingDir::Disabled;
+
+		GlyphQuad quad;
+		quad.glyphIdx = 0u;
+		quad.offsetStart = 0u;
+		quad.shadowOffset = 0u;
+		quad.width = 1u;
+		quad.height = 1u;
 
 		RichTextVec::const_iterator itRichText = m_richText[m_currentState].begin();
 		RichTextVec::const_iterator enRichText = m_richText[m_currentState].end();
@@ -1065,8 +1874,7 @@ namespace Colibri
 			{
 				float prevCaretY = 0;
 
-				const uint32_t backgroundColour = itRichText->backgroundRgba32;
-				const Ogre::Vector2 backgroundDisplacement = invWindowRes * m_backgroundSize;
+				quad.rgbaColour = itRichText->backgroundRgba32;
 
 				float lineHeight = 0;
 				float mostTop = std::numeric_limits<float>::max();
@@ -1097,17 +1905,17 @@ namespace Colibri
 
 					if( !shapedGlyph.isNewline && !changesLine )
 					{
-						lineHeight = std::max( lineHeight, shapedGlyph.glyph->newlineSize );
+						lineHeight = std::max( lineHeight, shapedGlyph.getNewlineSize() );
 						mostTop = std::min( mostTop, shapedGlyph.caretPos.y );
 						mostBottom = std::max( mostBottom, shapedGlyph.caretPos.y );
 						if( isHorizontal )
 						{
 							mostLeft =
 								std::min( mostLeft, shapedGlyph.caretPos.x + shapedGlyph.offset.x +
-														shapedGlyph.glyph->bearingX );
+														shapedGlyph.getBearingX() );
 							mostRight = std::max(
 								mostRight, shapedGlyph.caretPos.x + shapedGlyph.offset.x +
-											   shapedGlyph.glyph->bearingX + shapedGlyph.glyph->width );
+											   shapedGlyph.getBearingX() + shapedGlyph.getWidth() );
 						}
 						else
 						{
@@ -1121,31 +1929,19 @@ namespace Colibri
 					{
 						const float regionUp = isHorizontal ? shapedGlyph.glyph->regionUp : 0.0f;
 
-						// New line found. Render the background and reset the counters
-						Ogre::Vector2 topLeft =
-							Ogre::Vector2( mostLeft, mostTop - lineHeight * regionUp );
-						Ogre::Vector2 bottomRight =
+						// New line found. Store the background and reset the counters
+						quad.topLeft = Ogre::Vector2( mostLeft, mostTop - lineHeight * regionUp );
+						quad.bottomRight =
 							Ogre::Vector2( mostRight, mostBottom + lineHeight * ( 1.0f - regionUp ) );
 
-						const Ogre::Vector2 glyphSize = bottomRight - topLeft;
+						const Ogre::Vector2 glyphSize = quad.bottomRight - quad.topLeft;
 
 						// Snap each glyph to pixels too
-						topLeft.x = roundf( topLeft.x );
-						topLeft.y = roundf( topLeft.y );
-						bottomRight = topLeft + glyphSize;
-
-						topLeft = derivedTopLeft + topLeft * invWindowRes;
-						bottomRight = derivedTopLeft + bottomRight * invWindowRes;
-
-						addQuad( textVertBuffer,                                               //
-								 topLeft - backgroundDisplacement,                             //
-								 bottomRight + backgroundDisplacement,                         //
-								 1, 1,                                                         //
-								 backgroundColour, parentDerivedTL, parentDerivedBR, invSize,  //
-								 0,                                                            //
-								 canvasAr, invCanvasAr, derivedRot );
-						textVertBuffer += 6u;
-						m_numVertices += 6u;
+						quad.topLeft.x = roundf( quad.topLeft.x );
+						quad.topLeft.y = roundf( quad.topLeft.y );
+						quad.bottomRight = quad.topLeft + glyphSize;
+
+						m_backgroundQuads.push_back( quad );
 
 						Ogre::Vector2 nextCaret = shapedGlyph.caretPos;
 						if( shapedGlyph.isNewline && itor + 1u != end )
@@ -1173,6 +1969,70 @@ namespace Colibri
 
 			++itRichText;
 		}
+	}
+	//-------------------------------------------------------------------------
+	size_t Label::findFirstGlyphQuad( size_t glyphIdx ) const
+	{
+		size_t first = 0u;
+		size_t count = m_glyphQuads.size();
+		while( count > 0u )
+		{
+			const size_t step = count / 2u;
+			if( m_glyphQuads[first + step].glyphIdx < glyphIdx )
+			{
+				first += step + 1u;
+				count -= step + 1u;
+			}
+			else
+				count = step;
+		}
+		return first;
+	}
+	//-------------------------------------------------------------------------
+	GlyphVertex *Label::fillBackground( GlyphVertex *RESTRICT_ALIAS textVertBuffer,
+										const Ogre::Vector2 halfWindowRes,
+										const Ogre::Vector2 invWindowRes,
+										const Ogre::Vector2 parentDerivedTL,
+										const Ogre::Vector2 parentDerivedBR )
+	{
+		COLIBRI_ASSERT_MEDIUM( m_glyphQuadsState == m_currentState );
+
+		const Ogre::Vector2 invSize = 1.0f / ( parentDerivedBR - parentDerivedTL );
+
+		// Snap position to pixels
+		Ogre::Vector2 derivedTopLeft = m_derivedTopLeft;
+		derivedTopLeft = ( derivedTopLeft + 1.0f ) * halfWindowRes;
+		derivedTopLeft.x = roundf( derivedTopLeft.x );
+		derivedTopLeft.y = roundf( derivedTopLeft.y );
+		derivedTopLeft = derivedTopLeft * invWindowRes - 1.0f;
+
+		const Matrix2x3 derivedRot = m_derivedOrientation;
+		const float canvasAr = m_manager->getCanvasAspectRatio();
+		const float invCanvasAr = m_manager->getCanvasInvAspectRatio();
+
+		const Ogre::Vector2 backgroundDisplacement = invWindowRes * m_backgroundSize;
+
+		GlyphQuadVec::const_iterator itor = m_backgroundQuads.begin();
+		GlyphQuadVec::const_iterator endt = m_backgroundQuads.end();
+
+		while( itor != endt )
+		{
+			const Ogre::Vector2 topLeft = derivedTopLeft + itor->topLeft * invWindowRes;
+			const Ogre::Vector2 bottomRight = derivedTopLeft + itor->bottomRight * invWindowRes;
+
+			addQuad( textVertBuffer,                                 //
+					 topLeft - backgroundDisplacement,               //
+					 bottomRight + backgroundDisplacement,           //
+					 itor->width, itor->height,                      //
+					 itor->rgbaColour, 0u, itor->shadowOffset,       //
+					 parentDerivedTL, parentDerivedBR, invSize,      //
+					 itor->offsetStart,                              //
+					 canvasAr, invCanvasAr, derivedRot );
+			textVertBuffer += 6u;
+			m_numVertices += 6u;
+
+			++itor;
+		}
 
 		return textVertBuffer;
 	}
@@ -1201,12 +2061,20 @@ namespace Colibri
 		m_currVertexBufferOffset =
 			static_cast<uint32_t>( textVertBuffer - m_manager->_getTextVertexBufferBase() );
 
-		const uint32_t shadowColour = m_shadowColour.getAsABGR();
+		const uint32_t shadowColour = m_shadowOutline ? m_shadowColour.getAsABGR() : 0u;
 
 		const Ogre::Vector2 halfWindowRes = m_manager->getHalfWindowResolution();
 		const Ogre::Vector2 invWindowRes = m_manager->getInvWindowResolution2x();
 
-		const Ogre::Vector2 shadowDisplacement = invWindowRes * m_shadowDisplace;
+		// Glyph quads are enlarged to also cover their shadow
+		Ogre::Vector2 shadowGrowTL( Ogre::Vector2::ZERO );
+		Ogre::Vector2 shadowGrowBR( Ogre::Vector2::ZERO );
+		if( m_shadowOutline )
+		{
+			const Ogre::Vector2 shadowDisplacement = invWindowRes * m_shadowDisplace;
+			shadowGrowTL.makeFloor( shadowDisplacement );
+			shadowGrowBR.makeCeil( shadowDisplacement );
+		}
 
 		Ogre::Vector2 invCanvasSize2x = m_manager->getInvCanvasSize2x();
 		Ogre::Vector2 parentDerivedTL =
@@ -1225,11 +2093,12 @@ namespace Colibri
 
 		const Ogre::Vector2 invSize = 1.0f / ( parentDerivedBR - parentDerivedTL );
 
+		updateGlyphQuads();
+
 		if( m_usesBackground )
 		{
-			const bool isHoriz = m_actualVertReadingDir[m_currentState] == VertReadingDir::Disabled;
 			textVertBuffer = fillBackground( textVertBuffer, halfWindowRes, invWindowRes,
-											 parentDerivedTL, parentDerivedBR, isHoriz );
+											 parentDerivedTL, parentDerivedBR );
 		}
 
 		// Snap position to pixels
@@ -1243,76 +2112,96 @@ namespace Colibri
 		const float canvasAr = m_manager->getCanvasAspectRatio();
 		const float invCanvasAr = m_manager->getCanvasInvAspectRatio();
 
-		ShapedGlyphVec::const_iterator itor = m_shapes[m_currentState].begin();
-		ShapedGlyphVec::const_iterator endt = m_shapes[m_currentState].end();
+		size_t firstGlyph = 0u;
+		size_t endGlyph = m_shapes[m_currentState].size();
 
-		while( itor != endt )
+		if( m_largeTextMode || m_glyphBudgetDirty )
 		{
-			const ShapedGlyph &shapedGlyph = *itor;
-
-			if( !shapedGlyph.isNewline && !shapedGlyph.isTab && !shapedGlyph.isPrivateArea )
+			if( !m_lines[m_currentState].empty() )
 			{
-				Ogre::Vector2 topLeft, bottomRight;
-				getCorners( shapedGlyph, topLeft, bottomRight );
-
-				const Ogre::Vector2 glyphSize = bottomRight - topLeft;
+				// Clip rect relative to the Label, in pixels (like the glyphs' corners)
+				const float cullMargin = getLineCullMargin( m_shadowOutline, m_shadowDisplace );
+				const float clipTop =
+					( parentDerivedTL.y - derivedTopLeft.y ) * halfWindowRes.y - cullMargin;
+				const float clipBottom =
+					( parentDerivedBR.y - derivedTopLeft.y ) * halfWindowRes.y + cullMargin;
+
+				size_t firstLine, endLine;
+				findVisibleLines( clipTop, clipBottom, firstLine, endLine );
+
+				const LineRangeVec &lines = m_lines[m_currentState];
+				if( firstLine < endLine )
+				{
+					firstGlyph = std::min<size_t>( lines[firstLine].glyphStart, endGlyph );
+					endGlyph = std::min<size_t>( lines[endLine - 1u].glyphEnd, endGlyph );
+				}
+				else
+					firstGlyph = endGlyph;
+			}
 
-				// Snap each glyph to pixels too
-				topLeft.x = roundf( topLeft.x );
-				topLeft.y = roundf( topLeft.y );
-				bottomRight = topLeft + glyphSize;
+			// Never emit more than what ColibriManager made room for
+			endGlyph = std::min( endGlyph, firstGlyph + m_visibleGlyphBudget[m_currentState] );
+		}
 
-				topLeft = derivedTopLeft + topLeft * invWindowRes;
-				bottomRight = derivedTopLeft + bottomRight * invWindowRes;
+		GlyphQuadVec::const_iterator itor = m_glyphQuads.begin();
+		GlyphQuadVec::const_iterator endt = m_glyphQuads.end();
+		if( firstGlyph != 0u || endGlyph != m_shapes[m_currentState].size() )
+		{
+			itor = m_glyphQuads.begin() + ptrdiff_t( findFirstGlyphQuad( firstGlyph ) );
+			endt = m_glyphQuads.begin() + ptrdiff_t( findFirstGlyphQuad( endGlyph ) );
+		}
 
-				if( m_shadowOutline )
-				{
-					addQuad( textVertBuffer,                                           //
-							 topLeft + shadowDisplacement,                             //
-							 bottomRight + shadowDisplacement,                         //
-							 shapedGlyph.glyph->width, shapedGlyph.glyph->height,      //
-							 shadowColour, parentDerivedTL, parentDerivedBR, invSize,  //
-							 shapedGlyph.glyph->offsetStart,                           //
-							 canvasAr, invCanvasAr, derivedRot );
-					textVertBuffer += 6u;
-					m_numVertices += 6u;
-				}
+		while( itor != endt )
+		{
+			const GlyphQuad &quad = *itor;
 
-				const RichText &richText = m_richText[m_currentState][shapedGlyph.richTextIdx];
+			const Ogre::Vector2 topLeft = derivedTopLeft + quad.topLeft * invWindowRes;
+			const Ogre::Vector2 bottomRight = derivedTopLeft + quad.bottomRight * invWindowRes;
 
-				addQuad( textVertBuffer, topLeft, bottomRight,                        //
-						 shapedGlyph.glyph->width, shapedGlyph.glyph->height,         //
-						 richText.rgba32, parentDerivedTL, parentDerivedBR, invSize,  //
-						 shapedGlyph.glyph->offsetStart,                              //
-						 canvasAr, invCanvasAr, derivedRot );
-				textVertBuffer += 6u;
+			addQuad( textVertBuffer,                                       //
+					 topLeft + shadowGrowTL, bottomRight + shadowGrowBR,  //
+					 quad.width, quad.height,                              //
+					 quad.rgbaColour, shadowColour, quad.shadowOffset,     //
+					 parentDerivedTL, parentDerivedBR, invSize,            //
+					 quad.offsetStart,                                     //
+					 canvasAr, invCanvasAr, derivedRot );
+			textVertBuffer += 6u;
 
-				m_numVertices += 6u;
-			}
+			m_numVertices += 6u;
 
 			++itor;
 		}
 
 		*_textVertBuffer = textVertBuffer;
 
-		const Ogre::Vector2 outerTopLeft = this->m_derivedTopLeft;
-		const Matrix2x3 &finalRot = this->m_derivedOrientation;
-		const Ogre::Vector2 outerTopLeftWithClipping = outerTopLeft + m_clipBorderTL * invCanvasSize2x;
-
-		WidgetVec::const_iterator itChild = m_children.begin();
-		WidgetVec::const_iterator enChild = m_children.end();
+		fillChildrenBuffers( vertexBuffer, _textVertBuffer, Ogre::Vector2::ZERO );
+	}
+	//-------------------------------------------------------------------------
+	void Label::_notifyGlyphsRelocated( const std::vector<const CachedGlyph *> &sortedGlyphs )
+	{
+		// Only the current state is in our vertices. Changing state fills them again anyway
+		ShapedGlyphVec::const_iterator itor = m_shapes[m_currentState].begin();
+		ShapedGlyphVec::const_iterator endt = m_shapes[m_currentState].end();
 
-		while( itChild != enChild )
+		while( itor != endt )
 		{
-			( *itChild )
-				->_fillBuffersAndCommands( vertexBuffer, _textVertBuffer, outerTopLeftWithClipping,
-										   Ogre::Vector2::ZERO, finalRot );
-			++itChild;
+			if( std::binary_search( sortedGlyphs.begin(), sortedGlyphs.end(), itor->glyph ) )
+			{
+				invalidateGlyphQuads( m_currentState );
+				_setVisualsDirty();
+				return;
+			}
+			++itor;
 		}
 	}
 	//-------------------------------------------------------------------------
 	void Label::_updateDirtyGlyphs()
 	{
+		// ColibriManager is iterating through its dirty Labels. Placing glyphs must not add us
+		// again. Whatever updateVisibleGlyphBudget requests is applied below
+		const bool bUseBudget = m_largeTextMode || m_glyphBudgetDirty;
+		m_glyphBudgetDirty = true;
+
 		for( size_t i = 0; i < States::NumStates; ++i )
 		{
 			if( m_glyphsDirty[i] )
@@ -1321,6 +2210,27 @@ namespace Colibri
 			if( !m_glyphsPlaced[i] )
 				placeGlyphs( static_cast<States::States>( i ) );
 		}
+
+		if( bUseBudget )
+		{
+			bool bBudgetGrew = false;
+			for( size_t i = 0; i < States::NumStates; ++i )
+			{
+				if( m_requiredGlyphBudget[i] > m_visibleGlyphBudget[i] )
+				{
+					m_visibleGlyphBudget[i] = m_requiredGlyphBudget[i];
+					bBudgetGrew = true;
+				}
+			}
+
+			if( bBudgetGrew )
+			{
+				m_manager->_notifyNumGlyphsIsDirty();
+				_setVertexCountsDirty();
+			}
+		}
+
+		m_glyphBudgetDirty = false;
 	}
 	//-------------------------------------------------------------------------
 	bool Label::isAnyStateDirty() const
@@ -1334,26 +2244,37 @@ namespace Colibri
 	//-------------------------------------------------------------------------
 	void Label::flagDirty( States::States state )
 	{
-		if( !isAnyStateDirty() )
+		if( !isAnyStateDirty() && !m_glyphBudgetDirty )
 			m_manager->_addDirtyLabel( this );
 		m_glyphsDirty[state] = true;
 		m_glyphsPlaced[state] = false;
 #if COLIBRIGUI_DEBUG_MEDIUM
 		m_glyphsAligned[state] = false;
 #endif
+		m_textEdits[state].bPending = false;
+		m_textAppends[state].bPending = false;
 		m_usesBackground = false;
+		invalidateGlyphQuads( state );
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	size_t Label::getMaxNumGlyphs() const
 	{
-		size_t retVal = 0;
+		const bool bUseBudget = m_largeTextMode || m_glyphBudgetDirty;
+
+		size_t maxGlyphs = 0;
+		size_t maxVisibleGlyphs = 0;
 		for( size_t i = 0; i < States::NumStates; ++i )
-			retVal = std::max( m_shapes[i].size(), retVal );
+		{
+			maxGlyphs = std::max( m_shapes[i].size(), maxGlyphs );
+			maxVisibleGlyphs = std::max( bUseBudget ? m_visibleGlyphBudget[i] : m_shapes[i].size(),
+										 maxVisibleGlyphs );
+		}
 
-		const size_t maxGlyphs = retVal;
+		// Shadows are drawn in the same quad as their glyph
+		size_t retVal = maxVisibleGlyphs;
 
-		if( m_shadowOutline )
-			retVal += maxGlyphs;
+		// Backgrounds are never culled
 		if( m_usesBackground )
 			retVal += maxGlyphs;
 
@@ -1385,6 +2306,242 @@ namespace Colibri
 		}
 	}
 	//-------------------------------------------------------------------------
+	void Label::replaceText( size_t utf16Start, size_t utf16Length, const char *utf8Text,
+							 States::States forState )
+	{
+		if( forState == States::NumStates )
+		{
+			for( size_t i = 0; i < States::NumStates; ++i )
+				replaceText( utf16Start, utf16Length, utf8Text, static_cast<States::States>( i ) );
+			return;
+		}
+
+		std::string &text = m_text[forState];
+
+		const size_t start = utf16ToUtf8Offset( text.c_str(), text.size(), utf16Start );
+		const size_t end =
+			start + utf16ToUtf8Offset( text.c_str() + start, text.size() - start, utf16Length );
+		const size_t insertLength = strlen( utf8Text );
+
+		if( start == end && insertLength == 0u )
+			return;
+
+		TextEdit edit = m_textEdits[forState];
+
+		bool bIncremental = edit.bPending;
+		if( !bIncremental && !m_glyphsDirty[forState] && m_richText[forState].size() == 1u )
+		{
+			// Only the default RichText can be kept as is. Otherwise behave like setText
+			const RichText &richText = m_richText[forState][0];
+			const RichText defaultRichText = getDefaultRichText();
+			bIncremental = richText.offset == 0u && richText.length == text.size() &&
+						   richText.ptSize == defaultRichText.ptSize &&
+						   richText.font == defaultRichText.font &&
+						   richText.readingDir == defaultRichText.readingDir &&
+						   richText.rgba32 == defaultRichText.rgba32 &&
+						   richText.backgroundRgba32 == defaultRichText.backgroundRgba32 &&
+						   richText.noBackground == defaultRichText.noBackground;
+
+			edit.start = start;
+			edit.end = start;
+			edit.utf16Delta = 0;
+		}
+
+		if( bIncremental )
+		{
+			// Merge with the edits done since the glyphs were last updated
+			size_t editEnd;
+			if( edit.end <= start )
+				editEnd = edit.end;
+			else if( edit.end >= end )
+				editEnd = edit.end - ( end - start ) + insertLength;
+			else
+				editEnd = start + insertLength;
+
+			edit.start = std::min( edit.start, start );
+			edit.end = std::max( editEnd, start + insertLength );
+			edit.utf16Delta += ptrdiff_t( countUtf16( utf8Text, insertLength ) ) -
+							   ptrdiff_t( countUtf16( text.c_str() + start, end - start ) );
+			edit.bPending = true;
+		}
+
+		text.replace( start, end - start, utf8Text, insertLength );
+
+		if( bIncremental )
+			m_richText[forState][0].length = static_cast<uint32_t>( text.size() );
+		else
+			m_richText[forState].clear();
+
+		flagDirty( forState );
+
+		if( bIncremental )
+			m_textEdits[forState] = edit;
+	}
+	//-------------------------------------------------------------------------
+	void Label::appendText( const std::string &text, const RichTextVec *colibri_nullable richText,
+							States::States forState )
+	{
+		if( forState == States::NumStates )
+		{
+			for( size_t i = 0; i < States::NumStates; ++i )
+				appendText( text, richText, static_cast<States::States>( i ) );
+			return;
+		}
+
+		if( text.empty() )
+			return;
+
+		TextAppend append = m_textAppends[forState];
+
+		// Glyphs can be updated incrementally if they were up to date before
+		// (or they will be once the previous appends are processed)
+		bool bIncremental =
+			append.bPending || ( !m_glyphsDirty[forState] && !m_textEdits[forState].bPending );
+		if( !append.bPending )
+		{
+			append.numEvictedGlyphs = 0u;
+			append.numEvictedRichText = 0u;
+			append.numNewRichText = 0u;
+			append.bFirstCut = false;
+		}
+
+		// Make sure the RichText of the previous text covers it, before appending ours
+		validateRichText( forState );
+
+		std::string &ourText = m_text[forState];
+		RichTextVec &ourRichText = m_richText[forState];
+
+		const uint32_t appendOffset = static_cast<uint32_t>( ourText.size() );
+		ourText += text;
+
+		const size_t prevNumRichText = ourRichText.size();
+		if( richText && !richText->empty() )
+		{
+			RichTextVec::const_iterator itor = richText->begin();
+			RichTextVec::const_iterator endt = richText->end();
+			while( itor != endt )
+			{
+				ourRichText.push_back( *itor );
+				ourRichText.back().offset += appendOffset;
+				++itor;
+			}
+		}
+		else
+		{
+			RichText rt = getDefaultRichText();
+			rt.offset = appendOffset;
+			rt.length = static_cast<uint32_t>( text.size() );
+			ourRichText.push_back( rt );
+		}
+		append.numNewRichText += ourRichText.size() - prevNumRichText;
+
+		// Find where the lines to keep start. The last line is always kept.
+		// A trailing '\n' doesn't start a new line until something is appended after it
+		const size_t textSize = ourText.size();
+		size_t lastLineStart = textSize > 1u ? ourText.rfind( '\n', textSize - 2u ) : std::string::npos;
+		lastLineStart = lastLineStart == std::string::npos ? 0u : lastLineStart + 1u;
+
+		size_t cut = 0u;
+		if( m_appendMaxLines != 0u && lastLineStart != 0u )
+		{
+			size_t numLines = 1u;
+			size_t newlinePos = lastLineStart - 1u;
+			while( numLines < m_appendMaxLines && newlinePos != std::string::npos )
+			{
+				++numLines;
+				newlinePos = newlinePos == 0u ? std::string::npos
+											  : ourText.rfind( '\n', newlinePos - 1u );
+			}
+			if( newlinePos != std::string::npos )
+				cut = newlinePos + 1u;
+		}
+		if( m_appendMaxBytes != 0u && textSize > m_appendMaxBytes )
+		{
+			const size_t minCut = textSize - m_appendMaxBytes;
+			size_t byteCut = minCut;
+			if( ourText[minCut - 1u] != '\n' )
+			{
+				byteCut = ourText.find( '\n', minCut );
+				byteCut = byteCut == std::string::npos ? textSize : byteCut + 1u;
+			}
+			cut = std::max( cut, byteCut );
+		}
+		cut = std::min( cut, lastLineStart );
+
+		if( cut != 0u )
+		{
+			// Evict the RichText that only covers evicted text
+			size_t numEvictedRichText = 0u;
+			while( numEvictedRichText < ourRichText.size() &&
+				   ourRichText[numEvictedRichText].offset +
+						   ourRichText[numEvictedRichText].length <=
+					   cut )
+			{
+				const RichText &evicted = ourRichText[numEvictedRichText];
+				if( ourRichText.size() - numEvictedRichText > append.numNewRichText )
+				{
+					// It was shaped. Its glyphs must be released
+					if( !append.bFirstCut )
+						append.numEvictedGlyphs += evicted.glyphEnd - evicted.glyphStart;
+					++append.numEvictedRichText;
+				}
+				else
+				{
+					--append.numNewRichText;
+				}
+				append.bFirstCut = false;
+				++numEvictedRichText;
+			}
+			ourRichText.erase( ourRichText.begin(),
+							   ourRichText.begin() + ptrdiff_t( numEvictedRichText ) );
+
+			RichTextVec::iterator itor = ourRichText.begin();
+			RichTextVec::iterator endt = ourRichText.end();
+			while( itor != endt )
+			{
+				if( itor->offset < cut )
+				{
+					// Partially evicted
+					if( itor != ourRichText.begin() )
+					{
+						// RichText isn't sorted. Too complex to track, shape everything again
+						bIncremental = false;
+					}
+					else if( ourRichText.size() > append.numNewRichText && !append.bFirstCut )
+					{
+						append.numEvictedGlyphs += itor->glyphEnd - itor->glyphStart;
+						append.bFirstCut = true;
+					}
+					const size_t end = itor->offset + itor->length;
+					itor->length = static_cast<uint32_t>( end > cut ? end - cut : 0u );
+					itor->offset = static_cast<uint32_t>( cut );
+				}
+				itor->offset -= static_cast<uint32_t>( cut );
+				++itor;
+			}
+
+			ourText.erase( 0u, cut );
+		}
+
+		flagDirty( forState );
+
+		if( bIncremental )
+		{
+			append.bPending = true;
+			m_textAppends[forState] = append;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void Label::setAppendLimits( size_t maxLines, size_t maxBytes )
+	{
+		m_appendMaxLines = maxLines;
+		m_appendMaxBytes = maxBytes;
+	}
+	//-------------------------------------------------------------------------
+	size_t Label::getAppendMaxLines() const { return m_appendMaxLines; }
+	//-------------------------------------------------------------------------
+	size_t Label::getAppendMaxBytes() const { return m_appendMaxBytes; }
+	//-------------------------------------------------------------------------
 	const std::string &Label::getText( States::States state )
 	{
 		if( state == States::NumStates )
@@ -1462,11 +2619,11 @@ namespace Colibri
 
 			Ogre::Vector2 topLeft;
 			topLeft = shapedGlyph.caretPos;
-			topLeft.x += shapedGlyph.glyph->bearingX;
-			topLeft.y -= shapedGlyph.glyph->newlineSize;
+			topLeft.x += shapedGlyph.getBearingX();
+			topLeft.y -= shapedGlyph.getNewlineSize();
 			localTopLeft += topLeft * invWindowRes * canvasSize;
 
-			ptSize = shapedGlyph.glyph->ptSize;
+			ptSize = uint32_t( float( shapedGlyph.glyph->ptSize ) * shapedGlyph.glyphScale + 0.5f );
 			outFontIdx = shapedGlyph.glyph->font;
 		}
 		else if( !m_shapes[m_currentState].empty() )
@@ -1476,10 +2633,10 @@ namespace Colibri
 			Ogre::Vector2 topRight;
 			topRight = shapedGlyph.caretPos;
 			topRight.x += shapedGlyph.advance.x + 1.0f;
-			topRight.y -= shapedGlyph.glyph->newlineSize;
+			topRight.y -= shapedGlyph.getNewlineSize();
 			localTopLeft += topRight * invWindowRes * canvasSize;
 
-			ptSize = shapedGlyph.glyph->ptSize;
+			ptSize = uint32_t( float( shapedGlyph.glyph->ptSize ) * shapedGlyph.glyphScale + 0.5f );
 			outFontIdx = shapedGlyph.glyph->font;
 		}
 		else
@@ -1678,6 +2835,13 @@ namespace Colibri
 		{
 			if( m_rasterPrivateArea )
 				m_rasterPrivateArea->setSize( m_size );
+
+			if( m_largeTextMode )
+			{
+				// Our parent may have been resized. It changes how many lines fit
+				for( size_t i = 0; i < States::NumStates; ++i )
+					updateVisibleGlyphBudget( static_cast<States::States>( i ) );
+			}
 		}
 
 		Renderable::setTransformDirty( dirtyReason );
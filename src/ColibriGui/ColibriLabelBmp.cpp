@@ -26,10 +26,14 @@ namespace Colibri
 		m_fontSize( m_manager->getDefaultFontSize26d6() ),
 		m_font( 0 )
 	{
-		setVao( m_manager->getVao() );
+		setVao( m_manager->getVaoBmp() );
 
 		m_numVertices = 0;
 
+		//We use this magic value 6374 to indicate our vertices are not indexed.
+		//Must be set before setDatablock so it's accounted in the hash.
+		setCustomParameter( 6374, Ogre::Vector4( 1.0f ) );
+
 		ShaperManager *shaperManager = m_manager->getShaperManager();
 		Ogre::HlmsDatablock *datablock = shaperManager->getBmpFont( m_font )->getDatablock();
 		COLIBRI_ASSERT_MEDIUM(
@@ -52,9 +56,14 @@ namespace Colibri
 		m_shadowOutline = enable;
 		m_shadowColour = shadowColour;
 		m_shadowDisplace = shadowDisplace;
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
-	void LabelBmp::setFontSize( FontSize fontSize ) { m_fontSize = fontSize; }
+	void LabelBmp::setFontSize( FontSize fontSize )
+	{
+		m_fontSize = fontSize;
+		_setVisualsDirty();
+	}
 	//-------------------------------------------------------------------------
 	void LabelBmp::setFont( uint16_t font )
 	{
@@ -77,7 +86,11 @@ namespace Colibri
 		}
 	}
 	//-------------------------------------------------------------------------
-	void LabelBmp::setTextColour( const Ogre::ColourValue &colour ) { m_colour = colour; }
+	void LabelBmp::setTextColour( const Ogre::ColourValue &colour )
+	{
+		m_colour = colour;
+		_setVisualsDirty();
+	}
 	//-------------------------------------------------------------------------
 	void LabelBmp::updateGlyphs()
 	{
@@ -87,10 +100,14 @@ namespace Colibri
 		BmpFont *font = shaperManager->getBmpFont( m_font );
 		font->renderString( m_text[m_currentState], m_shapes );
 		m_glyphsDirty = false;
+		_setVisualsDirty();
 
 		const size_t currNumGlyphs = m_shapes.size();
 		if( currNumGlyphs > prevNumGlyphs )
+		{
 			m_manager->_notifyNumGlyphsBmpIsDirty();
+			_setVertexCountsDirty();
+		}
 	}
 	//-------------------------------------------------------------------------
 	void LabelBmp::_fillBuffersAndCommands( UiVertex **RESTRICT_ALIAS _vertexBuffer,
@@ -250,20 +267,7 @@ namespace Colibri
 
 		*_vertexBuffer = vertexBuffer;
 
-		const Ogre::Vector2 outerTopLeft = this->m_derivedTopLeft;
-		const Matrix2x3 &finalRot = this->m_derivedOrientation;
-		const Ogre::Vector2 outerTopLeftWithClipping = outerTopLeft + m_clipBorderTL * invCanvasSize2x;
-
-		WidgetVec::const_iterator itChild = m_children.begin();
-		WidgetVec::const_iterator enChild = m_children.end();
-
-		while( itChild != enChild )
-		{
-			( *itChild )
-				->_fillBuffersAndCommands( _vertexBuffer, _textVertBuffer, outerTopLeftWithClipping,
-										   Ogre::Vector2::ZERO, finalRot );
-			++itChild;
-		}
+		fillChildrenBuffers( _vertexBuffer, _textVertBuffer, Ogre::Vector2::ZERO );
 	}
 	//-------------------------------------------------------------------------
 	void LabelBmp::_updateDirtyGlyphs() { updateGlyphs(); }
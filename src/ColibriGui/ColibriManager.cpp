@@ -5,6 +5,7 @@
 #include "ColibriGui/ColibriLabelBmp.h"
 #include "ColibriGui/ColibriSkinManager.h"
 #include "ColibriGui/ColibriWindow.h"
+#include "ColibriGui/ColibriWorkerPool.h"
 
 #include "ColibriGui/Text/ColibriShaperManager.h"
 
@@ -14,10 +15,16 @@
 #include "Vao/OgreVaoManager.h"
 #include "Vao/OgreVertexArrayObject.h"
 #include "Vao/OgreIndirectBufferPacked.h"
+#include "Vao/OgreTexBufferPacked.h"
+#if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
+#	include "Vao/OgreReadOnlyBufferPacked.h"
+#endif
 #include "Math/Array/OgreObjectMemoryManager.h"
 #include "OgreHlmsManager.h"
 #include "OgreHlms.h"
 #include "OgreRoot.h"
+#include "OgreRenderSystem.h"
+#include "OgreTimer.h"
 #include "CommandBuffer/OgreCommandBuffer.h"
 #include "CommandBuffer/OgreCbDrawCall.h"
 
@@ -42,6 +49,8 @@ namespace Colibri
 		m_numLabelsAndBmp( 0u ),
 		m_numTextGlyphs( 0u ),
 		m_numTextGlyphsBmp( 0u ),
+		m_numUnsharedGrids( 0u ),
+		m_collectingBreadthFirstFill( false ),
 		m_logListener( &DefaultLogListener ),
 		m_colibriListener( &DefaultColibriListener ),
 		m_delayingDestruction( false ),
@@ -57,6 +66,11 @@ namespace Colibri
 		m_objectMemoryManager( 0 ),
 		m_sceneManager( 0 ),
 		m_vao( 0 ),
+		m_vaoBmp( 0 ),
+		m_textVao( 0 ),
+		m_vaoInstanced( 0 ),
+		m_defaultIndexBuffer( 0 ),
+		m_instanceBuffer( 0 ),
 		m_indirectBuffer( 0 ),
 		m_commandBuffer( 0 ),
 		m_allowingScrollAlways( false ),
@@ -78,7 +92,18 @@ namespace Colibri
 		m_skinManager( 0 ),
 		m_shaperManager( 0 ),
 		m_vertexBufferBase( 0 ),
-		m_textVertexBufferBase( 0 )
+		m_textVertexBufferBase( 0 ),
+		m_vertexBufferCpu( 0 ),
+		m_textVertexBufferCpu( 0 ),
+		m_vertexBufferCpuSize( 0u ),
+		m_textVertexBufferCpuSize( 0u ),
+		m_pendingVertexUploads( 0u ),
+		m_allWindowsVisualsDirty( true ),
+		m_redrawRequested( true ),
+		m_instancedWidgets( false ),
+		m_simdVertexFill( true ),
+		m_lastVertexFillMicroseconds( 0u ),
+		m_workerPool( 0 )
 	#if COLIBRIGUI_DEBUG_MEDIUM
 	,	m_fillBuffersStarted( false )
 	,	m_renderingStarted( false )
@@ -105,6 +130,11 @@ namespace Colibri
 		setOgre( 0, 0, 0 );
 		delete m_skinManager;
 		m_skinManager = 0;
+
+		delete[] m_vertexBufferCpu;
+		m_vertexBufferCpu = 0;
+		delete[] m_textVertexBufferCpu;
+		m_textVertexBufferCpu = 0;
 	}
 	//-------------------------------------------------------------------------
 	void ColibriManager::setLogListener( LogListener *logListener )
@@ -139,16 +169,32 @@ namespace Colibri
 			m_vaoManager->destroyIndirectBuffer( m_indirectBuffer );
 			m_indirectBuffer = 0;
 		}
+		destroyInstanceBuffer();
+		if( m_vaoInstanced )
+		{
+			Ogre::ColibriOgreRenderable::destroyVao( m_vaoInstanced, m_vaoManager );
+			m_vaoInstanced = 0;
+		}
+		if( m_vaoBmp )
+		{
+			Ogre::ColibriOgreRenderable::destroySharedVao( m_vaoBmp, m_vaoManager );
+			m_vaoBmp = 0;
+		}
 		if( m_vao )
 		{
 			Ogre::ColibriOgreRenderable::destroyVao( m_vao, m_vaoManager );
 			m_vao = 0;
 		}
-		/*if( m_defaultIndexBuffer )
+		if( m_textVao )
+		{
+			Ogre::ColibriOgreRenderable::destroyVao( m_textVao, m_vaoManager );
+			m_textVao = 0;
+		}
+		if( m_defaultIndexBuffer )
 		{
 			m_vaoManager->destroyIndexBuffer( m_defaultIndexBuffer );
 			m_defaultIndexBuffer = 0;
-		}*/
+		}
 		delete m_objectMemoryManager;
 		m_objectMemoryManager = 0;
 
@@ -159,15 +205,20 @@ namespace Colibri
 		if( vaoManager )
 		{
 			m_objectMemoryManager = new Ogre::ObjectMemoryManager();
-			//m_defaultIndexBuffer = Ogre::ColibriOgreRenderable::createIndexBuffer( vaoManager );
-			m_vao = Ogre::ColibriOgreRenderable::createVao( 6u * 9u, vaoManager );
+			m_defaultIndexBuffer = Ogre::ColibriOgreRenderable::createIndexBuffer( vaoManager );
+			m_vao = Ogre::ColibriOgreRenderable::createVao( 16u, m_defaultIndexBuffer, vaoManager );
+			m_vaoBmp = Ogre::ColibriOgreRenderable::createUnindexedVao( m_vao, vaoManager );
 			m_textVao = Ogre::ColibriOgreRenderable::createTextVao( 6u * 16u, vaoManager );
-			size_t requiredBytes = 1u * sizeof( Ogre::CbDrawStrip );
+			m_vaoInstanced = Ogre::ColibriOgreRenderable::createInstancedVao( vaoManager );
+			size_t requiredBytes = 1u * sizeof( Ogre::CbDrawIndexed );
 			m_indirectBuffer = m_vaoManager->createIndirectBuffer( requiredBytes,
 																   Ogre::BT_DYNAMIC_PERSISTENT,
 																   0, false );
 			m_commandBuffer = new Ogre::CommandBuffer();
 			m_commandBuffer->setCurrentRenderSystem( m_sceneManager->getDestinationRenderSystem() );
+
+			// The new GPU buffers hold none of our vertices
+			m_allWindowsVisualsDirty = true;
 		}
 
 		if( m_shaperManager )
@@ -320,6 +371,8 @@ namespace Colibri
 			(*itor)->_notifyCanvasChanged();
 			++itor;
 		}
+
+		m_allWindowsVisualsDirty = true;
 	}
 	//-------------------------------------------------------------------------
 	void ColibriManager::updateWidgetsFocusedByCursor()
@@ -793,7 +846,10 @@ namespace Colibri
 		Window *retVal = new Window( this );
 
 		if( !parent )
+		{
 			m_windows.push_back( retVal );
+			m_allWindowsVisualsDirty = true;
+		}
 		else
 		{
 			parent->m_childWindows.push_back( retVal );
@@ -843,6 +899,18 @@ namespace Colibri
 		++m_numLabelsAndBmp;
 	}
 	//-------------------------------------------------------------------------
+	void ColibriManager::_notifyGlyphsRelocated( const std::vector<const CachedGlyph *> &sortedGlyphs )
+	{
+		LabelVec::const_iterator itor = m_labels.begin();
+		LabelVec::const_iterator endt = m_labels.end();
+
+		while( itor != endt )
+		{
+			( *itor )->_notifyGlyphsRelocated( sortedGlyphs );
+			++itor;
+		}
+	}
+	//-------------------------------------------------------------------------
 	void ColibriManager::_notifyLabelBmpCreated( LabelBmp* label )
 	{
 		m_labelsBmp.push_back( label );
@@ -873,6 +941,8 @@ namespace Colibri
 			}
 			else
 				m_windows.erase( itor );
+
+			m_allWindowsVisualsDirty = true;
 		}
 
 		// Make sure this window is not in the dirtyWidgets list. It may have duplicates
@@ -985,6 +1055,7 @@ namespace Colibri
 	void ColibriManager::_setAsParentlessWindow( Window *window )
 	{
 		m_windows.push_back( window );
+		m_allWindowsVisualsDirty = true;
 	}
 	//-------------------------------------------------------------------------
 	void ColibriManager::setAsParentlessWindow( Window *window )
@@ -993,6 +1064,7 @@ namespace Colibri
 		{
 			window->detachFromParent();
 			m_windows.push_back( window );
+			m_allWindowsVisualsDirty = true;
 		}
 	}
 	//-------------------------------------------------------------------------
@@ -1056,6 +1128,12 @@ namespace Colibri
 		m_mouseCursorButtonDown = false;
 	}
 	//-----------------------------------------------------------------------------------
+	uint32_t ColibriManager::getVerticesPerWidget() const
+	{
+		return m_instancedWidgets ? static_cast<uint32_t>( sizeof( UiInstance ) / sizeof( UiVertex ) )
+								  : 16u;
+	}
+	//-------------------------------------------------------------------------
 	void ColibriManager::checkVertexBufferCapacity()
 	{
 		COLIBRI_ASSERT_LOW( m_dirtyLabels.empty() && "updateDirtyLabels has not been called!" );
@@ -1063,22 +1141,25 @@ namespace Colibri
 
 		bool anyVaoChanged = false;
 
-		if( m_numWidgets * sizeof( Ogre::CbDrawStrip ) > m_indirectBuffer->getNumElements() )
+		// CbDrawIndexed is the biggest of the two draw structs we may emit per widget
+		if( m_numWidgets * sizeof( Ogre::CbDrawIndexed ) > m_indirectBuffer->getNumElements() )
 		{
 			if( m_indirectBuffer->getMappingState() != Ogre::MS_UNMAPPED )
 				m_indirectBuffer->unmap( Ogre::UO_UNMAP_ALL );
 			m_vaoManager->destroyIndirectBuffer( m_indirectBuffer );
-			const size_t requiredBytes = m_numWidgets * sizeof( Ogre::CbDrawStrip );
+			const size_t requiredBytes = m_numWidgets * sizeof( Ogre::CbDrawIndexed );
 			m_indirectBuffer = m_vaoManager->createIndirectBuffer( requiredBytes,
 																   Ogre::BT_DYNAMIC_PERSISTENT,
 																   0, false );
 		}
 
 		{
-			// Vertex buffer for most widgets
+			// Vertex buffer for most widgets. Either an indexed 4x4 grid or one UiInstance
+			const Ogre::uint32 vertsPerWidget = getVerticesPerWidget();
 			const Ogre::uint32 requiredVertexCount = static_cast<Ogre::uint32>(
-				( m_numWidgets - m_numLabelsAndBmp ) * ( 6u * 9u ) +  // Regular widgets
-				( m_numTextGlyphsBmp * 6u )                           // BmpLabel
+				( m_numWidgets - m_numLabelsAndBmp ) * vertsPerWidget +  // Regular widgets
+				m_numUnsharedGrids * ( 6u * 9u - vertsPerWidget ) +      // Unshared grids
+				( m_numTextGlyphsBmp * 6u )                              // BmpLabel
 			);
 
 			Ogre::VertexBufferPacked *vertexBuffer = m_vao->getBaseVertexBuffer();
@@ -1088,8 +1169,11 @@ namespace Colibri
 				const Ogre::uint32 newVertexCount = std::max( requiredVertexCount,
 															  currVertexCount +
 															  (currVertexCount >> 1u) );
+				Ogre::ColibriOgreRenderable::destroySharedVao( m_vaoBmp, m_vaoManager );
 				Ogre::ColibriOgreRenderable::destroyVao( m_vao, m_vaoManager );
-				m_vao = Ogre::ColibriOgreRenderable::createVao( newVertexCount, m_vaoManager );
+				m_vao = Ogre::ColibriOgreRenderable::createVao( newVertexCount, m_defaultIndexBuffer,
+																m_vaoManager );
+				m_vaoBmp = Ogre::ColibriOgreRenderable::createUnindexedVao( m_vao, m_vaoManager );
 
 				anyVaoChanged = true;
 			}
@@ -1115,6 +1199,8 @@ namespace Colibri
 
 		if( anyVaoChanged )
 		{
+			m_allWindowsVisualsDirty = true;
+
 			WindowVec::const_iterator itor = m_windows.begin();
 			WindowVec::const_iterator end  = m_windows.end();
 
@@ -1127,9 +1213,101 @@ namespace Colibri
 
 	}
 	//-------------------------------------------------------------------------
+	void ColibriManager::syncInstanceBuffer()
+	{
+		if( !m_instancedWidgets )
+		{
+			destroyInstanceBuffer();
+			return;
+		}
+
+		const size_t requiredBytes = m_vao->getBaseVertexBuffer()->getNumElements() * sizeof( UiVertex );
+		if( m_instanceBuffer && m_instanceBuffer->getTotalSizeBytes() == requiredBytes )
+			return;
+
+		destroyInstanceBuffer();
+
+#if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
+		if( Ogre::HlmsColibri::needsReadOnlyBuffer( m_root->getRenderSystem()->getCapabilities(),
+													m_vaoManager ) )
+		{
+			m_instanceBuffer = m_vaoManager->createReadOnlyBuffer(
+				Ogre::PFG_RGBA32_FLOAT, requiredBytes, Ogre::BT_DYNAMIC_PERSISTENT, 0, false );
+		}
+		else
+#endif
+		{
+			m_instanceBuffer = m_vaoManager->createTexBuffer(
+				Ogre::PFG_RGBA32_FLOAT, requiredBytes, Ogre::BT_DYNAMIC_PERSISTENT, 0, false );
+		}
+
+		//The new buffer has none of the records yet
+		m_allWindowsVisualsDirty = true;
+	}
+	//-------------------------------------------------------------------------
+	void ColibriManager::destroyInstanceBuffer()
+	{
+		if( !m_instanceBuffer )
+			return;
+
+		if( m_instanceBuffer->getMappingState() != Ogre::MS_UNMAPPED )
+			m_instanceBuffer->unmap( Ogre::UO_UNMAP_ALL );
+
+#if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
+		if( m_instanceBuffer->getBufferPackedType() != Ogre::BP_TYPE_TEX )
+		{
+			m_vaoManager->destroyReadOnlyBuffer(
+				static_cast<Ogre::ReadOnlyBufferPacked *>( m_instanceBuffer ) );
+		}
+		else
+#endif
+		{
+			m_vaoManager->destroyTexBuffer( static_cast<Ogre::TexBufferPacked *>( m_instanceBuffer ) );
+		}
+		m_instanceBuffer = 0;
+
+		if( m_root )
+		{
+			Ogre::Hlms *hlms = m_root->getHlmsManager()->getHlms( Ogre::HLMS_UNLIT );
+			COLIBRI_ASSERT_HIGH( dynamic_cast<Ogre::HlmsColibri*>( hlms ) );
+			static_cast<Ogre::HlmsColibri*>( hlms )->setInstanceBuffer( 0 );
+		}
+	}
+	//-------------------------------------------------------------------------
+	void ColibriManager::setInstancedWidgets( bool bInstanced )
+	{
+		if( m_instancedWidgets == bInstanced )
+			return;
+
+		m_instancedWidgets = bInstanced;
+		m_allWindowsVisualsDirty = true;
+
+		WindowVec::const_iterator itor = m_windows.begin();
+		WindowVec::const_iterator end  = m_windows.end();
+
+		while( itor != end )
+		{
+			(*itor)->broadcastNewVao( m_vao, m_textVao );
+			// getVerticesPerWidget changed
+			(*itor)->m_maxVertexCountsDirty = true;
+			++itor;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void ColibriManager::setSimdVertexFill( bool bSimd )
+	{
+		if( m_simdVertexFill == bSimd )
+			return;
+
+		m_simdVertexFill = bSimd;
+		// The output is the same, but make sure the next fill measures the new setting
+		m_allWindowsVisualsDirty = true;
+	}
+	//-------------------------------------------------------------------------
 	template <typename T>
 	void ColibriManager::autosetNavigation( const std::vector<T> &container,
-											size_t _start, size_t _numWidgets )
+											size_t _start, size_t _numWidgets,
+											WidgetVec *colibri_nullable removedWidgets )
 	{
 		COLIBRI_ASSERT( _start + _numWidgets <= container.size() );
 
@@ -1151,6 +1329,62 @@ namespace Colibri
 			++itor;
 		}
 
+		//Find out which widgets changed since the last time. Their neighbours
+		//must be searched again, and they may be closer to the others' than before
+		bool searchAll = removedWidgets == 0;
+		uint32_t lastNavIndex = 0u;
+		bool hasLastNavIndex = false;
+
+		m_navigationSearch.clear();
+		m_navigationChangedWidgets.clear();
+
+		itor = container.begin() + start;
+		while( itor != end )
+		{
+			Widget *widget = *itor;
+			const bool navigable = widget->isKeyboardNavigable();
+
+			if( widget->m_navIndex == std::numeric_limits<uint32_t>::max() )
+			{
+				widget->m_navChanged = true;
+			}
+			else
+			{
+				//Widgets are only compared against the ones after them. If they
+				//were reordered, the cached results no longer apply
+				if( hasLastNavIndex && widget->m_navIndex <= lastNavIndex )
+					searchAll = true;
+				lastNavIndex = widget->m_navIndex;
+				hasLastNavIndex = true;
+
+				widget->m_navChanged = navigable != widget->m_navNavigable ||
+									   ( navigable && ( widget->m_navPosition != widget->m_position ||
+														widget->m_navSize != widget->m_size ) );
+			}
+
+			widget->m_navIndex = static_cast<uint32_t>( itor - container.begin() - start );
+			widget->m_navNavigable = navigable;
+			widget->m_navPosition = widget->m_position;
+			widget->m_navSize = widget->m_size;
+
+			if( navigable )
+			{
+				m_navigationSearch.addWidget( widget );
+				if( widget->m_navChanged )
+					m_navigationChangedWidgets.push_back( widget );
+			}
+
+			++itor;
+		}
+
+		//Comparing everyone against each changed widget is O(N) per widget.
+		//Past a certain point it's cheaper to just search everything again
+		if( m_navigationChangedWidgets.size() * 4u > _numWidgets )
+			searchAll = true;
+
+		if( removedWidgets )
+			std::sort( removedWidgets->begin(), removedWidgets->end() );
+
 		//Search for them again
 		itor = container.begin() + start;
 
@@ -1160,96 +1394,55 @@ namespace Colibri
 
 			if( widget->isKeyboardNavigable() )
 			{
-				Widget *closestSiblings[Borders::NumBorders] = { 0, 0, 0, 0 };
-				float closestSiblingDistances[Borders::NumBorders] =
+				bool needsSearch = searchAll || widget->m_navChanged;
+				for( size_t i=0; i<4u && !needsSearch; ++i )
+				{
+					//Check if it was removed first, it may be a dangling pointer
+					const Widget *closest = widget->m_navClosest[i];
+					needsSearch = closest && ( std::binary_search( removedWidgets->begin(),
+																   removedWidgets->end(), closest ) ||
+											   closest->m_navChanged );
+				}
+
+				if( needsSearch )
 				{
-					std::numeric_limits<float>::max(),
-					std::numeric_limits<float>::max(),
-					std::numeric_limits<float>::max(),
-					std::numeric_limits<float>::max()
-				};
-
-				typename std::vector<T>::const_iterator it2 = itor + 1u;
-				while( it2 != end )
+					m_navigationSearch.build();
+					m_navigationSearch.findClosestSiblings( widget );
+				}
+				else
 				{
-					Widget *widget2 = *it2;
+					//Our closest siblings are still there and didn't change,
+					//but the ones that changed may now be closer
+					WidgetVec::const_iterator itChanged = m_navigationChangedWidgets.begin();
+					WidgetVec::const_iterator enChanged = m_navigationChangedWidgets.end();
 
-					if( widget2->isKeyboardNavigable() )
+					while( itChanged != enChanged )
 					{
-						const Ogre::Vector2 cornerToCorner[4] =
-						{
-							widget2->m_position -
-							widget->m_position,
-
-							Ogre::Vector2( widget2->getRight(), widget2->m_position.y ) -
-							Ogre::Vector2( widget->getRight(), widget->m_position.y ),
-
-							Ogre::Vector2( widget2->m_position.x, widget2->getBottom() ) -
-							Ogre::Vector2( widget->m_position.x, widget->getBottom() ),
-
-							Ogre::Vector2( widget2->getRight(), widget2->getBottom() ) -
-							Ogre::Vector2( widget->getRight(), widget->getBottom() ),
-						};
-
-						for( size_t i=0; i<4u; ++i )
-						{
-							Ogre::Vector2 dirTo = cornerToCorner[i];
-
-							const float dirLength = dirTo.normalise();
-
-							const float cosAngle( dirTo.dotProduct( Ogre::Vector2::UNIT_X ) );
-
-							if( dirLength < closestSiblingDistances[Borders::Right] &&
-								cosAngle >= cosf( Ogre::Degree( 45.0f ).valueRadians() ) )
-							{
-								closestSiblings[Borders::Right] = widget2;
-								closestSiblingDistances[Borders::Right] = dirLength;
-							}
-
-							if( dirLength < closestSiblingDistances[Borders::Left] &&
-								cosAngle <= cosf( Ogre::Degree( 135.0f ).valueRadians() ) )
-							{
-								closestSiblings[Borders::Left] = widget2;
-								closestSiblingDistances[Borders::Left] = dirLength;
-							}
-
-							if( cosAngle <= cosf( Ogre::Degree( 45.0f ).valueRadians() ) &&
-								cosAngle >= cosf( Ogre::Degree( 135.0f ).valueRadians() ) )
-							{
-								float crossProduct = dirTo.crossProduct( Ogre::Vector2::UNIT_X );
-
-								if( crossProduct >= 0.0f )
-								{
-									if( dirLength < closestSiblingDistances[Borders::Top] )
-									{
-										closestSiblings[Borders::Top] = widget2;
-										closestSiblingDistances[Borders::Top] = dirLength;
-									}
-								}
-								else
-								{
-									if( dirLength < closestSiblingDistances[Borders::Bottom] )
-									{
-										closestSiblings[Borders::Bottom] = widget2;
-										closestSiblingDistances[Borders::Bottom] = dirLength;
-									}
-								}
-							}
-						}
+						if( (*itChanged)->m_navIndex > widget->m_navIndex )
+							NavigationSearch::evaluateSibling( widget, *itChanged );
+						++itChanged;
 					}
-
-					++it2;
 				}
 
 				for( size_t i=0; i<4u; ++i )
 				{
 					if( widget->m_autoSetNextWidget[i] && !widget->m_nextWidget[i] )
-						widget->setNextWidget( closestSiblings[i], static_cast<Borders::Borders>( i ) );
+					{
+						widget->setNextWidget( widget->m_navClosest[i],
+											   static_cast<Borders::Borders>( i ) );
+					}
 				}
 			}
+			else
+			{
+				NavigationSearch::resetClosestSiblings( widget );
+			}
 
 			++itor;
 		}
+
+		if( removedWidgets )
+			removedWidgets->clear();
 	}
 	//-------------------------------------------------------------------------
 	void ColibriManager::autosetNavigation( Window *window )
@@ -1257,14 +1450,15 @@ namespace Colibri
 		if( window->m_widgetNavigationDirty )
 		{
 			//Update the widgets from this 'window'
-			autosetNavigation( window->m_children, 0, window->m_numWidgets );
+			autosetNavigation( window->m_children, 0, window->m_numWidgets,
+							   &window->m_removedNavigationWidgets );
 			window->m_widgetNavigationDirty = false;
 		}
 
 		if( window->m_windowNavigationDirty )
 		{
 			//Update the widgets of the children windows from this 'window'
-			autosetNavigation( window->m_childWindows, 0, window->m_childWindows.size() );
+			autosetNavigation( window->m_childWindows, 0, window->m_childWindows.size(), 0 );
 			window->m_windowNavigationDirty = false;
 		}
 
@@ -1291,6 +1485,19 @@ namespace Colibri
 		m_numGlyphsBmpDirty = true;
 	}
 	//-------------------------------------------------------------------------
+	void ColibriManager::_notifyUnsharedGrid( bool unsharedGrid )
+	{
+		if( unsharedGrid )
+		{
+			++m_numUnsharedGrids;
+		}
+		else
+		{
+			COLIBRI_ASSERT_LOW( m_numUnsharedGrids > 0u );
+			--m_numUnsharedGrids;
+		}
+	}
+	//-------------------------------------------------------------------------
 	void ColibriManager::_updateDirtyLabels()
 	{
 		COLIBRI_ASSERT_MEDIUM( !m_fillBuffersStarted );
@@ -1374,6 +1581,7 @@ namespace Colibri
 	{
 		if( m_zOrderWidgetDirty )
 		{
+			m_allWindowsVisualsDirty = true;
 			reorderWindowVec( m_zOrderHasDirtyChildren, m_windows );
 
 			m_zOrderWidgetDirty = false;
@@ -1595,6 +1803,9 @@ namespace Colibri
 			updateWidgetsFocusedByCursor();
 		}
 
+		if( m_shaperManager->getAtlasCompactionBudget() > 0u )
+			m_shaperManager->compactAtlas( m_shaperManager->getAtlasCompactionBudget() );
+
 		m_shaperManager->updateGpuBuffers();
 
 		{
@@ -1609,6 +1820,229 @@ namespace Colibri
 		}
 	}
 	//-------------------------------------------------------------------------
+	void ColibriManager::setWorkerPool( WorkerPool *colibri_nullable workerPool )
+	{
+		if( m_workerPool == workerPool )
+			return;
+
+		m_workerPool = workerPool;
+		// Both paths lay out the windows differently in the vertex buffer
+		m_allWindowsVisualsDirty = true;
+	}
+	//-------------------------------------------------------------------------
+	void ColibriManager::countMaxVertices( const Widget *widget, size_t &outNumVertices,
+										   size_t &outNumTextVertices ) const
+	{
+		if( widget->isLabel() )
+			outNumTextVertices += static_cast<const Label *>( widget )->getMaxNumGlyphs() * 6u;
+		else if( widget->isLabelBmp() )
+			outNumVertices += static_cast<const LabelBmp *>( widget )->getMaxNumGlyphs() * 6u;
+		else if( widget->isRenderable() )
+		{
+			outNumVertices += static_cast<const Renderable *>( widget )->hasUnsharedGridUv()
+								  ? ( 6u * 9u )
+								  : getVerticesPerWidget();
+		}
+
+		WidgetVec::const_iterator itor = widget->m_children.begin();
+		WidgetVec::const_iterator endt = widget->m_children.end();
+
+		while( itor != endt )
+		{
+			countMaxVertices( *itor, outNumVertices, outNumTextVertices );
+			++itor;
+		}
+	}
+	//-------------------------------------------------------------------------
+	bool ColibriManager::isAnyBreadthFirst( const Widget *widget )
+	{
+		if( widget->m_breadthFirst )
+			return true;
+
+		WidgetVec::const_iterator itor = widget->m_children.begin();
+		WidgetVec::const_iterator endt = widget->m_children.end();
+
+		while( itor != endt )
+		{
+			if( isAnyBreadthFirst( *itor ) )
+				return true;
+			++itor;
+		}
+
+		return false;
+	}
+	//-------------------------------------------------------------------------
+	void ColibriManager::_fillWindowBuffers( Window *window, uint32_t vertexStart,
+											 uint32_t textVertexStart )
+	{
+		UiVertex *vertex = m_vertexBufferBase + vertexStart;
+		GlyphVertex *vertexText = m_textVertexBufferBase + textVertexStart;
+
+		window->_fillBuffersAndCommands( &vertex, &vertexText, -Ogre::Vector2::UNIT_SCALE,
+										 Ogre::Vector2::ZERO, Matrix2x3::IDENTITY );
+		window->m_visualsDirty = false;
+		window->m_vertexStart = vertexStart;
+		window->m_vertexCount = static_cast<uint32_t>( vertex - m_vertexBufferBase ) - vertexStart;
+		window->m_textVertexStart = textVertexStart;
+		window->m_textVertexCount =
+			static_cast<uint32_t>( vertexText - m_textVertexBufferBase ) - textVertexStart;
+	}
+	//-------------------------------------------------------------------------
+	bool ColibriManager::fillWindowsSerial( size_t &outNumVertices, size_t &outNumTextVertices )
+	{
+		bool anyWindowFilled = false;
+
+		uint32_t vertexStart = 0u;
+		uint32_t textVertexStart = 0u;
+
+		WindowVec::const_iterator itor = m_windows.begin();
+		WindowVec::const_iterator end  = m_windows.end();
+
+		while( itor != end )
+		{
+			Window *window = *itor;
+
+			// A window whose range moved (e.g. a previous window changed its
+			// vertex count) must be filled again, since its widgets store
+			// absolute offsets into the buffer.
+			if( m_allWindowsVisualsDirty || window->m_visualsDirty ||
+				window->m_vertexStart != vertexStart || window->m_textVertexStart != textVertexStart )
+			{
+				_fillWindowBuffers( window, vertexStart, textVertexStart );
+				anyWindowFilled = true;
+			}
+
+			vertexStart += window->m_vertexCount;
+			textVertexStart += window->m_textVertexCount;
+			++itor;
+		}
+
+		outNumVertices = vertexStart;
+		outNumTextVertices = textVertexStart;
+
+		return anyWindowFilled;
+	}
+	//-------------------------------------------------------------------------
+	namespace
+	{
+		class WindowFillJob final : public WorkerPool::Job
+		{
+			ColibriManager *m_manager;
+			const WindowVec &m_windows;
+			const uint32_t *m_vertexStarts;
+
+		public:
+			WindowFillJob( ColibriManager *manager, const WindowVec &windows,
+						   const uint32_t *vertexStarts ) :
+				m_manager( manager ),
+				m_windows( windows ),
+				m_vertexStarts( vertexStarts )
+			{
+			}
+
+			void execute( size_t jobIdx ) override
+			{
+				m_manager->_fillWindowBuffers( m_windows[jobIdx], m_vertexStarts[jobIdx * 2u],
+											   m_vertexStarts[jobIdx * 2u + 1u] );
+			}
+		};
+	}  // namespace
+
+	bool ColibriManager::fillWindowsParallel( size_t &outNumVertices, size_t &outNumTextVertices )
+	{
+		m_parallelFillWindows.clear();
+		m_parallelFillStarts.clear();
+
+		bool anyWindowFilled = false;
+
+		// Reserve a disjoint range for every window so that they can be filled
+		// independently. Unlike the serial path, the reserved size is an upper bound.
+		uint32_t vertexStart = 0u;
+		uint32_t textVertexStart = 0u;
+
+		WindowVec::const_iterator itor = m_windows.begin();
+		WindowVec::const_iterator end  = m_windows.end();
+
+		while( itor != end )
+		{
+			Window *window = *itor;
+
+			if( window->m_maxVertexCountsDirty )
+			{
+				size_t maxVertices = 0u;
+				size_t maxTextVertices = 0u;
+				countMaxVertices( window, maxVertices, maxTextVertices );
+				window->m_maxVertexCount = static_cast<uint32_t>( maxVertices );
+				window->m_maxTextVertexCount = static_cast<uint32_t>( maxTextVertices );
+				window->m_maxVertexCountsDirty = false;
+			}
+
+			if( m_allWindowsVisualsDirty || window->m_visualsDirty ||
+				window->m_vertexStart != vertexStart || window->m_textVertexStart != textVertexStart )
+			{
+				// Only checked for windows we fill, which walk their children anyway.
+				// m_breadthFirst is public, so it may change without notice
+				if( isAnyBreadthFirst( window ) )
+				{
+					// Breadth first fills use m_breadthFirst, which is shared. Do them
+					// now, on this thread, before any worker starts.
+					_fillWindowBuffers( window, vertexStart, textVertexStart );
+				}
+				else
+				{
+					m_parallelFillWindows.push_back( window );
+					m_parallelFillStarts.push_back( vertexStart );
+					m_parallelFillStarts.push_back( textVertexStart );
+				}
+				anyWindowFilled = true;
+			}
+
+			vertexStart += window->m_maxVertexCount;
+			textVertexStart += window->m_maxTextVertexCount;
+			++itor;
+		}
+
+		COLIBRI_ASSERT( vertexStart <= m_vertexBufferCpuSize );
+		COLIBRI_ASSERT( textVertexStart <= m_textVertexBufferCpuSize );
+
+		if( !m_parallelFillWindows.empty() )
+		{
+			WindowFillJob job( this, m_parallelFillWindows, &m_parallelFillStarts[0] );
+			m_workerPool->parallelFor( &job, m_parallelFillWindows.size() );
+		}
+
+		outNumVertices = vertexStart;
+		outNumTextVertices = textVertexStart;
+
+		return anyWindowFilled;
+	}
+	//-------------------------------------------------------------------------
+	bool ColibriManager::needsRedraw() const
+	{
+		if( m_redrawRequested || m_allWindowsVisualsDirty || m_widgetTransformsDirty ||
+			m_zOrderWidgetDirty || !m_dirtyLabels.empty() || !m_dirtyLabelBmps.empty() )
+		{
+			return true;
+		}
+
+		WindowVec::const_iterator itor = m_windows.begin();
+		WindowVec::const_iterator endt = m_windows.end();
+
+		while( itor != endt )
+		{
+			if( ( *itor )->m_visualsDirty )
+				return true;
+			++itor;
+		}
+
+		return false;
+	}
+	//-------------------------------------------------------------------------
+	void ColibriManager::requestRedraw()
+	{
+		m_redrawRequested = true;
+	}
+	//-------------------------------------------------------------------------
 	void ColibriManager::prepareRenderCommands()
 	{
 #if COLIBRIGUI_DEBUG_MEDIUM
@@ -1618,33 +2052,77 @@ namespace Colibri
 		Ogre::VertexBufferPacked *vertexBuffer = m_vao->getBaseVertexBuffer();
 		Ogre::VertexBufferPacked *vertexBufferText = m_textVao->getBaseVertexBuffer();
 
-		UiVertex *vertex = reinterpret_cast<UiVertex*>(
-							   vertexBuffer->map( 0, vertexBuffer->getNumElements() ) );
-		UiVertex *startOffset = vertex;
+		if( m_vertexBufferCpuSize != vertexBuffer->getNumElements() )
+		{
+			delete[] m_vertexBufferCpu;
+			m_vertexBufferCpuSize = vertexBuffer->getNumElements();
+			m_vertexBufferCpu = new UiVertex[m_vertexBufferCpuSize];
+			m_allWindowsVisualsDirty = true;
+		}
+		if( m_textVertexBufferCpuSize != vertexBufferText->getNumElements() )
+		{
+			delete[] m_textVertexBufferCpu;
+			m_textVertexBufferCpuSize = vertexBufferText->getNumElements();
+			m_textVertexBufferCpu = new GlyphVertex[m_textVertexBufferCpuSize];
+			m_allWindowsVisualsDirty = true;
+		}
+
+		syncInstanceBuffer();
+
+		UiVertex *startOffset = m_vertexBufferCpu;
 		m_vertexBufferBase = startOffset;
 
-		GlyphVertex *vertexText = reinterpret_cast<GlyphVertex*>(
-									  vertexBufferText->map( 0, vertexBufferText->getNumElements() ) );
-		GlyphVertex *startOffsetText = vertexText;
+		GlyphVertex *startOffsetText = m_textVertexBufferCpu;
 		m_textVertexBufferBase = startOffsetText;
 
-		WindowVec::const_iterator itor = m_windows.begin();
-		WindowVec::const_iterator end  = m_windows.end();
+		size_t elementsWritten = 0u;
+		size_t elementsWrittenText = 0u;
 
-		while( itor != end )
-		{
-			( *itor )->_fillBuffersAndCommands( &vertex, &vertexText, -Ogre::Vector2::UNIT_SCALE,
-												Ogre::Vector2::ZERO, Matrix2x3::IDENTITY );
-			++itor;
-		}
+		Ogre::Timer fillTimer;
+		const bool anyWindowFilled =
+			m_workerPool ? fillWindowsParallel( elementsWritten, elementsWrittenText )
+						 : fillWindowsSerial( elementsWritten, elementsWrittenText );
+		m_lastVertexFillMicroseconds = anyWindowFilled ? fillTimer.getMicroseconds() : 0u;
+
+		m_allWindowsVisualsDirty = false;
 
-		const size_t elementsWritten = size_t( vertex - startOffset );
-		const size_t elementsWrittenText = size_t( vertexText - startOffsetText );
 		COLIBRI_ASSERT( elementsWritten <= vertexBuffer->getNumElements() );
 		COLIBRI_ASSERT( elementsWrittenText <= vertexBufferText->getNumElements() );
+
+		// Every map() of a persistent buffer moves it to its next region. Once the last
+		// dynamicMultiplier maps all received the latest vertices, there is nothing left
+		// to copy. We can't go by the VaoManager's frame index: frames skipped through
+		// needsRedraw don't map, so it drifts from the region our buffers are at.
+		// Recreated buffers always come with all windows being filled again.
+		if( anyWindowFilled )
+			m_pendingVertexUploads = m_vaoManager->getDynamicBufferMultiplier();
+		const bool needsUpload = m_pendingVertexUploads > 0u;
+		if( needsUpload )
+			--m_pendingVertexUploads;
+
+		UiVertex *vertexGpu = reinterpret_cast<UiVertex*>(
+								  vertexBuffer->map( 0, vertexBuffer->getNumElements() ) );
+		GlyphVertex *vertexTextGpu = reinterpret_cast<GlyphVertex*>(
+										 vertexBufferText->map( 0, vertexBufferText->getNumElements() ) );
+		if( needsUpload )
+		{
+			memcpy( vertexGpu, startOffset, elementsWritten * sizeof( UiVertex ) );
+			memcpy( vertexTextGpu, startOffsetText, elementsWrittenText * sizeof( GlyphVertex ) );
+		}
 		vertexBuffer->unmap( Ogre::UO_KEEP_PERSISTENT, 0u, elementsWritten );
 		vertexBufferText->unmap( Ogre::UO_KEEP_PERSISTENT, 0u, elementsWrittenText );
 
+		if( m_instanceBuffer )
+		{
+			// Instanced widgets' records live in the regular vertex stream, which the
+			// vertex shader can only read through this buffer
+			const size_t bytesWritten = elementsWritten * sizeof( UiVertex );
+			void *instanceGpu = m_instanceBuffer->map( 0, m_instanceBuffer->getTotalSizeBytes() );
+			if( needsUpload )
+				memcpy( instanceGpu, startOffset, bytesWritten );
+			m_instanceBuffer->unmap( Ogre::UO_KEEP_PERSISTENT, 0u, bytesWritten );
+		}
+
 		m_vertexBufferBase = 0;
 		m_textVertexBufferBase = 0;
 
@@ -1669,6 +2147,7 @@ namespace Colibri
 		// Ideally ShapeManagers should be shared between ColibriManagers for maximum
 		// efficiency. But if they're not, we not to bind our own atlas with our glyphs
 		m_shaperManager->prepareToRender();
+		hlmsColibri->setInstanceBuffer( m_instanceBuffer );
 
 		apiObjects.lastHlmsCache = &c_dummyCache;
 
@@ -1696,11 +2175,14 @@ namespace Colibri
 		else if( m_vaoManager->supportsBaseInstance() )
 			apiObjects.baseInstanceAndIndirectBuffers = 1;
 		apiObjects.drawCmd = 0;
-		apiObjects.drawCountPtr = 0;
+		apiObjects.drawPrimCount = 0;
+		apiObjects.drawInstanceCount = 0;
+		apiObjects.lastIndirectDrawSize = 0;
 		apiObjects.primCount = 0;
 		apiObjects.basePrimCount[0] = (uint32_t)m_vao->getBaseVertexBuffer()->_getFinalBufferStart();
 		apiObjects.basePrimCount[1] = (uint32_t)m_textVao->getBaseVertexBuffer()->_getFinalBufferStart();
 		apiObjects.nextFirstVertex = 0;
+		apiObjects.nextBaseInstance = 0;
 
 		m_breadthFirst[0].clear();
 		m_breadthFirst[1].clear();
@@ -1716,14 +2198,12 @@ namespace Colibri
 			++itor;
 		}
 
-		if( apiObjects.drawCountPtr && apiObjects.drawCountPtr->primCount == 0u )
+		if( apiObjects.drawPrimCount && *apiObjects.drawPrimCount == 0u )
 		{
 			// Adreno 618 will GPU crash if we send an indirect cmd with vertex_count = 0
 			--apiObjects.drawCmd->numDraws;
-			// Since we only emit CbDrawStrip we can assume the previous cmd
-			// issued a CbDrawStrip, so take it back. Otherwise we'd have to
-			// save what our last cmd was.
-			apiObjects.indirectDraw -= sizeof( Ogre::CbDrawStrip );
+			// Take back the last CbDrawStrip / CbDrawIndexed we issued.
+			apiObjects.indirectDraw -= apiObjects.lastIndirectDrawSize;
 		}
 
 		if( m_vaoManager->supportsIndirectBuffers() )
@@ -1733,6 +2213,8 @@ namespace Colibri
 		m_commandBuffer->execute();
 		hlms->postCommandBufferExecution( m_commandBuffer );
 
+		m_redrawRequested = false;
+
 #if COLIBRIGUI_DEBUG_MEDIUM
 		m_renderingStarted = false;
 #endif
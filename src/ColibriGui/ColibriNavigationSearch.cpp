@@ -0,0 +1,307 @@
+
+#include "ColibriGui/ColibriNavigationSearch.h"
+
+#include "OgreMath.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Colibri
+{
+	/// Maximum number of widgets in a leaf of the tree
+	static const uint32_t c_maxEntriesPerLeaf = 8u;
+
+	namespace
+	{
+		struct EntryCenterCompare
+		{
+			size_t axis;
+			EntryCenterCompare( size_t _axis ) : axis( _axis ) {}
+
+			template <typename T>
+			bool operator()( const T &a, const T &b ) const
+			{
+				return ( a.topLeft[axis] + a.bottomRight[axis] ) <
+					   ( b.topLeft[axis] + b.bottomRight[axis] );
+			}
+		};
+	}  // namespace
+
+	NavigationSearch::NavigationSearch() : m_built( false ) {}
+	//-------------------------------------------------------------------------
+	void NavigationSearch::clear()
+	{
+		m_entries.clear();
+		m_nodes.clear();
+		m_built = false;
+	}
+	//-------------------------------------------------------------------------
+	void NavigationSearch::addWidget( Widget *widget )
+	{
+		COLIBRI_ASSERT_LOW( !m_built );
+
+		// The corners may be swapped if the size is negative
+		const Ogre::Vector2 corner0 = widget->m_position;
+		const Ogre::Vector2 corner1 = widget->m_position + widget->m_size;
+
+		Entry entry;
+		entry.widget = widget;
+		entry.topLeft = corner0;
+		entry.topLeft.makeFloor( corner1 );
+		entry.bottomRight = corner0;
+		entry.bottomRight.makeCeil( corner1 );
+		entry.idx = widget->m_navIndex;
+		m_entries.push_back( entry );
+	}
+	//-------------------------------------------------------------------------
+	void NavigationSearch::buildNode( uint32_t nodeIdx, uint32_t firstEntry, uint32_t numEntries )
+	{
+		Node node;
+		node.minTopLeft = m_entries[firstEntry].topLeft;
+		node.maxBottomRight = m_entries[firstEntry].bottomRight;
+		node.maxIdx = 0u;
+
+		for( uint32_t i = firstEntry; i < firstEntry + numEntries; ++i )
+		{
+			node.minTopLeft.makeFloor( m_entries[i].topLeft );
+			node.maxBottomRight.makeCeil( m_entries[i].bottomRight );
+			node.maxIdx = std::max( node.maxIdx, m_entries[i].idx );
+		}
+
+		if( numEntries <= c_maxEntriesPerLeaf )
+		{
+			node.firstEntry = firstEntry;
+			node.numEntries = numEntries;
+			m_nodes[nodeIdx] = node;
+			return;
+		}
+
+		// Split in half along the longest axis
+		const Ogre::Vector2 extent = node.maxBottomRight - node.minTopLeft;
+		const size_t axis = extent.x >= extent.y ? 0u : 1u;
+		const uint32_t numLeft = numEntries >> 1u;
+
+		std::vector<Entry>::iterator first = m_entries.begin() + ptrdiff_t( firstEntry );
+		std::nth_element( first, first + ptrdiff_t( numLeft ), first + ptrdiff_t( numEntries ),
+						  EntryCenterCompare( axis ) );
+
+		const uint32_t childIdx = static_cast<uint32_t>( m_nodes.size() );
+		node.firstEntry = childIdx;
+		node.numEntries = 0u;
+		m_nodes[nodeIdx] = node;
+
+		m_nodes.resize( m_nodes.size() + 2u );
+		buildNode( childIdx, firstEntry, numLeft );
+		buildNode( childIdx + 1u, firstEntry + numLeft, numEntries - numLeft );
+	}
+	//-------------------------------------------------------------------------
+	void NavigationSearch::build()
+	{
+		if( m_built )
+			return;
+
+		m_nodes.clear();
+		if( !m_entries.empty() )
+		{
+			m_nodes.reserve( ( m_entries.size() / c_maxEntriesPerLeaf + 1u ) * 2u );
+			m_nodes.resize( 1u );
+			buildNode( 0u, 0u, static_cast<uint32_t>( m_entries.size() ) );
+		}
+
+		m_built = true;
+	}
+	//-------------------------------------------------------------------------
+	float NavigationSearch::getLowerBound( const Node &node, const Widget *widget )
+	{
+		// Relative tolerances so that floating point error never prunes a node
+		// the exhaustive search would've picked a sibling from
+		const float c_slope = 1.01f;
+		const float c_epsilon = 1e-3f;
+
+		const Ogre::Vector2 corner0 = widget->m_position;
+		const Ogre::Vector2 corner1 = widget->m_position + widget->m_size;
+		Ogre::Vector2 widgetTopLeft = corner0;
+		widgetTopLeft.makeFloor( corner1 );
+		Ogre::Vector2 widgetBottomRight = corner0;
+		widgetBottomRight.makeCeil( corner1 );
+
+		// Box containing every possible vector from one of the widget's
+		// corners to one of the corners of the node's siblings
+		const Ogre::Vector2 minDir = node.minTopLeft - widgetBottomRight;
+		const Ogre::Vector2 maxDir = node.maxBottomRight - widgetTopLeft;
+
+		// Closest distance from the box to the origin, per axis
+		const float dx = std::max( std::max( minDir.x, -maxDir.x ), 0.0f );
+		const float dy = std::max( std::max( minDir.y, -maxDir.y ), 0.0f );
+		const float lowerBound = Ogre::Math::Sqrt( dx * dx + dy * dy );
+
+		// Whether the box touches the 90° cone each direction uses
+		bool inCone[Borders::NumBorders];
+		inCone[Borders::Left] = -minDir.x * c_slope + c_epsilon >= dy;
+		inCone[Borders::Top] = -minDir.y * c_slope + c_epsilon >= dx;
+		inCone[Borders::Right] = maxDir.x * c_slope + c_epsilon >= dy;
+		inCone[Borders::Bottom] = maxDir.y * c_slope + c_epsilon >= dx;
+
+		for( size_t i = 0u; i < Borders::NumBorders; ++i )
+		{
+			if( inCone[i] &&
+				lowerBound <= widget->m_navClosestDistance[i] * ( 1.0f + c_epsilon ) + c_epsilon )
+			{
+				return lowerBound;
+			}
+		}
+
+		return std::numeric_limits<float>::max();
+	}
+	//-------------------------------------------------------------------------
+	void NavigationSearch::findClosestSiblings( Widget *widget )
+	{
+		COLIBRI_ASSERT_LOW( m_built );
+
+		resetClosestSiblings( widget );
+
+		if( m_nodes.empty() )
+			return;
+
+		const uint32_t widgetIdx = widget->m_navIndex;
+
+		m_stack.clear();
+		m_stack.push_back( 0u );
+
+		while( !m_stack.empty() )
+		{
+			const Node &node = m_nodes[m_stack.back()];
+			m_stack.pop_back();
+
+			// Nothing after us, or nothing that can be closer than what we already have
+			// (which may have changed since the node was pushed)
+			if( node.maxIdx <= widgetIdx ||
+				getLowerBound( node, widget ) == std::numeric_limits<float>::max() )
+			{
+				continue;
+			}
+
+			if( node.numEntries )
+			{
+				const uint32_t endEntry = node.firstEntry + node.numEntries;
+				for( uint32_t i = node.firstEntry; i < endEntry; ++i )
+				{
+					if( m_entries[i].idx > widgetIdx )
+						evaluateSibling( widget, m_entries[i].widget );
+				}
+			}
+			else
+			{
+				// Visit the nearest child first, so that the other one is more likely to be
+				// skipped. The stack is LIFO, thus push the nearest one last.
+				const float lowerBound0 = getLowerBound( m_nodes[node.firstEntry], widget );
+				const float lowerBound1 = getLowerBound( m_nodes[node.firstEntry + 1u], widget );
+
+				const uint32_t nearIdx = node.firstEntry + ( lowerBound1 < lowerBound0 ? 1u : 0u );
+				const uint32_t farIdx = node.firstEntry + ( lowerBound1 < lowerBound0 ? 0u : 1u );
+
+				if( std::max( lowerBound0, lowerBound1 ) != std::numeric_limits<float>::max() )
+					m_stack.push_back( farIdx );
+				if( std::min( lowerBound0, lowerBound1 ) != std::numeric_limits<float>::max() )
+					m_stack.push_back( nearIdx );
+			}
+		}
+	}
+	//-------------------------------------------------------------------------
+	void NavigationSearch::resetClosestSiblings( Widget *widget )
+	{
+		for( size_t i = 0u; i < Borders::NumBorders; ++i )
+		{
+			widget->m_navClosest[i] = 0;
+			widget->m_navClosestDistance[i] = std::numeric_limits<float>::max();
+		}
+	}
+	//-------------------------------------------------------------------------
+	void NavigationSearch::evaluateSibling( Widget *widget, Widget *widget2 )
+	{
+		COLIBRI_ASSERT_LOW( widget2->m_navIndex > widget->m_navIndex );
+
+		Widget *colibri_nullable *closestSiblings = widget->m_navClosest;
+		float *closestSiblingDistances = widget->m_navClosestDistance;
+
+		// The exhaustive search visited siblings in order and only kept strictly closer ones.
+		// We visit them in any order, thus on a tie the sibling with the lowest index wins.
+		// Negative means there's no tie to consider (distances are never negative).
+		float closestTies[Borders::NumBorders];
+		for( size_t i = 0u; i < Borders::NumBorders; ++i )
+		{
+			closestTies[i] = -1.0f;
+			if( closestSiblings[i] && widget2->m_navIndex < closestSiblings[i]->m_navIndex )
+				closestTies[i] = closestSiblingDistances[i];
+		}
+
+		const Ogre::Vector2 cornerToCorner[4] =
+		{
+			widget2->m_position -
+			widget->m_position,
+
+			Ogre::Vector2( widget2->getRight(), widget2->m_position.y ) -
+			Ogre::Vector2( widget->getRight(), widget->m_position.y ),
+
+			Ogre::Vector2( widget2->m_position.x, widget2->getBottom() ) -
+			Ogre::Vector2( widget->m_position.x, widget->getBottom() ),
+
+			Ogre::Vector2( widget2->getRight(), widget2->getBottom() ) -
+			Ogre::Vector2( widget->getRight(), widget->getBottom() ),
+		};
+
+		for( size_t i=0; i<4u; ++i )
+		{
+			Ogre::Vector2 dirTo = cornerToCorner[i];
+
+			const float dirLength = dirTo.normalise();
+
+			const float cosAngle( dirTo.dotProduct( Ogre::Vector2::UNIT_X ) );
+
+			if( ( dirLength < closestSiblingDistances[Borders::Right] ||
+				  dirLength == closestTies[Borders::Right] ) &&
+				cosAngle >= cosf( Ogre::Degree( 45.0f ).valueRadians() ) )
+			{
+				closestSiblings[Borders::Right] = widget2;
+				closestSiblingDistances[Borders::Right] = dirLength;
+				closestTies[Borders::Right] = -1.0f;
+			}
+
+			if( ( dirLength < closestSiblingDistances[Borders::Left] ||
+				  dirLength == closestTies[Borders::Left] ) &&
+				cosAngle <= cosf( Ogre::Degree( 135.0f ).valueRadians() ) )
+			{
+				closestSiblings[Borders::Left] = widget2;
+				closestSiblingDistances[Borders::Left] = dirLength;
+				closestTies[Borders::Left] = -1.0f;
+			}
+
+			if( cosAngle <= cosf( Ogre::Degree( 45.0f ).valueRadians() ) &&
+				cosAngle >= cosf( Ogre::Degree( 135.0f ).valueRadians() ) )
+			{
+				float crossProduct = dirTo.crossProduct( Ogre::Vector2::UNIT_X );
+
+				if( crossProduct >= 0.0f )
+				{
+					if( dirLength < closestSiblingDistances[Borders::Top] ||
+						dirLength == closestTies[Borders::Top] )
+					{
+						closestSiblings[Borders::Top] = widget2;
+						closestSiblingDistances[Borders::Top] = dirLength;
+						closestTies[Borders::Top] = -1.0f;
+					}
+				}
+				else
+				{
+					if( dirLength < closestSiblingDistances[Borders::Bottom] ||
+						dirLength == closestTies[Borders::Bottom] )
+					{
+						closestSiblings[Borders::Bottom] = widget2;
+						closestSiblingDistances[Borders::Bottom] = dirLength;
+						closestTies[Borders::Bottom] = -1.0f;
+					}
+				}
+			}
+		}
+	}
+}  // namespace Colibri
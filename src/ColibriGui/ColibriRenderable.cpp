@@ -27,6 +27,53 @@
 
 namespace Colibri
 {
+	inline void removeEmptyIndirectDraw( ApiEncapsulatedObjects &apiObject )
+	{
+		if( apiObject.drawPrimCount && *apiObject.drawPrimCount == 0u )
+		{
+			// Adreno 618 will GPU crash if we send an indirect cmd with vertex_count = 0
+			--apiObject.drawCmd->numDraws;
+			// Take back the last CbDrawStrip / CbDrawIndexed we issued.
+			apiObject.indirectDraw -= apiObject.lastIndirectDrawSize;
+		}
+	}
+	//-------------------------------------------------------------------------
+	inline void addIndirectDraw( ApiEncapsulatedObjects &apiObject,
+								 const Ogre::IndexBufferPacked *indexBuffer,
+								 uint32_t firstVertex, uint32_t baseInstance, uint32_t instanceCount )
+	{
+		using namespace Ogre;
+
+		if( indexBuffer )
+		{
+			//All draws start at index 0 and offset the vertices instead; because
+			//the shared index buffer only covers 65536 vertices.
+			CbDrawIndexed *drawIndexed = reinterpret_cast<CbDrawIndexed*>( apiObject.indirectDraw );
+			drawIndexed->primCount			= 0;
+			drawIndexed->instanceCount		= instanceCount;
+			drawIndexed->firstVertexIndex	= static_cast<uint32>(
+												  indexBuffer->_getFinalBufferStart() );
+			drawIndexed->baseVertexIndex	= firstVertex;
+			drawIndexed->baseInstance		= baseInstance;
+			apiObject.drawPrimCount = &drawIndexed->primCount;
+			apiObject.drawInstanceCount = &drawIndexed->instanceCount;
+			apiObject.lastIndirectDrawSize = sizeof( CbDrawIndexed );
+		}
+		else
+		{
+			CbDrawStrip *drawStrip = reinterpret_cast<CbDrawStrip*>( apiObject.indirectDraw );
+			drawStrip->primCount		= 0;
+			drawStrip->instanceCount	= instanceCount;
+			drawStrip->firstVertexIndex	= firstVertex;
+			drawStrip->baseInstance		= baseInstance;
+			apiObject.drawPrimCount = &drawStrip->primCount;
+			apiObject.drawInstanceCount = &drawStrip->instanceCount;
+			apiObject.lastIndirectDrawSize = sizeof( CbDrawStrip );
+		}
+
+		apiObject.indirectDraw += apiObject.lastIndirectDrawSize;
+	}
+	//-------------------------------------------------------------------------
 	Renderable::Renderable( ColibriManager *manager ) :
 		Widget( manager ),
 		ColibriOgreRenderable( Ogre::Id::generateNewId<Ogre::ColibriOgreRenderable>(),
@@ -34,14 +81,94 @@ namespace Colibri
 							   manager->getOgreSceneManager(), 0u, manager ),
 		m_overrideSkinColour( false ),
 		m_colour( Ogre::ColourValue::White ),
-		m_numVertices( 6u * 9u ),
+		m_numVertices( 16u ),
 		m_currVertexBufferOffset( 0 ),
-		m_visualsEnabled( true )
+		m_visualsEnabled( true ),
+		m_unsharedGrid( false )
 	{
 		m_zOrder = _wrapZOrderInternalId( 0 );
 		memset( m_stateInformation, 0, sizeof( m_stateInformation ) );
 		for( size_t i = 0u; i < States::NumStates; ++i )
 			m_stateInformation[i].defaultColour = Ogre::ColourValue::White;
+
+		if( m_manager->getInstancedWidgets() )
+		{
+			//Label & LabelBmp override the Vao in their constructors,
+			//and HlmsColibri ignores the instanced flag for them
+			setVao( m_manager->getVaoInstanced() );
+			setInstanced( true );
+		}
+	}
+	//-------------------------------------------------------------------------
+	Renderable::~Renderable()
+	{
+		if( m_unsharedGrid )
+			m_manager->_notifyUnsharedGrid( false );
+	}
+	//-------------------------------------------------------------------------
+	uint16_t Renderable::getVisibleGridCells( const StateInformation &stateInfo )
+	{
+		const bool columns[3] = { stateInfo.borderSize[Borders::Left] > 0.0f, true,
+								  stateInfo.borderSize[Borders::Right] > 0.0f };
+		const bool rows[3] = { stateInfo.borderSize[Borders::Top] > 0.0f, true,
+							   stateInfo.borderSize[Borders::Bottom] > 0.0f };
+
+		uint16_t retVal = 0u;
+		for( size_t y = 0u; y < 3u; ++y )
+		{
+			for( size_t x = 0u; x < 3u; ++x )
+			{
+				if( columns[x] && rows[y] )
+					retVal |= static_cast<uint16_t>( 1u << ( y * 3u + x ) );
+			}
+		}
+
+		return retVal;
+	}
+	//-------------------------------------------------------------------------
+	void Renderable::updateGridUvSharing()
+	{
+		//Labels & LabelBmp don't draw a grid
+		if( isLabel() || isLabelBmp() )
+			return;
+
+		bool unsharedGrid = false;
+		for( size_t i = 0u; i < States::NumStates && !unsharedGrid; ++i )
+		{
+			unsharedGrid = ( m_stateInformation[i].unsharedGridCells &
+							 getVisibleGridCells( m_stateInformation[i] ) ) != 0u;
+		}
+
+		if( m_unsharedGrid == unsharedGrid )
+			return;
+
+		m_unsharedGrid = unsharedGrid;
+		m_numVertices = unsharedGrid ? ( 6u * 9u ) : 16u;
+		m_manager->_notifyUnsharedGrid( unsharedGrid );
+		_setVertexCountsDirty();
+
+		//Same as LabelBmp: 6374 tells HlmsColibri our vertices are not indexed.
+		//Must be set before setDatablock so it's accounted in the hash.
+		if( unsharedGrid )
+		{
+			setCustomParameter( 6374, Ogre::Vector4( 1.0f ) );
+			setVao( m_manager->getVaoBmp() );
+		}
+		else
+		{
+			removeCustomParameter( 6374 );
+			if( m_manager->getInstancedWidgets() )
+				setVao( m_manager->getVaoInstanced() );
+			else
+				setVao( m_manager->getVao() );
+		}
+
+		const bool wasInstanced = hasCustomParameter( 6375 );
+		const bool bInstanced = m_manager->getInstancedWidgets() && !unsharedGrid;
+		setInstanced( bInstanced );
+		//setInstanced already calls setDatablock when the value changed
+		if( wasInstanced == bInstanced && mHlmsDatablock )
+			setDatablock( mHlmsDatablock );
 	}
 	//-------------------------------------------------------------------------
 	void Renderable::_notifyCanvasChanged()
@@ -58,6 +185,7 @@ namespace Colibri
 	void Renderable::setVisualsEnabled( bool bEnabled )
 	{
 		m_visualsEnabled = bEnabled;
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	bool Renderable::isVisualsEnabled() const
@@ -72,6 +200,7 @@ namespace Colibri
 			m_colour = colour;
 		else
 			m_colour = m_stateInformation[m_currentState].defaultColour;
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	const Ogre::ColourValue &Renderable::getColour() const { return m_colour; }
@@ -103,7 +232,9 @@ namespace Colibri
 		if( !m_overrideSkinColour )
 			m_colour = m_stateInformation[m_currentState].defaultColour;
 
+		updateGridUvSharing();
 		setClipBordersMatchSkin();
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	void Renderable::setEmptySkin()
@@ -134,6 +265,9 @@ namespace Colibri
 				stateInfo.uvTopLeftBottomRight[j] = {0.0009765625, 0.0009765625, 0.999023437, 0.999023437};
 			}
 		}
+
+		updateGridUvSharing();
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	void Renderable::setSkinPack( Ogre::IdString skinName )
@@ -157,7 +291,9 @@ namespace Colibri
 		if( !m_overrideSkinColour )
 			m_colour = m_stateInformation[m_currentState].defaultColour;
 
+		updateGridUvSharing();
 		setClipBordersMatchSkin();
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	void Renderable::setBorderSize( const float borderSize[colibri_nonnull Borders::NumBorders],
@@ -177,8 +313,12 @@ namespace Colibri
 				m_stateInformation[forState].borderSize[j] = borderSize[j];
 		}
 
+		updateGridUvSharing();
+
 		if( bClipBordersMatchSkin )
 			setClipBordersMatchSkin();
+
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	void Renderable::_setSkinPack( SkinInfo const * colibri_nonnull
@@ -197,7 +337,9 @@ namespace Colibri
 		if( !m_overrideSkinColour )
 			m_colour = m_stateInformation[m_currentState].defaultColour;
 
+		updateGridUvSharing();
 		setClipBordersMatchSkin();
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	void Renderable::setState( States::States state, bool smartHighlight )
@@ -234,7 +376,16 @@ namespace Colibri
 	//-------------------------------------------------------------------------
 	void Renderable::broadcastNewVao( Ogre::VertexArrayObject *vao, Ogre::VertexArrayObject *textVao )
 	{
-		setVao( !isLabel() ? vao : textVao );
+		if( isLabel() )
+			setVao( textVao );
+		else if( isLabelBmp() || m_unsharedGrid )
+			setVao( m_manager->getVaoBmp() );
+		else if( m_manager->getInstancedWidgets() )
+			setVao( m_manager->getVaoInstanced() );
+		else
+			setVao( vao );
+		setInstanced( m_manager->getInstancedWidgets() && !isLabel() && !isLabelBmp() &&
+					  !m_unsharedGrid );
 		Widget::broadcastNewVao( vao, textVao );
 	}
 	//-------------------------------------------------------------------------
@@ -270,25 +421,38 @@ namespace Colibri
 			const bool bIsLabel = isLabel();
 			const size_t widgetType = bIsLabel ? 1u : 0u;
 
-			const uint32 firstVertex = m_currVertexBufferOffset + apiObject.basePrimCount[widgetType];
+			//Regular widgets are a 4x4 grid drawn with the shared 9-slice index buffer.
+			//Labels, LabelBmp & widgets with unshared grid UVs have arbitrary number
+			//of vertices and are drawn unindexed.
+			//Instanced widgets all draw the same 54 vertices, one instance each.
+			IndexBufferPacked *indexBuffer = vao->getIndexBuffer();
+			const bool bInstanced = vao == m_manager->getVaoInstanced();
+			const uint32 numPrims = ( indexBuffer || bInstanced ) ? ( 6u * 9u ) : m_numVertices;
+
+			uint32 firstVertex;
+			uint32 baseVertex;
+			if( bInstanced )
+			{
+				//The shader locates our UiInstance record (in float4 units) through the
+				//value it would otherwise use as base vertex
+				firstVertex = static_cast<uint32>( vao->getBaseVertexBuffer()->_getFinalBufferStart() );
+				baseVertex = m_currVertexBufferOffset * static_cast<uint32>( sizeof( UiVertex ) / 16u );
+			}
+			else
+			{
+				firstVertex = m_currVertexBufferOffset + apiObject.basePrimCount[widgetType];
+				baseVertex = firstVertex;
+			}
 
 			uint32 baseInstance = apiObject.hlms->fillBuffersForColibri(
 									  hlmsCache, queuedRenderable, false,
-									  firstVertex,
+									  baseVertex,
 									  lastHlmsCacheHash, apiObject.commandBuffer );
 
 			if( apiObject.drawCmd != commandBuffer->getLastCommand() ||
 				apiObject.lastVaoName != vao->getVaoName() )
 			{
-				if( apiObject.drawCountPtr && apiObject.drawCountPtr->primCount == 0u )
-				{
-					// Adreno 618 will GPU crash if we send an indirect cmd with vertex_count = 0
-					--apiObject.drawCmd->numDraws;
-					// Since we only emit CbDrawStrip we can assume the previous cmd
-					// issued a CbDrawStrip, so take it back. Otherwise we'd have to
-					// save what our last cmd was.
-					apiObject.indirectDraw -= sizeof( CbDrawStrip );
-				}
+				removeEmptyIndirectDraw( apiObject );
 
 				{
 					*commandBuffer->addCommand<CbVao>() = CbVao( vao );
@@ -301,78 +465,68 @@ namespace Colibri
 					ptrdiff_t( apiObject.indirectBuffer->_getFinalBufferStart() ) +
 					( apiObject.indirectDraw - apiObject.startIndirectDraw ) );
 
-				CbDrawCallStrip *drawCall = commandBuffer->addCommand<CbDrawCallStrip>();
-				*drawCall = CbDrawCallStrip( apiObject.baseInstanceAndIndirectBuffers, vao, offset );
-				drawCall->numDraws = 1u;
-				apiObject.drawCmd = drawCall;
-				apiObject.primCount = 0;
-				apiObject.lastDatablock = mHlmsDatablock;
-
-				apiObject.drawCountPtr = reinterpret_cast<CbDrawStrip*>( apiObject.indirectDraw );
-				apiObject.drawCountPtr->primCount		= 0;
-				apiObject.drawCountPtr->instanceCount	= 1u;
-				apiObject.drawCountPtr->firstVertexIndex= firstVertex;
-				apiObject.drawCountPtr->baseInstance	= baseInstance;
-				apiObject.indirectDraw += sizeof( CbDrawStrip );
-			}
-			else if( bIsLabel && apiObject.lastDatablock != mHlmsDatablock )
-			{
-				if( apiObject.drawCountPtr && apiObject.drawCountPtr->primCount == 0u )
+				if( indexBuffer )
 				{
-					// Adreno 618 will GPU crash if we send an indirect cmd with vertex_count = 0
-					--apiObject.drawCmd->numDraws;
-					// Since we only emit CbDrawStrip we can assume the previous cmd
-					// issued a CbDrawStrip, so take it back. Otherwise we'd have to
-					// save what our last cmd was.
-					apiObject.indirectDraw -= sizeof( CbDrawStrip );
+					CbDrawCallIndexed *drawCall = commandBuffer->addCommand<CbDrawCallIndexed>();
+					*drawCall = CbDrawCallIndexed( apiObject.baseInstanceAndIndirectBuffers, vao,
+												   offset );
+					drawCall->numDraws = 1u;
+					apiObject.drawCmd = drawCall;
+				}
+				else
+				{
+					CbDrawCallStrip *drawCall = commandBuffer->addCommand<CbDrawCallStrip>();
+					*drawCall = CbDrawCallStrip( apiObject.baseInstanceAndIndirectBuffers, vao,
+												 offset );
+					drawCall->numDraws = 1u;
+					apiObject.drawCmd = drawCall;
 				}
-
-				//Text has arbitrary number of of vertices, thus we can't properly calculate the drawId
-				//and therefore the material ID unless we issue a start a new draw.
-				CbDrawCallStrip *drawCall = static_cast<CbDrawCallStrip*>( apiObject.drawCmd );
-				++drawCall->numDraws;
 				apiObject.primCount = 0;
 				apiObject.lastDatablock = mHlmsDatablock;
 
-				apiObject.drawCountPtr = reinterpret_cast<CbDrawStrip*>( apiObject.indirectDraw );
-				apiObject.drawCountPtr->primCount		= 0;
-				apiObject.drawCountPtr->instanceCount	= 1u;
-				apiObject.drawCountPtr->firstVertexIndex= firstVertex;
-				apiObject.drawCountPtr->baseInstance	= baseInstance;
-				apiObject.indirectDraw += sizeof( CbDrawStrip );
+				addIndirectDraw( apiObject, indexBuffer, firstVertex, baseInstance,
+								 bInstanced ? 0u : 1u );
 			}
-			else if( apiObject.nextFirstVertex != firstVertex )
+			else if( ( !indexBuffer && !bInstanced && apiObject.lastDatablock != mHlmsDatablock ) ||
+					 apiObject.nextFirstVertex != firstVertex ||
+					 ( bInstanced && apiObject.nextBaseInstance != baseInstance ) ||
+					 ( indexBuffer &&
+					   apiObject.primCount + numPrims > indexBuffer->getNumElements() ) )
 			{
-				if( apiObject.drawCountPtr && apiObject.drawCountPtr->primCount == 0u )
-				{
-					// Adreno 618 will GPU crash if we send an indirect cmd with vertex_count = 0
-					--apiObject.drawCmd->numDraws;
-					// Since we only emit CbDrawStrip we can assume the previous cmd
-					// issued a CbDrawStrip, so take it back. Otherwise we'd have to
-					// save what our last cmd was.
-					apiObject.indirectDraw -= sizeof( CbDrawStrip );
-				}
-
-				//If we're here, we're most likely rendering using breadth first.
-				//Unfortunately, breadth first breaks ordering, thus firstVertex jumped.
-				//Add a new draw without creating a new command
-				CbDrawCallStrip *drawCall = static_cast<CbDrawCallStrip*>( apiObject.drawCmd );
-				++drawCall->numDraws;
+				//Add a new draw without creating a new command. Possible reasons:
+				//	1. Text has arbitrary number of of vertices, thus we can't properly
+				//	   calculate the drawId and therefore the material ID unless we
+				//	   start a new draw.
+				//	2. We're most likely rendering using breadth first. Unfortunately,
+				//	   breadth first breaks ordering, thus firstVertex jumped.
+				//	3. We've run out of indices in the shared index buffer
+				//	   (more than 4096 widgets in a row)
+				//	4. Instances take their drawId from baseInstance + instance ID,
+				//	   so drawIds must be contiguous
+				removeEmptyIndirectDraw( apiObject );
+
+				++apiObject.drawCmd->numDraws;
 				apiObject.primCount = 0;
 				apiObject.lastDatablock = mHlmsDatablock;
 
-				apiObject.drawCountPtr = reinterpret_cast<CbDrawStrip*>( apiObject.indirectDraw );
-				apiObject.drawCountPtr->primCount		= 0;
-				apiObject.drawCountPtr->instanceCount	= 1u;
-				apiObject.drawCountPtr->firstVertexIndex= firstVertex;
-				apiObject.drawCountPtr->baseInstance	= baseInstance;
-				apiObject.indirectDraw += sizeof( CbDrawStrip );
+				addIndirectDraw( apiObject, indexBuffer, firstVertex, baseInstance,
+								 bInstanced ? 0u : 1u );
 			}
 
-			apiObject.primCount += m_numVertices;
-			apiObject.drawCountPtr->primCount = apiObject.primCount;
+			if( bInstanced )
+			{
+				apiObject.primCount = numPrims;
+				++( *apiObject.drawInstanceCount );
+				apiObject.nextFirstVertex = firstVertex;
+			}
+			else
+			{
+				apiObject.primCount += numPrims;
+				apiObject.nextFirstVertex = firstVertex + m_numVertices;
+			}
+			*apiObject.drawPrimCount = apiObject.primCount;
 
-			apiObject.nextFirstVertex = firstVertex + m_numVertices;
+			apiObject.nextBaseInstance = baseInstance + 1u;
 		}
 
 		addChildrenCommands( apiObject, collectingBreadthFirst );
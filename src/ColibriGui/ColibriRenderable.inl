@@ -3,10 +3,13 @@
 
 #include "ColibriGui/ColibriWindow.h"
 #include "ColibriGui/ColibriManager.h"
+#include "ColibriGui/ColibriSimd.h"
 #include "ColibriGui/Ogre/ColibriOgreRenderable.h"
 
 #include "OgreBitwise.h"
 
+#include <stddef.h>
+
 #define TODO_borderRepeatSize
 #define TODO_this_is_a_workaround_neg_y
 
@@ -28,6 +31,66 @@ namespace Colibri
 									 Matrix2x3 derivedRot )
 	{
 		TODO_this_is_a_workaround_neg_y;
+#ifdef COLIBRI_SIMD
+		if( m_manager->getSimdVertexFill() )
+		{
+			static_assert( sizeof( UiVertex ) == 32u && offsetof( UiVertex, clipDistance ) == 16u,
+						   "The SIMD path writes UiVertex as two float4" );
+
+			//The 4 corners in order TL, BL, BR, TR. Each lane is one corner
+			const Simd::float4 cornerX =
+				Simd::set( topLeft.x, topLeft.x, bottomRight.x, bottomRight.x );
+			const Simd::float4 cornerY =
+				Simd::set( topLeft.y, bottomRight.y, bottomRight.y, topLeft.y );
+
+			//Same as Widget::mul followed by the aspect ratio correction & Y flip
+			Simd::float4 head0 = Simd::madd( cornerX, Simd::set1( derivedRot.m[0][0] ),
+											 Simd::madd( cornerY,
+														 Simd::set1( derivedRot.m[0][1] *
+																	 invCanvasAspectRatio ),
+														 Simd::set1( derivedRot.m[0][2] ) ) );
+			Simd::float4 head1 = Simd::madd( cornerX,
+											 Simd::set1( -derivedRot.m[1][0] * canvasAspectRatio ),
+											 Simd::madd( cornerY, Simd::set1( -derivedRot.m[1][1] ),
+														 Simd::set1( -derivedRot.m[1][2] *
+																	 canvasAspectRatio ) ) );
+
+			const uint32_t u0 = static_cast<uint16_t>( uvTopLeftBottomRight.x * 65535.0f );
+			const uint32_t v0 = static_cast<uint32_t>(
+				static_cast<uint16_t>( uvTopLeftBottomRight.y * 65535.0f ) ) << 16u;
+			const uint32_t u1 = static_cast<uint16_t>( uvTopLeftBottomRight.z * 65535.0f );
+			const uint32_t v1 = static_cast<uint32_t>(
+				static_cast<uint16_t>( uvTopLeftBottomRight.w * 65535.0f ) ) << 16u;
+			Simd::float4 head2 = Simd::setBits( u0 | v0, u0 | v1, u1 | v1, u1 | v0 );
+
+			uint32_t colour;
+			memcpy( &colour, rgbaColour, sizeof( colour ) );
+			Simd::float4 head3 = Simd::setBits( colour, colour, colour, colour );
+
+			Simd::float4 clip0 = Simd::mul( Simd::sub( cornerY, Simd::set1( parentDerivedTL.y ) ),
+											Simd::set1( invSize.y ) );
+			Simd::float4 clip1 = Simd::mul( Simd::sub( cornerX, Simd::set1( parentDerivedTL.x ) ),
+											Simd::set1( invSize.x ) );
+			Simd::float4 clip2 = Simd::mul( Simd::sub( Simd::set1( parentDerivedBR.x ), cornerX ),
+											Simd::set1( invSize.x ) );
+			Simd::float4 clip3 = Simd::mul( Simd::sub( Simd::set1( parentDerivedBR.y ), cornerY ),
+											Simd::set1( invSize.y ) );
+
+			//From one lane per corner to one register per corner
+			Simd::transpose( head0, head1, head2, head3 );
+			Simd::transpose( clip0, clip1, clip2, clip3 );
+
+			const Simd::float4 heads[4] = { head0, head1, head2, head3 };
+			const Simd::float4 clips[4] = { clip0, clip1, clip2, clip3 };
+			const size_t c_quadCorners[6] = { 0u, 1u, 2u, 2u, 3u, 0u };
+			for( size_t i = 0u; i < 6u; ++i )
+			{
+				Simd::store( &vertexBuffer[i].x, heads[c_quadCorners[i]] );
+				Simd::store( vertexBuffer[i].clipDistance, clips[c_quadCorners[i]] );
+			}
+			return;
+		}
+#endif
 		Ogre::Vector2 tmp2d;
 
 		#define COLIBRI_ADD_VERTEX( _x, _y, _u, _v, clipDistanceTop, clipDistanceLeft, \
@@ -93,6 +156,187 @@ namespace Colibri
 		#undef COLIBRI_ADD_VERTEX
 	}
 	//-------------------------------------------------------------------------
+	inline void Renderable::addGrid( UiVertex * RESTRICT_ALIAS vertexBuffer,
+									 Ogre::Vector2 outerTopLeft,
+									 Ogre::Vector2 innerTopLeft,
+									 Ogre::Vector2 innerBottomRight,
+									 Ogre::Vector2 outerBottomRight,
+									 const Ogre::Vector4 * RESTRICT_ALIAS uvTopLeftBottomRight,
+									 uint8_t *rgbaColour,
+									 Ogre::Vector2 parentDerivedTL,
+									 Ogre::Vector2 parentDerivedBR,
+									 Ogre::Vector2 invSize,
+									 float canvasAspectRatio,
+									 float invCanvasAspectRatio,
+									 Matrix2x3 derivedRot )
+	{
+		TODO_this_is_a_workaround_neg_y;
+
+		const float gridX[4] = { outerTopLeft.x, innerTopLeft.x,
+								 innerBottomRight.x, outerBottomRight.x };
+		const float gridY[4] = { outerTopLeft.y, innerTopLeft.y,
+								 innerBottomRight.y, outerBottomRight.y };
+
+		//Vertices are shared between adjacent cells, thus each one can only have one UV.
+		//Skins are normally contiguous in UV space so this is lossless. Widgets whose visible
+		//cells aren't (e.g. "all" in grid_uv with borders) are drawn as 9 independent quads
+		//instead, see m_unsharedGrid.
+		const float gridU[4] = { uvTopLeftBottomRight[GridLocations::TopLeft].x,
+								 uvTopLeftBottomRight[GridLocations::Center].x,
+								 uvTopLeftBottomRight[GridLocations::Center].z,
+								 uvTopLeftBottomRight[GridLocations::BottomRight].z };
+		const float gridV[4] = { uvTopLeftBottomRight[GridLocations::TopLeft].y,
+								 uvTopLeftBottomRight[GridLocations::Center].y,
+								 uvTopLeftBottomRight[GridLocations::Center].w,
+								 uvTopLeftBottomRight[GridLocations::BottomRight].w };
+
+#ifdef COLIBRI_SIMD
+		if( m_manager->getSimdVertexFill() )
+		{
+			//Each lane is one column. Columns are shared by all rows, thus the X terms of
+			//the transform and the left & right clip distances are only calculated once.
+			const Simd::float4 columnX = Simd::set( gridX[0], gridX[1], gridX[2], gridX[3] );
+			const Simd::float4 columnPosX = Simd::madd( columnX, Simd::set1( derivedRot.m[0][0] ),
+														Simd::set1( derivedRot.m[0][2] ) );
+			const Simd::float4 columnPosY =
+				Simd::madd( columnX, Simd::set1( -derivedRot.m[1][0] * canvasAspectRatio ),
+							Simd::set1( -derivedRot.m[1][2] * canvasAspectRatio ) );
+			const Simd::float4 clipLeft =
+				Simd::mul( Simd::sub( columnX, Simd::set1( parentDerivedTL.x ) ),
+						   Simd::set1( invSize.x ) );
+			const Simd::float4 clipRight =
+				Simd::mul( Simd::sub( Simd::set1( parentDerivedBR.x ), columnX ),
+						   Simd::set1( invSize.x ) );
+
+			uint32_t columnU[4];
+			for( size_t x = 0u; x < 4u; ++x )
+				columnU[x] = static_cast<uint16_t>( gridU[x] * 65535.0f );
+
+			uint32_t colour;
+			memcpy( &colour, rgbaColour, sizeof( colour ) );
+			const Simd::float4 colours = Simd::setBits( colour, colour, colour, colour );
+
+			const float rowToPosX = derivedRot.m[0][1] * invCanvasAspectRatio;
+			const float rowToPosY = -derivedRot.m[1][1];
+
+			for( size_t y = 0u; y < 4u; ++y )
+			{
+				const uint32_t rowV = static_cast<uint32_t>(
+					static_cast<uint16_t>( gridV[y] * 65535.0f ) ) << 16u;
+
+				Simd::float4 head0 = Simd::add( columnPosX, Simd::set1( rowToPosX * gridY[y] ) );
+				Simd::float4 head1 = Simd::add( columnPosY, Simd::set1( rowToPosY * gridY[y] ) );
+				Simd::float4 head2 = Simd::setBits( columnU[0] | rowV, columnU[1] | rowV,
+													columnU[2] | rowV, columnU[3] | rowV );
+				Simd::float4 head3 = colours;
+
+				Simd::float4 clip0 = Simd::set1( ( gridY[y] - parentDerivedTL.y ) * invSize.y );
+				Simd::float4 clip1 = clipLeft;
+				Simd::float4 clip2 = clipRight;
+				Simd::float4 clip3 = Simd::set1( ( parentDerivedBR.y - gridY[y] ) * invSize.y );
+
+				//From one lane per column to one register per vertex
+				Simd::transpose( head0, head1, head2, head3 );
+				Simd::transpose( clip0, clip1, clip2, clip3 );
+
+				Simd::store( &vertexBuffer[0].x, head0 );
+				Simd::store( vertexBuffer[0].clipDistance, clip0 );
+				Simd::store( &vertexBuffer[1].x, head1 );
+				Simd::store( vertexBuffer[1].clipDistance, clip1 );
+				Simd::store( &vertexBuffer[2].x, head2 );
+				Simd::store( vertexBuffer[2].clipDistance, clip2 );
+				Simd::store( &vertexBuffer[3].x, head3 );
+				Simd::store( vertexBuffer[3].clipDistance, clip3 );
+				vertexBuffer += 4u;
+			}
+			return;
+		}
+#endif
+		for( size_t y = 0u; y < 4u; ++y )
+		{
+			for( size_t x = 0u; x < 4u; ++x )
+			{
+				Ogre::Vector2 tmp2d = Widget::mul( derivedRot, gridX[x],
+												   gridY[y] * invCanvasAspectRatio );
+				tmp2d.y *= canvasAspectRatio;
+				vertexBuffer->x = tmp2d.x;
+				vertexBuffer->y = -tmp2d.y;
+				vertexBuffer->u = static_cast<uint16_t>( gridU[x] * 65535.0f );
+				vertexBuffer->v = static_cast<uint16_t>( gridV[y] * 65535.0f );
+				vertexBuffer->rgbaColour[0] = rgbaColour[0];
+				vertexBuffer->rgbaColour[1] = rgbaColour[1];
+				vertexBuffer->rgbaColour[2] = rgbaColour[2];
+				vertexBuffer->rgbaColour[3] = rgbaColour[3];
+				vertexBuffer->clipDistance[Borders::Top]	= (gridY[y] - parentDerivedTL.y) * invSize.y;
+				vertexBuffer->clipDistance[Borders::Left]	= (gridX[x] - parentDerivedTL.x) * invSize.x;
+				vertexBuffer->clipDistance[Borders::Right]	= (parentDerivedBR.x - gridX[x]) * invSize.x;
+				vertexBuffer->clipDistance[Borders::Bottom]	= (parentDerivedBR.y - gridY[y]) * invSize.y;
+				++vertexBuffer;
+			}
+		}
+	}
+	//-------------------------------------------------------------------------
+	inline void Renderable::addInstance( UiInstance * RESTRICT_ALIAS instance,
+										 Ogre::Vector2 outerTopLeft,
+										 Ogre::Vector2 innerTopLeft,
+										 Ogre::Vector2 innerBottomRight,
+										 Ogre::Vector2 outerBottomRight,
+										 const Ogre::Vector4 * RESTRICT_ALIAS uvTopLeftBottomRight,
+										 uint8_t *rgbaColour,
+										 Ogre::Vector2 parentDerivedTL,
+										 Ogre::Vector2 invSize,
+										 float canvasAspectRatio,
+										 float invCanvasAspectRatio,
+										 const Matrix2x3 &derivedRot )
+	{
+		static_assert( sizeof( UiInstance ) % sizeof( UiVertex ) == 0u,
+					   "UiInstance must fit in a whole number of UiVertex" );
+		static_assert( sizeof( UiInstance ) % 16u == 0u, "UiInstance is read as float4" );
+
+		TODO_this_is_a_workaround_neg_y;
+
+		instance->outerTopLeftBottomRight[0] = outerTopLeft.x;
+		instance->outerTopLeftBottomRight[1] = outerTopLeft.y;
+		instance->outerTopLeftBottomRight[2] = outerBottomRight.x;
+		instance->outerTopLeftBottomRight[3] = outerBottomRight.y;
+		instance->innerTopLeftBottomRight[0] = innerTopLeft.x;
+		instance->innerTopLeftBottomRight[1] = innerTopLeft.y;
+		instance->innerTopLeftBottomRight[2] = innerBottomRight.x;
+		instance->innerTopLeftBottomRight[3] = innerBottomRight.y;
+
+		//Same as addGrid: x' = m0 * (x, y * invAr); y' = -m1 * (x, y * invAr) * ar
+		instance->orientation[0] = derivedRot.m[0][0];
+		instance->orientation[1] = derivedRot.m[0][1] * invCanvasAspectRatio;
+		instance->orientation[2] = derivedRot.m[0][2];
+		instance->orientation[3] = -derivedRot.m[1][0] * canvasAspectRatio;
+		instance->orientation[4] = -derivedRot.m[1][1];
+		instance->orientation[5] = -derivedRot.m[1][2] * canvasAspectRatio;
+
+		memcpy( &instance->rgbaColour, rgbaColour, sizeof( instance->rgbaColour ) );
+		instance->padding = 0u;
+
+		instance->clipTopLeft[0] = parentDerivedTL.x;
+		instance->clipTopLeft[1] = parentDerivedTL.y;
+		instance->clipInvSize[0] = invSize.x;
+		instance->clipInvSize[1] = invSize.y;
+
+		#define COLIBRI_PACK_UV( a, b ) \
+			( static_cast<uint32_t>( static_cast<uint16_t>( a * 65535.0f ) ) | \
+			  ( static_cast<uint32_t>( static_cast<uint16_t>( b * 65535.0f ) ) << 16u ) )
+
+		//See addGrid on why we pick these cells. Unshared grids are never instanced
+		instance->uvGrid[0] = COLIBRI_PACK_UV( uvTopLeftBottomRight[GridLocations::TopLeft].x,
+											   uvTopLeftBottomRight[GridLocations::Center].x );
+		instance->uvGrid[1] = COLIBRI_PACK_UV( uvTopLeftBottomRight[GridLocations::Center].z,
+											   uvTopLeftBottomRight[GridLocations::BottomRight].z );
+		instance->uvGrid[2] = COLIBRI_PACK_UV( uvTopLeftBottomRight[GridLocations::TopLeft].y,
+											   uvTopLeftBottomRight[GridLocations::Center].y );
+		instance->uvGrid[3] = COLIBRI_PACK_UV( uvTopLeftBottomRight[GridLocations::Center].w,
+											   uvTopLeftBottomRight[GridLocations::BottomRight].w );
+
+		#undef COLIBRI_PACK_UV
+	}
+	//-------------------------------------------------------------------------
 	inline void Renderable::_fillBuffersAndCommands( UiVertex * colibri_nonnull * colibri_nonnull
 													 RESTRICT_ALIAS _vertexBuffer,
 													 GlyphVertex * colibri_nonnull * colibri_nonnull
@@ -184,89 +428,50 @@ namespace Colibri
 			const float canvasAr = m_manager->getCanvasAspectRatio();
 			const float invCanvasAr = m_manager->getCanvasInvAspectRatio();
 
-			// 1st row
-			addQuad( vertexBuffer,                                           //
-					 outerTopLeft, innerTopLeft,                             //
-					 stateInfo.uvTopLeftBottomRight[0],                      //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,  //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
-			addQuad( vertexBuffer,                                           //
-					 Ogre::Vector2( innerTopLeft.x, outerTopLeft.y ),        //
-					 Ogre::Vector2( innerBottomRight.x, innerTopLeft.y ),    //
-					 stateInfo.uvTopLeftBottomRight[1],                      //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,  //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
-			addQuad( vertexBuffer,                                           //
-					 Ogre::Vector2( innerBottomRight.x, outerTopLeft.y ),    //
-					 Ogre::Vector2( outerBottomRight.x, innerTopLeft.y ),    //
-					 stateInfo.uvTopLeftBottomRight[2],                      //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,  //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
-			// 2nd row
-			addQuad( vertexBuffer,                                           //
-					 Ogre::Vector2( outerTopLeft.x, innerTopLeft.y ),        //
-					 Ogre::Vector2( innerTopLeft.x, innerBottomRight.y ),    //
-					 stateInfo.uvTopLeftBottomRight[3],                      //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,  //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
-			addQuad( vertexBuffer,                                             //
-					 Ogre::Vector2( innerTopLeft.x, innerTopLeft.y ),          //
-					 Ogre::Vector2( innerBottomRight.x, innerBottomRight.y ),  //
-					 stateInfo.uvTopLeftBottomRight[4],                        //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,    //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
-			addQuad( vertexBuffer,                                             //
-					 Ogre::Vector2( innerBottomRight.x, innerTopLeft.y ),      //
-					 Ogre::Vector2( outerBottomRight.x, innerBottomRight.y ),  //
-					 stateInfo.uvTopLeftBottomRight[5],                        //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,    //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
-			// 3rd row
-			addQuad( vertexBuffer,                                           //
-					 Ogre::Vector2( outerTopLeft.x, innerBottomRight.y ),    //
-					 Ogre::Vector2( innerTopLeft.x, outerBottomRight.y ),    //
-					 stateInfo.uvTopLeftBottomRight[6],                      //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,  //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
-			addQuad( vertexBuffer,                                             //
-					 Ogre::Vector2( innerTopLeft.x, innerBottomRight.y ),      //
-					 Ogre::Vector2( innerBottomRight.x, outerBottomRight.y ),  //
-					 stateInfo.uvTopLeftBottomRight[7],                        //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,    //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
-			addQuad( vertexBuffer,                                             //
-					 Ogre::Vector2( innerBottomRight.x, innerBottomRight.y ),  //
-					 Ogre::Vector2( outerBottomRight.x, outerBottomRight.y ),  //
-					 stateInfo.uvTopLeftBottomRight[8],                        //
-					 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,    //
-					 canvasAr, invCanvasAr, this->m_derivedOrientation );
-			vertexBuffer += 6u;
+			if( m_unsharedGrid )
+			{
+				//The skin's cells don't share their edges in UV space (see
+				//SkinManager::findUnsharedGridCells). Draw 9 independent quads
+				const float gridX[4] = { outerTopLeft.x, innerTopLeft.x,  //
+										 innerBottomRight.x, outerBottomRight.x };
+				const float gridY[4] = { outerTopLeft.y, innerTopLeft.y,  //
+										 innerBottomRight.y, outerBottomRight.y };
+				for( size_t y = 0u; y < 3u; ++y )
+				{
+					for( size_t x = 0u; x < 3u; ++x )
+					{
+						addQuad( vertexBuffer,                                           //
+								 Ogre::Vector2( gridX[x], gridY[y] ),                    //
+								 Ogre::Vector2( gridX[x + 1u], gridY[y + 1u] ),          //
+								 stateInfo.uvTopLeftBottomRight[y * 3u + x],             //
+								 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,  //
+								 canvasAr, invCanvasAr, this->m_derivedOrientation );
+						vertexBuffer += 6u;
+					}
+				}
+			}
+			else if( m_manager->getInstancedWidgets() )
+			{
+				addInstance( reinterpret_cast<UiInstance *>( vertexBuffer ),                 //
+							 outerTopLeft, innerTopLeft, innerBottomRight, outerBottomRight,  //
+							 stateInfo.uvTopLeftBottomRight,                                  //
+							 rgbaColour, parentDerivedTL, invSize,                            //
+							 canvasAr, invCanvasAr, this->m_derivedOrientation );
+				vertexBuffer += sizeof( UiInstance ) / sizeof( UiVertex );
+			}
+			else
+			{
+				addGrid( vertexBuffer, outerTopLeft, innerTopLeft, innerBottomRight,  //
+						 outerBottomRight, stateInfo.uvTopLeftBottomRight,            //
+						 rgbaColour, parentDerivedTL, parentDerivedBR, invSize,       //
+						 canvasAr, invCanvasAr, this->m_derivedOrientation );
+				vertexBuffer += 16u;
+			}
 
 			*_vertexBuffer = vertexBuffer;
 		}
 
-		const Matrix2x3 &finalRot = this->m_derivedOrientation;
-		WidgetVec::const_iterator itor = m_children.begin();
-		WidgetVec::const_iterator end  = m_children.end();
-
-		const Ogre::Vector2 outerTopLeftWithClipping = outerTopLeft +
-													   (m_clipBorderTL - currentScrollPos) *
-													   invCanvasSize2x;
-
-		while( itor != end )
-		{
-			(*itor)->_fillBuffersAndCommands( _vertexBuffer, _textVertBuffer,
-											 outerTopLeftWithClipping, currentScrollPos, finalRot );
-			++itor;
-		}
+		fillChildrenBuffers( _vertexBuffer, _textVertBuffer, currentScrollPos );
 	}
 }
 
@@ -163,6 +163,38 @@ namespace Colibri
 		stateInfo.uvTopLeftBottomRight[idx].w = topLeft.y + widthHeight.y;
 	}
 	//-------------------------------------------------------------------------
+	uint16_t SkinManager::findUnsharedGridCells( const StateInformation &stateInfo,
+												 const Ogre::Vector2 &texResolution )
+	{
+		//Same grid lines Renderable::addGrid uses
+		const Ogre::Vector4 *uvs = stateInfo.uvTopLeftBottomRight;
+		const float gridU[4] = { uvs[GridLocations::TopLeft].x, uvs[GridLocations::Center].x,
+								 uvs[GridLocations::Center].z, uvs[GridLocations::BottomRight].z };
+		const float gridV[4] = { uvs[GridLocations::TopLeft].y, uvs[GridLocations::Center].y,
+								 uvs[GridLocations::Center].w, uvs[GridLocations::BottomRight].w };
+
+		//A fraction of a texel, to absorb rounding errors from converting pixels to UVs
+		const Ogre::Vector2 threshold = 0.0625f / texResolution;
+
+		uint16_t retVal = 0u;
+		for( size_t y = 0u; y < 3u; ++y )
+		{
+			for( size_t x = 0u; x < 3u; ++x )
+			{
+				const Ogre::Vector4 &uv = uvs[y * 3u + x];
+				if( Ogre::Math::Abs( uv.x - gridU[x] ) > threshold.x ||
+					Ogre::Math::Abs( uv.y - gridV[y] ) > threshold.y ||
+					Ogre::Math::Abs( uv.z - gridU[x + 1u] ) > threshold.x ||
+					Ogre::Math::Abs( uv.w - gridV[y + 1u] ) > threshold.y )
+				{
+					retVal |= static_cast<uint16_t>( 1u << ( y * 3u + x ) );
+				}
+			}
+		}
+
+		return retVal;
+	}
+	//-------------------------------------------------------------------------
 	void SkinManager::loadSkins( const rapidjson::Value &skinsValue, const char *filename )
 	{
 		LogListener *log = m_colibriManager->getLogListener();
@@ -340,6 +372,9 @@ namespace Colibri
 						}
 					}
 
+					skinInfo.stateInfo.unsharedGridCells =
+						findUnsharedGridCells( skinInfo.stateInfo, texResolution );
+
 					for( size_t i=0; i<GridLocations::NumGridLocations; ++i )
 					{
 						skinInfo.stateInfo.uvTopLeftBottomRight[i].x += 0.5f / texResolution.x;
@@ -412,6 +447,17 @@ namespace Colibri
 					}
 				}
 
+				if( skinInfo.stateInfo.unsharedGridCells &
+					Renderable::getVisibleGridCells( skinInfo.stateInfo ) )
+				{
+					errorMsg.clear();
+					errorMsg.a( "[SkinManager::loadSkins]: The cells in grid_uv of skin ",
+								itor->name.GetString(), " in ", filename,
+								" don't share their edges. Widgets using it will be drawn "
+								"with 54 vertices instead of 16" );
+					log->log( errorMsg.c_str(), LogSeverity::Warning );
+				}
+
 				if( skinInfo.materialName.empty() )
 				{
 					errorMsg.clear();
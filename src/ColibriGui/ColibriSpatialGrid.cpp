@@ -0,0 +1,238 @@
+
+#include "ColibriGui/ColibriSpatialGrid.h"
+
+#include "ColibriGui/ColibriWindow.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace Colibri
+{
+	/// Maximum number of cells per axis
+	static const uint16_t c_maxCellsPerAxis = 256u;
+	/// When more children than this ratio moved since the last query,
+	/// it's faster to rebuild the whole grid than to move them one by one
+	static const size_t c_rebuildMovedRatio = 4u;
+
+	SpatialGrid::SpatialGrid( Window *window ) :
+		m_window( window ),
+		m_origin( Ogre::Vector2::ZERO ),
+		m_invCellSize( Ogre::Vector2::UNIT_SCALE ),
+		m_numCols( 1u ),
+		m_numRows( 1u ),
+		m_needsRebuild( true ),
+		m_cullAllChildren( true )
+	{
+	}
+	//-------------------------------------------------------------------------
+	bool SpatialGrid::compareWidgetIndexPair( const WidgetIndexPair &a, const WidgetIndexPair &b )
+	{
+		return a.first < b.first;
+	}
+	//-------------------------------------------------------------------------
+	inline uint16_t SpatialGrid::getCell( float value, float origin, float invCellSize,
+										  uint16_t numCells ) const
+	{
+		// Values outside the grid get clamped to the border cells. Rects and queries
+		// are clamped the same way, thus they still find each other.
+		const float cell = floorf( ( value - origin ) * invCellSize );
+		if( !( cell > 0.0f ) )  // Also catches NaNs
+			return 0u;
+		if( cell >= static_cast<float>( numCells - 1u ) )
+			return static_cast<uint16_t>( numCells - 1u );
+		return static_cast<uint16_t>( cell );
+	}
+	//-------------------------------------------------------------------------
+	SpatialGrid::CellRange SpatialGrid::getCellRange( const Ogre::Vector2 &topLeft,
+													  const Ogre::Vector2 &bottomRight ) const
+	{
+		CellRange range;
+		range.minX = getCell( topLeft.x, m_origin.x, m_invCellSize.x, m_numCols );
+		range.minY = getCell( topLeft.y, m_origin.y, m_invCellSize.y, m_numRows );
+		range.maxX = getCell( bottomRight.x, m_origin.x, m_invCellSize.x, m_numCols );
+		range.maxY = getCell( bottomRight.y, m_origin.y, m_invCellSize.y, m_numRows );
+		return range;
+	}
+	//-------------------------------------------------------------------------
+	void SpatialGrid::insert( uint32_t childIdx, const CellRange &range )
+	{
+		for( size_t y = range.minY; y <= range.maxY; ++y )
+		{
+			for( size_t x = range.minX; x <= range.maxX; ++x )
+				m_cells[y * m_numCols + x].push_back( childIdx );
+		}
+	}
+	//-------------------------------------------------------------------------
+	void SpatialGrid::remove( uint32_t childIdx, const CellRange &range )
+	{
+		for( size_t y = range.minY; y <= range.maxY; ++y )
+		{
+			for( size_t x = range.minX; x <= range.maxX; ++x )
+			{
+				IndexVec &cell = m_cells[y * m_numCols + x];
+				IndexVec::iterator itor = std::find( cell.begin(), cell.end(), childIdx );
+				COLIBRI_ASSERT_MEDIUM( itor != cell.end() );
+				*itor = cell.back();
+				cell.pop_back();
+			}
+		}
+	}
+	//-------------------------------------------------------------------------
+	void SpatialGrid::rebuild()
+	{
+		const WidgetVec &children = m_window->getChildren();
+		const size_t numChildren = m_window->getOffsetStartWindowChildren();
+
+		// Size the cells after the average child, which is what
+		// matters for grids and lists of similar widgets.
+		Ogre::Vector2 minPos( Ogre::Vector2::ZERO );
+		Ogre::Vector2 maxPos( Ogre::Vector2::ZERO );
+		Ogre::Vector2 avgSize( Ogre::Vector2::ZERO );
+
+		if( numChildren > 0u )
+		{
+			minPos = children[0]->getLocalTopLeft();
+			maxPos = children[0]->getLocalBottomRight();
+		}
+
+		for( size_t i = 0u; i < numChildren; ++i )
+		{
+			const Widget *child = children[i];
+			minPos.makeFloor( child->getLocalTopLeft() );
+			maxPos.makeCeil( child->getLocalBottomRight() );
+			avgSize += child->getSize();
+		}
+
+		if( numChildren > 0u )
+			avgSize /= static_cast<float>( numChildren );
+
+		const Ogre::Vector2 extent = maxPos - minPos;
+		Ogre::Vector2 cellSize = avgSize;
+		cellSize.makeCeil( extent / static_cast<float>( c_maxCellsPerAxis ) );
+		cellSize.makeCeil( Ogre::Vector2::UNIT_SCALE );
+
+		m_origin = minPos;
+		m_invCellSize = 1.0f / cellSize;
+		m_numCols = static_cast<uint16_t>(
+			std::min<float>( ceilf( extent.x / cellSize.x ), c_maxCellsPerAxis ) );
+		m_numRows = static_cast<uint16_t>(
+			std::min<float>( ceilf( extent.y / cellSize.y ), c_maxCellsPerAxis ) );
+		m_numCols = std::max<uint16_t>( m_numCols, 1u );
+		m_numRows = std::max<uint16_t>( m_numRows, 1u );
+
+		m_cells.clear();
+		m_cells.resize( size_t( m_numCols ) * size_t( m_numRows ) );
+		m_cellRanges.resize( numChildren );
+		m_childIndices.resize( numChildren );
+
+		for( size_t i = 0u; i < numChildren; ++i )
+		{
+			const Widget *child = children[i];
+			const uint32_t childIdx = static_cast<uint32_t>( i );
+			m_cellRanges[i] = getCellRange( child->getLocalTopLeft(), child->getLocalBottomRight() );
+			insert( childIdx, m_cellRanges[i] );
+			m_childIndices[i] = WidgetIndexPair( child, childIdx );
+		}
+
+		std::sort( m_childIndices.begin(), m_childIndices.end(), compareWidgetIndexPair );
+
+		m_movedChildren.clear();
+		m_needsRebuild = false;
+	}
+	//-------------------------------------------------------------------------
+	void SpatialGrid::update()
+	{
+		if( m_needsRebuild )
+		{
+			rebuild();
+			return;
+		}
+
+		WidgetVec::const_iterator itor = m_movedChildren.begin();
+		WidgetVec::const_iterator endt = m_movedChildren.end();
+
+		while( itor != endt )
+		{
+			const Widget *child = *itor;
+
+			std::vector<WidgetIndexPair>::const_iterator itIdx =
+				std::lower_bound( m_childIndices.begin(), m_childIndices.end(),
+								  WidgetIndexPair( child, 0u ), compareWidgetIndexPair );
+			COLIBRI_ASSERT_LOW( itIdx != m_childIndices.end() && itIdx->first == child );
+
+			const uint32_t childIdx = itIdx->second;
+			const CellRange newRange =
+				getCellRange( child->getLocalTopLeft(), child->getLocalBottomRight() );
+
+			if( newRange != m_cellRanges[childIdx] )
+			{
+				remove( childIdx, m_cellRanges[childIdx] );
+				insert( childIdx, newRange );
+				m_cellRanges[childIdx] = newRange;
+			}
+
+			++itor;
+		}
+
+		m_movedChildren.clear();
+	}
+	//-------------------------------------------------------------------------
+	void SpatialGrid::_notifyChildrenChanged()
+	{
+		m_needsRebuild = true;
+		m_cullAllChildren = true;
+		m_movedChildren.clear();
+		// May contain children that are being destroyed
+		m_visibleChildren.clear();
+	}
+	//-------------------------------------------------------------------------
+	void SpatialGrid::_notifyChildMoved( Widget *child )
+	{
+		if( m_needsRebuild )
+			return;
+
+		COLIBRI_ASSERT_LOW( child->getParent() == m_window && !child->isWindow() );
+
+		m_movedChildren.push_back( child );
+
+		if( m_movedChildren.size() > 32u &&
+			m_movedChildren.size() > m_childIndices.size() / c_rebuildMovedRatio )
+		{
+			m_needsRebuild = true;
+			m_movedChildren.clear();
+		}
+	}
+	//-------------------------------------------------------------------------
+	const std::vector<uint32_t> &SpatialGrid::query( const Ogre::Vector2 &topLeft,
+													 const Ogre::Vector2 &bottomRight )
+	{
+		update();
+
+		m_queryResults.clear();
+
+		const CellRange range = getCellRange( topLeft, bottomRight );
+
+		for( size_t y = range.minY; y <= range.maxY; ++y )
+		{
+			for( size_t x = range.minX; x <= range.maxX; ++x )
+			{
+				const IndexVec &cell = m_cells[y * m_numCols + x];
+				m_queryResults.insert( m_queryResults.end(), cell.begin(), cell.end() );
+			}
+		}
+
+		// Children spanning multiple cells were added more than once
+		std::sort( m_queryResults.begin(), m_queryResults.end() );
+		m_queryResults.erase( std::unique( m_queryResults.begin(), m_queryResults.end() ),
+							  m_queryResults.end() );
+
+		return m_queryResults;
+	}
+	//-------------------------------------------------------------------------
+	bool SpatialGrid::_consumeCullAllChildren()
+	{
+		const bool retVal = m_cullAllChildren;
+		m_cullAllChildren = false;
+		return retVal;
+	}
+}  // namespace Colibri
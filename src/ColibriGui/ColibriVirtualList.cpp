@@ -0,0 +1,259 @@
+
+#include "ColibriGui/ColibriVirtualList.h"
+
+#include "ColibriGui/ColibriManager.h"
+#include "ColibriGui/ColibriWindow.h"
+
+#include <math.h>
+
+namespace Colibri
+{
+	VirtualListDataSource::~VirtualListDataSource() {}
+	//-------------------------------------------------------------------------
+	//-------------------------------------------------------------------------
+	//-------------------------------------------------------------------------
+	VirtualList::VirtualList( ColibriManager *manager ) :
+		Widget( manager ),
+		m_dataSource( 0 ),
+		m_rowHeight( 32.0f ),
+		m_overscan( 2u ),
+		m_numItems( 0u ),
+		m_firstItem( 0u ),
+		m_lastScroll( Ogre::Vector2::ZERO ),
+		m_lastViewSize( Ogre::Vector2::ZERO ),
+		m_lastWidth( 0.0f ),
+		m_dataDirty( true ),
+		m_layoutDirty( true )
+	{
+		m_childrenClickable = true;
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::_initialize()
+	{
+		COLIBRI_ASSERT( m_parent->isWindow() && "VirtualList's parent must be a Window!" );
+		Widget::_initialize();
+		m_manager->_addUpdateWidget( this );
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::_destroy()
+	{
+		m_manager->_removeUpdateWidget( this );
+
+		Widget::_destroy();
+
+		// Our rows are children of us, so they were destroyed by our super class
+		m_activeRows.clear();
+		m_freeRows.clear();
+		m_dataSource = 0;
+	}
+	//-------------------------------------------------------------------------
+	Window *VirtualList::getParentWindow()
+	{
+		COLIBRI_ASSERT_HIGH( dynamic_cast<Window *>( m_parent ) );
+		return static_cast<Window *>( m_parent );
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::setDataSource( VirtualListDataSource *colibri_nullable dataSource )
+	{
+		if( m_dataSource == dataSource )
+			return;
+
+		// Rows were created by the old data source. The new one may want different widgets
+		m_activeRows.insert( m_activeRows.end(), m_freeRows.begin(), m_freeRows.end() );
+
+		WidgetVec::const_iterator itor = m_activeRows.begin();
+		WidgetVec::const_iterator endt = m_activeRows.end();
+
+		while( itor != endt )
+			m_manager->destroyWidget( *itor++ );
+
+		m_activeRows.clear();
+		m_freeRows.clear();
+		m_firstItem = 0u;
+
+		m_dataSource = dataSource;
+		notifyDataChanged();
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::setRowHeight( float rowHeight )
+	{
+		COLIBRI_ASSERT_LOW( rowHeight > 0.0f );
+		if( m_rowHeight != rowHeight )
+		{
+			m_rowHeight = rowHeight;
+			m_layoutDirty = true;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::setOverscan( size_t numRows )
+	{
+		if( m_overscan != numRows )
+		{
+			m_overscan = numRows;
+			m_layoutDirty = true;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::notifyDataChanged()
+	{
+		m_dataDirty = true;
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::notifyItemChanged( size_t itemIdx )
+	{
+		Widget *row = getRow( itemIdx );
+		if( row && m_dataSource && !m_dataDirty )
+			m_dataSource->bindRow( this, row, itemIdx );
+	}
+	//-------------------------------------------------------------------------
+	Widget *colibri_nullable VirtualList::getRow( size_t itemIdx ) const
+	{
+		if( itemIdx < m_firstItem || itemIdx - m_firstItem >= m_activeRows.size() )
+			return 0;
+		return m_activeRows[itemIdx - m_firstItem];
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::scrollToItem( size_t itemIdx, bool bAnimated )
+	{
+		Window *window = getParentWindow();
+
+		const float itemTop = m_position.y + static_cast<float>( itemIdx ) * m_rowHeight;
+		const float viewHeight = window->getSizeAfterClipping().y;
+
+		Ogre::Vector2 scroll = bAnimated ? window->getNextScroll() : window->getCurrentScroll();
+
+		if( itemTop < scroll.y )
+			scroll.y = itemTop;
+		else if( itemTop + m_rowHeight > scroll.y + viewHeight )
+			scroll.y = itemTop + m_rowHeight - viewHeight;
+
+		if( bAnimated )
+			window->setScrollAnimated( scroll, false );
+		else
+			window->setScrollImmediate( scroll );
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::updateScrollableArea()
+	{
+		const Ogre::Vector2 newSize( m_size.x, static_cast<float>( m_numItems ) * m_rowHeight );
+		if( m_size != newSize )
+			setSize( newSize );
+
+		Window *window = getParentWindow();
+		window->setScrollableArea( m_position + m_size );
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::placeRow( Widget *row, size_t itemIdx )
+	{
+		row->setTransform( Ogre::Vector2( 0.0f, static_cast<float>( itemIdx ) * m_rowHeight ),
+						   Ogre::Vector2( m_size.x, m_rowHeight ) );
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::updateRows( bool bRebindAll, bool bRelayoutAll )
+	{
+		size_t newFirst = 0u;
+		size_t newEnd = 0u;
+
+		if( m_dataSource && m_numItems > 0u )
+		{
+			// View range, in our local space
+			const float viewTop = m_lastScroll.y - m_position.y;
+			const float viewBottom = viewTop + m_lastViewSize.y;
+
+			const size_t firstVisible =
+				viewTop > 0.0f ? static_cast<size_t>( viewTop / m_rowHeight ) : 0u;
+			const size_t endVisible =
+				viewBottom > 0.0f ? static_cast<size_t>( ceilf( viewBottom / m_rowHeight ) ) : 0u;
+
+			newFirst = firstVisible > m_overscan ? ( firstVisible - m_overscan ) : 0u;
+			newEnd = std::min( endVisible + m_overscan, m_numItems );
+			newFirst = std::min( newFirst, newEnd );
+		}
+
+		// Rows of items still in range stay where they are. The rest are freed
+		m_tmpRows.clear();
+		m_tmpRows.resize( newEnd - newFirst, 0 );
+
+		const size_t numActiveRows = m_activeRows.size();
+		for( size_t i = 0u; i < numActiveRows; ++i )
+		{
+			Widget *row = m_activeRows[i];
+			const size_t itemIdx = m_firstItem + i;
+
+			if( itemIdx >= newFirst && itemIdx < newEnd )
+			{
+				m_tmpRows[itemIdx - newFirst] = row;
+				if( bRelayoutAll )
+					placeRow( row, itemIdx );
+				if( bRebindAll )
+					m_dataSource->bindRow( this, row, itemIdx );
+			}
+			else
+			{
+				row->setHidden( true );
+				m_freeRows.push_back( row );
+			}
+		}
+
+		// Items that just came into range take a free row (or a new one if there are none)
+		const size_t numNewRows = m_tmpRows.size();
+		for( size_t i = 0u; i < numNewRows; ++i )
+		{
+			if( m_tmpRows[i] )
+				continue;
+
+			Widget *row;
+			if( !m_freeRows.empty() )
+			{
+				row = m_freeRows.back();
+				m_freeRows.pop_back();
+				row->setHidden( false );
+			}
+			else
+			{
+				row = m_dataSource->createRow( this );
+				COLIBRI_ASSERT( row->getParent() == this &&
+								"VirtualListDataSource::createRow must create it as our child" );
+			}
+
+			const size_t itemIdx = newFirst + i;
+			placeRow( row, itemIdx );
+			m_dataSource->bindRow( this, row, itemIdx );
+			m_tmpRows[i] = row;
+		}
+
+		m_activeRows.swap( m_tmpRows );
+		m_firstItem = newFirst;
+	}
+	//-------------------------------------------------------------------------
+	void VirtualList::_update( float timeSinceLast )
+	{
+		Window *window = getParentWindow();
+
+		const Ogre::Vector2 &scroll = window->getCurrentScroll();
+		const Ogre::Vector2 viewSize = window->getSizeAfterClipping();
+
+		if( !m_dataDirty && !m_layoutDirty && m_lastWidth == m_size.x &&
+			m_lastScroll == scroll && m_lastViewSize == viewSize )
+		{
+			return;
+		}
+
+		const bool bRebindAll = m_dataDirty;
+		const bool bRelayoutAll = m_layoutDirty || m_lastWidth != m_size.x;
+
+		if( m_dataDirty )
+			m_numItems = m_dataSource ? m_dataSource->getNumItems( this ) : 0u;
+
+		if( bRebindAll || bRelayoutAll )
+			updateScrollableArea();
+
+		m_lastScroll = scroll;
+		m_lastViewSize = viewSize;
+		m_lastWidth = m_size.x;
+		m_dataDirty = false;
+		m_layoutDirty = false;
+
+		updateRows( bRebindAll, bRelayoutAll );
+	}
+}  // namespace Colibri
@@ -3,6 +3,7 @@
 #include "ColibriGui/ColibriWindow.h"
 
 #include "ColibriGui/ColibriManager.h"
+#include "ColibriGui/ColibriSpatialGrid.h"
 
 #define TODO_account_rotation
 
@@ -24,6 +25,11 @@ namespace Colibri
 		m_numNonRenderables( 0 ),
 		m_numWidgets( 0 ),
 		m_manager( manager ),
+		m_navPosition( Ogre::Vector2::ZERO ),
+		m_navSize( Ogre::Vector2::ZERO ),
+		m_navIndex( std::numeric_limits<uint32_t>::max() ),
+		m_navNavigable( false ),
+		m_navChanged( false ),
 		m_hidden( false ),
 		m_ignoreFromChildrenSize( false ),
 		m_clickable( false ),
@@ -57,8 +63,12 @@ namespace Colibri
   #endif
 	{
 		memset( m_nextWidget, 0, sizeof(m_nextWidget) );
+		memset( m_navClosest, 0, sizeof(m_navClosest) );
 		for( size_t i=0; i<Borders::NumBorders; ++i )
+		{
 			m_autoSetNextWidget[i] = true;
+			m_navClosestDistance[i] = std::numeric_limits<float>::max();
+		}
 	}
 	//-------------------------------------------------------------------------
 	Widget::~Widget()
@@ -81,6 +91,8 @@ namespace Colibri
 			//It may not be found if we're also in destruction phase
 			retVal = static_cast<size_t>( itor - m_children.begin() );
 			m_children.erase( itor );
+			_setVisualsDirty();
+			_setVertexCountsDirty();
 
 			COLIBRI_ASSERT( (retVal < m_numWidgets && !childWidgetBeingRemoved->isWindow()) ||
 							(retVal >= m_numWidgets && childWidgetBeingRemoved->isWindow()) );
@@ -247,15 +259,48 @@ namespace Colibri
 			}
 			parent->m_children.insert( parent->m_children.begin() + ptrdiff_t( idx ), this );
 			++parent->m_numWidgets;  // Must be incremented regardless of whether it's a renderable
+
+			SpatialGrid *spatialGrid = parent->getSpatialGrid();
+			if( spatialGrid )
+				spatialGrid->_notifyChildrenChanged();
 		}
 		else
 		{
 			parent->m_children.push_back( this );
 		}
 		parent->setWidgetNavigationDirty();
+		_setVertexCountsDirty();
 		setTransformDirty( TransformDirtyPosition | TransformDirtyOrientation );
 	}
 	//-------------------------------------------------------------------------
+	void Widget::_setVisualsDirty()
+	{
+		Widget *rootWidget = this;
+		while( rootWidget->m_parent )
+			rootWidget = rootWidget->m_parent;
+
+		// Widgets not yet attached have no root window. _setParent will flag it later
+		if( rootWidget->isWindow() )
+		{
+			COLIBRI_ASSERT_HIGH( dynamic_cast<Window *>( rootWidget ) );
+			static_cast<Window *>( rootWidget )->m_visualsDirty = true;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void Widget::_setVertexCountsDirty()
+	{
+		Widget *rootWidget = this;
+		while( rootWidget->m_parent )
+			rootWidget = rootWidget->m_parent;
+
+		// Widgets not yet attached have no root window. _setParent will flag it later
+		if( rootWidget->isWindow() )
+		{
+			COLIBRI_ASSERT_HIGH( dynamic_cast<Window *>( rootWidget ) );
+			static_cast<Window *>( rootWidget )->m_maxVertexCountsDirty = true;
+		}
+	}
+	//-------------------------------------------------------------------------
 	void Widget::setKeyboardFocus()
 	{
 		if( isDisabled() )
@@ -279,13 +324,18 @@ namespace Colibri
 		m_mouseReleaseTriggersPrimaryAction = bTriggerPrimaryAction;
 	}
 	//-------------------------------------------------------------------------
-	void Widget::_setDestructionDelayed() { m_hidden = true; }
+	void Widget::_setDestructionDelayed()
+	{
+		m_hidden = true;
+		_setVisualsDirty();
+	}
 	//-------------------------------------------------------------------------
 	void Widget::setHidden( bool hidden )
 	{
 		if( m_hidden != hidden )
 		{
 			m_hidden = hidden;
+			_setVisualsDirty();
 
 			if( m_currentState != States::Idle && m_currentState != States::Disabled )
 			{
@@ -677,30 +727,31 @@ namespace Colibri
 
 		Ogre::Vector2 currentScroll = getCurrentScroll();
 
-		WidgetVec::const_iterator itor = m_children.begin();
-		WidgetVec::const_iterator endt = m_children.begin() + ptrdiff_t( m_numWidgets );
-
-		while( itor != endt )
+		if( isWindow() && static_cast<const Window *>( this )->canQueryChildrenAt() )
 		{
-			Widget *widget = *itor;
-			if( ( widget->m_clickable || widget->m_childrenClickable ) &&  //
-				!widget->isDisabled() &&                                   //
-				!widget->isHidden() &&                                     //
-				this->intersectsChild( widget, currentScroll ) &&          //
-				widget->intersects( newPosNdc ) )
+			//Only the children under the cursor. They're sorted, thus the last one still wins
+			const std::vector<uint32_t> &childrenIndices =
+				static_cast<Window *>( this )->queryChildrenAt( newPosNdc );
+
+			std::vector<uint32_t>::const_iterator itor = childrenIndices.begin();
+			std::vector<uint32_t>::const_iterator endt = childrenIndices.end();
+
+			while( itor != endt )
 			{
-				if( widget->m_clickable )
-					retVal.widget = widget;
+				setIdleCursorMovedOnChild( m_children[*itor], newPosNdc, currentScroll, retVal );
+				++itor;
+			}
+		}
+		else
+		{
+			WidgetVec::const_iterator itor = m_children.begin();
+			WidgetVec::const_iterator endt = m_children.begin() + ptrdiff_t( m_numWidgets );
 
-				if( widget->m_childrenClickable )
-				{
-					FocusPair childFocusPair;
-					childFocusPair = widget->_setIdleCursorMoved( newPosNdc );
-					if( childFocusPair.widget )
-						retVal = childFocusPair;
-				}
+			while( itor != endt )
+			{
+				setIdleCursorMovedOnChild( *itor, newPosNdc, currentScroll, retVal );
+				++itor;
 			}
-			++itor;
 		}
 
 		retVal.window = getFirstParentWindow();
@@ -708,6 +759,29 @@ namespace Colibri
 		return retVal;
 	}
 	//-------------------------------------------------------------------------
+	void Widget::setIdleCursorMovedOnChild( Widget *widget, const Ogre::Vector2 &newPosNdc,
+											const Ogre::Vector2 &currentScroll,
+											FocusPair &inOutFocusPair )
+	{
+		if( ( widget->m_clickable || widget->m_childrenClickable ) &&  //
+			!widget->isDisabled() &&                                   //
+			!widget->isHidden() &&                                     //
+			this->intersectsChild( widget, currentScroll ) &&          //
+			widget->intersects( newPosNdc ) )
+		{
+			if( widget->m_clickable )
+				inOutFocusPair.widget = widget;
+
+			if( widget->m_childrenClickable )
+			{
+				FocusPair childFocusPair;
+				childFocusPair = widget->_setIdleCursorMoved( newPosNdc );
+				if( childFocusPair.widget )
+					inOutFocusPair = childFocusPair;
+			}
+		}
+	}
+	//-------------------------------------------------------------------------
 	void Widget::notifyCursorMoved( const Ogre::Vector2& posNDC )
 	{
 	}
@@ -771,21 +845,124 @@ namespace Colibri
 		m_accumMinClipTL = parentDerivedTL;
 		m_accumMaxClipBR = parentDerivedBR;
 
-		WidgetVec::const_iterator itor = m_children.begin();
-		WidgetVec::const_iterator end  = m_children.end();
+		fillChildrenBuffers( vertexBuffer, textVertBuffer, Ogre::Vector2::ZERO /*getCurrentScroll()*/ );
+	}
+	//-------------------------------------------------------------------------
+	void Widget::fillChildrenBuffers( UiVertex ** RESTRICT_ALIAS vertexBuffer,
+									  GlyphVertex ** RESTRICT_ALIAS textVertBuffer,
+									  const Ogre::Vector2 &currentScrollPos )
+	{
+		const Ogre::Vector2 invCanvasSize2x = m_manager->getInvCanvasSize2x();
 
-		const Ogre::Vector2 currentScrollPos = Ogre::Vector2::ZERO /*getCurrentScroll()*/;
-		const Ogre::Vector2 outerTopLeft = this->m_derivedTopLeft;
-		const Ogre::Vector2 outerTopLeftWithClipping = outerTopLeft +
-													   (m_clipBorderTL - currentScrollPos) *
-													   invCanvasSize2x;
+		if( !m_breadthFirst && !m_manager->m_collectingBreadthFirstFill )
+		{
+			const Ogre::Vector2 outerTopLeftWithClipping = m_derivedTopLeft +
+														   (m_clipBorderTL - currentScrollPos) *
+														   invCanvasSize2x;
 
-		while( itor != end )
+			WidgetVec::const_iterator itor = m_children.begin();
+			WidgetVec::const_iterator end  = m_children.end();
+
+			SpatialGrid *spatialGrid = getSpatialGrid();
+			if( spatialGrid )
+			{
+				//Only visit the children overlapping our visible region. Those we don't
+				//visit can't flag themselves as culled, thus we must do it for them.
+				WidgetVec &visibleChildren = spatialGrid->_getVisibleChildren();
+
+				if( spatialGrid->_consumeCullAllChildren() )
+				{
+					for( size_t i = 0u; i < m_numWidgets; ++i )
+						m_children[i]->m_culled = true;
+				}
+				else
+				{
+					WidgetVec::const_iterator itVisible = visibleChildren.begin();
+					WidgetVec::const_iterator enVisible = visibleChildren.end();
+
+					while( itVisible != enVisible )
+						(*itVisible++)->m_culled = true;
+				}
+
+				visibleChildren.clear();
+
+				const std::vector<uint32_t> &childrenIndices =
+					spatialGrid->query( currentScrollPos, currentScrollPos + m_size );
+
+				std::vector<uint32_t>::const_iterator itIdx = childrenIndices.begin();
+				std::vector<uint32_t>::const_iterator enIdx = childrenIndices.end();
+
+				while( itIdx != enIdx )
+				{
+					Widget *child = m_children[*itIdx];
+					child->_fillBuffersAndCommands( vertexBuffer, textVertBuffer,
+													outerTopLeftWithClipping, currentScrollPos,
+													m_derivedOrientation );
+					if( !child->m_culled )
+						visibleChildren.push_back( child );
+					++itIdx;
+				}
+
+				//Child windows are not in the grid
+				itor = m_children.begin() + ptrdiff_t( m_numWidgets );
+			}
+
+			while( itor != end )
+			{
+				(*itor)->_fillBuffersAndCommands( vertexBuffer, textVertBuffer,
+												  outerTopLeftWithClipping, currentScrollPos,
+												  m_derivedOrientation );
+				++itor;
+			}
+		}
+		else
 		{
-			(*itor)->_fillBuffersAndCommands( vertexBuffer, textVertBuffer,
-											  outerTopLeftWithClipping, currentScrollPos,
-											  m_derivedOrientation );
-			++itor;
+			//Mirrors addChildrenCommands. If the order doesn't match exactly,
+			//draws can't be merged (and still render correctly, just slower)
+			WidgetVec *breadthFirst = m_manager->m_breadthFirst;
+
+			breadthFirst[2].insert( breadthFirst[2].end(), m_children.begin(),
+									m_children.begin() + ptrdiff_t( m_numNonRenderables ) );
+			breadthFirst[3].insert( breadthFirst[3].end(),
+									m_children.begin() + ptrdiff_t( m_numNonRenderables ),
+									m_children.end() );
+
+			if( !m_manager->m_collectingBreadthFirstFill )
+			{
+				m_manager->m_collectingBreadthFirstFill = true;
+
+				while( !breadthFirst[2].empty() || !breadthFirst[3].empty() )
+				{
+					breadthFirst[0].swap( breadthFirst[2] );
+					breadthFirst[1].swap( breadthFirst[3] );
+
+					for( size_t i = 0u; i < 2u; ++i )
+					{
+						WidgetVec::const_iterator itor = breadthFirst[i].begin();
+						WidgetVec::const_iterator end  = breadthFirst[i].end();
+
+						while( itor != end )
+						{
+							//We're no longer recursing, thus the arguments must
+							//be rebuilt from the parent (which was already filled)
+							const Widget *parent = (*itor)->m_parent;
+							const Ogre::Vector2 &parentScroll = parent->getCurrentScroll();
+							const Ogre::Vector2 parentPos = parent->m_derivedTopLeft +
+															(parent->m_clipBorderTL - parentScroll) *
+															invCanvasSize2x;
+							(*itor)->_fillBuffersAndCommands( vertexBuffer, textVertBuffer,
+															  parentPos, parentScroll,
+															  parent->m_derivedOrientation );
+							++itor;
+						}
+					}
+
+					breadthFirst[0].clear();
+					breadthFirst[1].clear();
+				}
+
+				m_manager->m_collectingBreadthFirstFill = false;
+			}
 		}
 	}
 	//-------------------------------------------------------------------------
@@ -800,7 +977,42 @@ namespace Colibri
 	//-------------------------------------------------------------------------
 	void Widget::addChildrenCommands( ApiEncapsulatedObjects &apiObject, bool collectingBreadthFirst )
 	{
-		if( !m_breadthFirst && !collectingBreadthFirst )
+		SpatialGrid *spatialGrid = getSpatialGrid();
+
+		if( !m_breadthFirst && !collectingBreadthFirst && spatialGrid )
+		{
+			//Only the children that weren't culled in fillChildrenBuffers. They're in the
+			//same order as m_children, thus non-renderables go first (and windows last)
+			const WidgetVec &visibleChildren = spatialGrid->_getVisibleChildren();
+
+			WidgetVec::const_iterator itor = visibleChildren.begin();
+			WidgetVec::const_iterator endt = visibleChildren.end();
+
+			while( itor != endt )
+			{
+				if( (*itor)->isRenderable() )
+				{
+					COLIBRI_ASSERT_HIGH( dynamic_cast<Renderable*>( *itor ) );
+					static_cast<Renderable*>( *itor )->_addCommands( apiObject, false );
+				}
+				else
+				{
+					(*itor)->addNonRenderableCommands( apiObject, false );
+				}
+				++itor;
+			}
+
+			itor = m_children.begin() + ptrdiff_t( m_numWidgets );
+			endt = m_children.end();
+
+			while( itor != endt )
+			{
+				COLIBRI_ASSERT_HIGH( dynamic_cast<Renderable*>( *itor ) );
+				static_cast<Renderable*>( *itor )->_addCommands( apiObject, false );
+				++itor;
+			}
+		}
+		else if( !m_breadthFirst && !collectingBreadthFirst )
 		{
 			WidgetVec::const_iterator itor = m_children.begin();
 			WidgetVec::const_iterator endt = m_children.begin() + ptrdiff_t( m_numNonRenderables );
@@ -901,6 +1113,9 @@ namespace Colibri
 
 		const States::States oldValue = m_currentState;
 
+		if( oldValue != state )
+			_setVisualsDirty();
+
 		m_currentState = state;
 
 		WidgetVec::const_iterator itor = m_children.begin();
@@ -961,9 +1176,33 @@ namespace Colibri
 			++itor;
 		}
 
+		// Children share our root window. Only the first caller needs to flag it.
+		// TransformDirtyAll includes TransformDirtyParentCaller, thus we can't tell
+		// who called and must assume it's the first caller.
+		if( dirtyReason == TransformDirtyAll || !( dirtyReason & TransformDirtyParentCaller ) )
+		{
+			_setVisualsDirty();
+
+			if( m_parent && !isWindow() &&
+				( dirtyReason & ( TransformDirtyPosition | TransformDirtyScale ) ) )
+			{
+				SpatialGrid *spatialGrid = m_parent->getSpatialGrid();
+				if( spatialGrid )
+					spatialGrid->_notifyChildMoved( this );
+			}
+		}
+
 		m_manager->_setWidgetTransformsDirty();
 	}
 	//-------------------------------------------------------------------------
+	SpatialGrid *colibri_nullable Widget::getSpatialGrid() const
+	{
+		if( !isWindow() )
+			return 0;
+		COLIBRI_ASSERT_HIGH( dynamic_cast<const Window *>( this ) );
+		return static_cast<const Window *>( this )->m_spatialGrid;
+	}
+	//-------------------------------------------------------------------------
 	void Widget::scheduleSetTransformDirty()
 	{
 		m_manager->_scheduleSetTransformDirty( this );
@@ -3,6 +3,7 @@
 
 #include "ColibriGui/ColibriManager.h"
 #include "ColibriGui/ColibriSkinManager.h"
+#include "ColibriGui/ColibriSpatialGrid.h"
 
 #include "ColibriRenderable.inl"
 
@@ -19,7 +20,16 @@ namespace Colibri
 		m_lastPrimaryAction( std::numeric_limits<uint16_t>::max() ),
 		m_widgetNavigationDirty( false ),
 		m_windowNavigationDirty( false ),
-		m_childrenNavigationDirty( false )
+		m_childrenNavigationDirty( false ),
+		m_visualsDirty( true ),
+		m_vertexStart( std::numeric_limits<uint32_t>::max() ),
+		m_vertexCount( 0u ),
+		m_textVertexStart( std::numeric_limits<uint32_t>::max() ),
+		m_textVertexCount( 0u ),
+		m_maxVertexCount( 0u ),
+		m_maxTextVertexCount( 0u ),
+		m_maxVertexCountsDirty( true ),
+		m_spatialGrid( 0 )
 	{
 		memset( m_arrows, 0, sizeof( m_arrows ) );
 		memset( m_scrollArrowsVisibility, 0, sizeof( m_scrollArrowsVisibility ) );
@@ -80,6 +90,7 @@ namespace Colibri
 							   parentWindow->m_children.end(), this );
 				parentWindow->m_children.erase( itor );
 			}
+			parentWindow->_setVisualsDirty();
 		}
 
 		{
@@ -97,6 +108,9 @@ namespace Colibri
 		}
 
 		Renderable::_destroy();
+
+		delete m_spatialGrid;
+		m_spatialGrid = 0;
 	}
 	//-------------------------------------------------------------------------
 	inline bool Window::isArrowBreadthFirstReady( const Widget *arrow ) const
@@ -278,6 +292,7 @@ namespace Colibri
 		m_currentScroll.makeFloor( maxScroll );
 		m_currentScroll.makeCeil( Ogre::Vector2::ZERO );
 		m_nextScroll = m_currentScroll;
+		_setVisualsDirty();
 	}
 	//-------------------------------------------------------------------------
 	void Window::setMaxScroll( const Ogre::Vector2 &maxScroll )
@@ -359,14 +374,16 @@ namespace Colibri
 		{
 			m_currentScroll =
 				Ogre::Math::lerp( m_nextScroll, m_currentScroll, exp2f( -15.0f * timeSinceLast ) );
+			_setVisualsDirty();
 
 			const Ogre::Vector2 &mouseCursorPosNdc = m_manager->getMouseCursorPosNdc();
 			if( this->intersects( mouseCursorPosNdc ) )
 				cursorFocusDirty = true;
 		}
-		else
+		else if( m_currentScroll != m_nextScroll )
 		{
 			m_currentScroll = m_nextScroll;
+			_setVisualsDirty();
 		}
 
 		for( size_t i = 0u; i < Borders::NumBorders; ++i )
@@ -388,6 +405,12 @@ namespace Colibri
 	{
 		const size_t idx = Widget::notifyParentChildIsDestroyed( childWidgetBeingRemoved );
 
+		if( m_spatialGrid )
+			m_spatialGrid->_notifyChildrenChanged();
+
+		if( !childWidgetBeingRemoved->isWindow() )
+			m_removedNavigationWidgets.push_back( childWidgetBeingRemoved );
+
 		// If removing the child at index 0, keep the default as 0 rather than trying to subtract it.
 		if( m_defaultChildWidget >= idx && m_defaultChildWidget != 0 )
 			--m_defaultChildWidget;
@@ -428,6 +451,9 @@ namespace Colibri
 		if( widgetInListDirty )
 		{
 			std::stable_sort( m_childWindows.begin(), m_childWindows.end(), _compareWidgetZOrder );
+			// Indices to our children have changed
+			if( m_spatialGrid )
+				m_spatialGrid->_notifyChildrenChanged();
 		}
 	}
 	//-------------------------------------------------------------------------
@@ -476,7 +502,9 @@ namespace Colibri
 		else
 		{
 			m_childWindows.erase( itor );
+			_setVisualsDirty();
 			window->m_parent = 0;
+			window->m_visualsDirty = true;
 
 			WidgetVec::iterator itWidget =
 				std::find( m_children.begin() + ptrdiff_t( m_numWidgets ), m_children.end(), window );
@@ -557,6 +585,52 @@ namespace Colibri
 		return retVal;
 	}
 	//-------------------------------------------------------------------------
+	void Window::setSpatialIndexEnabled( bool bEnabled )
+	{
+		if( bEnabled == ( m_spatialGrid != 0 ) )
+			return;
+
+		if( bEnabled )
+		{
+			m_spatialGrid = new SpatialGrid( this );
+		}
+		else
+		{
+			delete m_spatialGrid;
+			m_spatialGrid = 0;
+		}
+
+		// Culling must be reevaluated for all children
+		_setVisualsDirty();
+	}
+	//-------------------------------------------------------------------------
+	bool Window::canQueryChildrenAt() const
+	{
+		const Matrix2x3 &identity = Matrix2x3::IDENTITY;
+		return m_spatialGrid &&  //
+			   m_derivedOrientation.m[0][0] == identity.m[0][0] &&
+			   m_derivedOrientation.m[0][1] == identity.m[0][1] &&
+			   m_derivedOrientation.m[0][2] == identity.m[0][2] &&
+			   m_derivedOrientation.m[1][0] == identity.m[1][0] &&
+			   m_derivedOrientation.m[1][1] == identity.m[1][1] &&
+			   m_derivedOrientation.m[1][2] == identity.m[1][2];
+	}
+	//-------------------------------------------------------------------------
+	const std::vector<uint32_t> &Window::queryChildrenAt( const Ogre::Vector2 &posNdc )
+	{
+		COLIBRI_ASSERT_LOW( canQueryChildrenAt() );
+
+		// Inverse of what updateDerivedTransform does to our children. The query
+		// is padded by one unit in canvas space to stay conservative against
+		// floating point error; the caller still tests each child exactly.
+		const Ogre::Vector2 invCanvasSize2x = m_manager->getInvCanvasSize2x();
+		const Ogre::Vector2 localPos =
+			( posNdc - m_derivedTopLeft ) / invCanvasSize2x - m_clipBorderTL + m_currentScroll;
+
+		return m_spatialGrid->query( localPos - Ogre::Vector2::UNIT_SCALE,
+									 localPos + Ogre::Vector2::UNIT_SCALE );
+	}
+	//-------------------------------------------------------------------------
 	void Window::_updateDerivedTransformOnly( const Ogre::Vector2 &parentPos,
 											  const Matrix2x3 &parentRot )
 	{
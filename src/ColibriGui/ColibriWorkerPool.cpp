@@ -0,0 +1,109 @@
+
+#include "ColibriGui/ColibriWorkerPool.h"
+
+#include <limits>
+
+namespace Colibri
+{
+	WorkerPool::Job::~Job() {}
+	//-------------------------------------------------------------------------
+	WorkerPool::~WorkerPool() {}
+	//-------------------------------------------------------------------------
+	//-------------------------------------------------------------------------
+	//-------------------------------------------------------------------------
+	DefaultWorkerPool::DefaultWorkerPool( size_t numThreads ) :
+		m_job( 0 ),
+		m_numJobs( 0u ),
+		m_nextJob( 0u ),
+		m_numJobsPending( 0u ),
+		m_generation( 0u ),
+		m_exit( false )
+	{
+		if( numThreads == std::numeric_limits<size_t>::max() )
+		{
+			const size_t hwThreads = std::thread::hardware_concurrency();
+			numThreads = hwThreads > 1u ? ( hwThreads - 1u ) : 0u;
+		}
+
+		m_threads.reserve( numThreads );
+		for( size_t i = 0u; i < numThreads; ++i )
+			m_threads.push_back( std::thread( &DefaultWorkerPool::workerThread, this ) );
+	}
+	//-------------------------------------------------------------------------
+	DefaultWorkerPool::~DefaultWorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_exit = true;
+		}
+		m_workAvailable.notify_all();
+
+		std::vector<std::thread>::iterator itor = m_threads.begin();
+		std::vector<std::thread>::iterator endt = m_threads.end();
+
+		while( itor != endt )
+		{
+			itor->join();
+			++itor;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DefaultWorkerPool::workerThread()
+	{
+		uint32_t lastGeneration = 0u;
+
+		std::unique_lock<std::mutex> lock( m_mutex );
+		while( true )
+		{
+			while( !m_exit && m_generation == lastGeneration )
+				m_workAvailable.wait( lock );
+
+			if( m_exit )
+				return;
+
+			lastGeneration = m_generation;
+			executeJobs( lock );
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DefaultWorkerPool::executeJobs( std::unique_lock<std::mutex> &lock )
+	{
+		while( m_job && m_nextJob < m_numJobs )
+		{
+			Job *job = m_job;
+			const size_t jobIdx = m_nextJob++;
+
+			lock.unlock();
+			job->execute( jobIdx );
+			lock.lock();
+
+			if( --m_numJobsPending == 0u )
+				m_workFinished.notify_all();
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DefaultWorkerPool::parallelFor( Job *job, size_t numJobs )
+	{
+		if( m_threads.empty() || numJobs <= 1u )
+		{
+			for( size_t i = 0u; i < numJobs; ++i )
+				job->execute( i );
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_job = job;
+		m_numJobs = numJobs;
+		m_nextJob = 0u;
+		m_numJobsPending = numJobs;
+		++m_generation;
+		m_workAvailable.notify_all();
+
+		executeJobs( lock );
+
+		while( m_numJobsPending != 0u )
+			m_workFinished.wait( lock );
+
+		m_job = 0;
+	}
+}  // namespace Colibri
@@ -1,8 +1,10 @@
 
 #include "ColibriGui/Ogre/ColibriOgreRenderable.h"
 #include "ColibriGui/ColibriManager.h"
+#include "ColibriGui/ColibriRenderable.h"
 
 #include "OgreSceneManager.h"
+#include "Vao/OgreIndexBufferPacked.h"
 #include "Vao/OgreVaoManager.h"
 #include "Vao/OgreVertexArrayObject.h"
 
@@ -53,7 +55,7 @@ namespace Ogre
 	{
 	}
 	//-----------------------------------------------------------------------------------
-	/*Ogre::IndexBufferPacked* ColibriOgreRenderable::createIndexBuffer( VaoManager *vaoManager )
+	Ogre::IndexBufferPacked* ColibriOgreRenderable::createIndexBuffer( VaoManager *vaoManager )
 	{
 		//6 indices per quad (3 indices per triangle)
 		//3x3 grid = 9 quads => 6 x 9 indices per widget.
@@ -74,20 +76,20 @@ namespace Ogre
 		//	x-x------x-x
 		//	| |		 | |
 		//	x-x------x-x
-		// maxVerticesPerBuffer = 4096; which means we support up to 4096 widgets per Window.
+		// maxWidgetsPerBuffer = 4096; which means we support up to 4096 widgets per draw.
 		// And this precomputed buffer requires 432kb
-		const size_t verticesPerQuad		= 16u;
-		const size_t maxVerticesPerBuffer	= 65536u / verticesPerQuad;
-		const size_t numIndices = maxVerticesPerBuffer * 6u * 9u;
+		const size_t verticesPerWidget		= 16u;
+		const size_t maxWidgetsPerBuffer	= 65536u / verticesPerWidget;
+		const size_t numIndices = maxWidgetsPerBuffer * 6u * 9u;
 		uint16 *indices = reinterpret_cast<uint16*>( OGRE_MALLOC_SIMD( sizeof(uint16) * numIndices,
 																	   MEMCATEGORY_GEOMETRY ) );
-		for( size_t i=0; i<numIndices; i += (6u * 9u) )
+		for( size_t i=0; i<maxWidgetsPerBuffer; ++i )
 		{
 			//Perform top, then center, then bottom rows
 			for( size_t j=0; j<3u; ++j )
 			{
-				const size_t dstIdx = i + j * 18u;
-				const size_t srcIdx = i + j * 4u;
+				const size_t dstIdx = i * (6u * 9u) + j * 18u;
+				const uint16 srcIdx = static_cast<uint16>( i * verticesPerWidget + j * 4u );
 				//Left column's quad
 				indices[dstIdx +  0u] = srcIdx + 0u;
 				indices[dstIdx +  1u] = srcIdx + 4u;
@@ -127,15 +129,17 @@ namespace Ogre
 		}
 		catch( Exception &e )
 		{
-			OGRE_FREE_SIMD( indexBuffer, MEMCATEGORY_GEOMETRY );
+			OGRE_FREE_SIMD( indices, MEMCATEGORY_GEOMETRY );
 			indexBuffer = 0;
 			throw e;
 		}
 
 		return indexBuffer;
-	}*/
+	}
 	//-----------------------------------------------------------------------------------
-	VertexArrayObject* ColibriOgreRenderable::createVao( uint32 vertexCount, VaoManager *vaoManager )
+	VertexArrayObject* ColibriOgreRenderable::createVao( uint32 vertexCount,
+														 IndexBufferPacked *indexBuffer,
+														 VaoManager *vaoManager )
 	{
 		//Vertex declaration
 		VertexElement2Vec vertexElements;
@@ -151,6 +155,66 @@ namespace Ogre
 													   BT_DYNAMIC_PERSISTENT,
 													   0, false );
 
+		VertexBufferPackedVec vertexBuffers;
+		vertexBuffers.push_back( vertexBuffer );
+		Ogre::VertexArrayObject *vao = vaoManager->createVertexArrayObject(
+					vertexBuffers, indexBuffer, OT_TRIANGLE_LIST );
+
+		return vao;
+	}
+	//-----------------------------------------------------------------------------------
+	VertexArrayObject* ColibriOgreRenderable::createUnindexedVao( VertexArrayObject *vao,
+																  VaoManager *vaoManager )
+	{
+		return vaoManager->createVertexArrayObject( vao->getVertexBuffers(), 0, OT_TRIANGLE_LIST );
+	}
+	//-----------------------------------------------------------------------------------
+	VertexArrayObject* ColibriOgreRenderable::createInstancedVao( VaoManager *vaoManager )
+	{
+		//Must match createVao's declaration, so the PSO's input layout is the same
+		VertexElement2Vec vertexElements;
+		vertexElements.reserve( 4 );
+		vertexElements.push_back( VertexElement2( VET_FLOAT2, VES_POSITION ) );
+		vertexElements.push_back( VertexElement2( VET_USHORT2_NORM, VES_TEXTURE_COORDINATES ) );
+		vertexElements.push_back( VertexElement2( VET_UBYTE4_NORM, VES_DIFFUSE ) );
+		vertexElements.push_back( VertexElement2( VET_FLOAT4, VES_NORMAL ) );
+
+		const size_t numVertices = 6u * 9u;
+		Colibri::UiVertex *vertices = reinterpret_cast<Colibri::UiVertex*>(
+										  OGRE_MALLOC_SIMD( sizeof(Colibri::UiVertex) * numVertices,
+															MEMCATEGORY_GEOMETRY ) );
+		memset( vertices, 0, sizeof(Colibri::UiVertex) * numVertices );
+
+		//Same order as Renderable::addQuad: one quad per cell, row by row
+		const float quadCorners[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 1 }, { 1, 0 }, { 0, 0 } };
+		Colibri::UiVertex *vertex = vertices;
+		for( size_t y=0; y<3u; ++y )
+		{
+			for( size_t x=0; x<3u; ++x )
+			{
+				for( size_t i=0; i<6u; ++i )
+				{
+					vertex->x = static_cast<float>( x ) + quadCorners[i][0];
+					vertex->y = static_cast<float>( y ) + quadCorners[i][1];
+					++vertex;
+				}
+			}
+		}
+
+		Ogre::VertexBufferPacked *vertexBuffer = 0;
+
+		try
+		{
+			vertexBuffer = vaoManager->createVertexBuffer( vertexElements, numVertices,
+														   BT_IMMUTABLE, vertices, true );
+		}
+		catch( Exception &e )
+		{
+			OGRE_FREE_SIMD( vertices, MEMCATEGORY_GEOMETRY );
+			vertexBuffer = 0;
+			throw e;
+		}
+
 		VertexBufferPackedVec vertexBuffers;
 		vertexBuffers.push_back( vertexBuffer );
 		Ogre::VertexArrayObject *vao = vaoManager->createVertexArrayObject(
@@ -163,11 +227,14 @@ namespace Ogre
 	{
 		//Vertex declaration
 		VertexElement2Vec vertexElements;
-		vertexElements.reserve( 5 );
+		vertexElements.reserve( 7 );
 		vertexElements.push_back( VertexElement2( VET_FLOAT2, VES_POSITION ) );
 		vertexElements.push_back( VertexElement2( VET_USHORT2, VES_BLEND_INDICES ) );
 		vertexElements.push_back( VertexElement2( VET_UINT1, VES_TANGENT ) );
 		vertexElements.push_back( VertexElement2( VET_UBYTE4_NORM, VES_DIFFUSE ) );
+		//Shadow colour & offset. See GlyphVertex
+		vertexElements.push_back( VertexElement2( VET_UBYTE4_NORM, VES_SPECULAR ) );
+		vertexElements.push_back( VertexElement2( VET_HALF2, VES_BINORMAL ) );
 		vertexElements.push_back( VertexElement2( VET_FLOAT4, VES_NORMAL ) );
 
 		//Create the actual vertex buffer.
@@ -204,6 +271,11 @@ namespace Ogre
 		vaoManager->destroyVertexArrayObject( vao );
 	}
 	//-----------------------------------------------------------------------------------
+	void ColibriOgreRenderable::destroySharedVao( VertexArrayObject *vao, VaoManager *vaoManager )
+	{
+		vaoManager->destroyVertexArrayObject( vao );
+	}
+	//-----------------------------------------------------------------------------------
 	void ColibriOgreRenderable::setVao( VertexArrayObject *vao )
 	{
 		mVaoPerLod[0].clear();
@@ -212,6 +284,23 @@ namespace Ogre
 		mVaoPerLod[1].push_back( vao );
 	}
 	//-----------------------------------------------------------------------------------
+	void ColibriOgreRenderable::setInstanced( bool bInstanced )
+	{
+		const bool wasInstanced = hasCustomParameter( 6375 );
+		if( wasInstanced == bInstanced )
+			return;
+
+		//We use this magic value 6375, to indicate this widget is rendered
+		//via UiInstance records. See HlmsColibri
+		if( bInstanced )
+			setCustomParameter( 6375, Ogre::Vector4( 1.0f ) );
+		else
+			removeCustomParameter( 6375 );
+
+		if( mHlmsDatablock )
+			setDatablock( mHlmsDatablock );
+	}
+	//-----------------------------------------------------------------------------------
 	const String& ColibriOgreRenderable::getMovableType(void) const
 	{
 		return BLANKSTRING;
@@ -39,6 +39,10 @@ namespace Ogre
 	//-----------------------------------------------------------------------------------
 	void CompositorPassColibriGui::execute( const Camera *lodCamera )
 	{
+		//Nothing changed since last time, and the target still holds the last image
+		if( mDefinition->mSkipWhenClean && !m_colibriManager->needsRedraw() )
+			return;
+
 		//Execute a limited number of times?
 		if( mNumPassesLeft != std::numeric_limits<uint32>::max() )
 		{
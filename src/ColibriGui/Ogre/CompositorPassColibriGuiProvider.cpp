@@ -103,6 +103,16 @@ namespace Ogre
 							" line " + StringConverter::toString( prop->line ) );
 					}
 				}
+				else if( prop->name == "skip_when_clean" )
+				{
+					if( prop->values.size() != 1u ||
+						!ScriptTranslatorGetBoolean( prop->values.front(),
+													 &colibriGuiDef->mSkipWhenClean ) )
+					{
+						compiler->addError( ScriptCompiler::CE_BOOLEANEXPECTED, obj->file, obj->line,
+											"skip_when_clean accepts <true|false>" );
+					}
+				}
 				else if( prop->name == "aspect_ratio_mode" )
 				{
 					bool bValid = false;
@@ -72,18 +72,26 @@ namespace Ogre
 
 	HlmsColibri::HlmsColibri( Archive *dataFolder, ArchiveVec *libraryFolders ) :
 		HlmsUnlit( dataFolder, libraryFolders ),
-		mGlyphAtlasBuffer( 0 )
+		mInstanceBuffer( 0 ),
+		mGlyphSdf( false )
 	{
-		mTexUnitSlotStart = 3u;
-		mSamplerUnitSlotStart = 3u;
+		memset( mGlyphAtlasBuffers, 0, sizeof( mGlyphAtlasBuffers ) );
+		// Slots 2, 4, 5 & 6 are the glyph atlas pages (pixel shader),
+		// slot 3 the instance buffer (vertex shader)
+		mTexUnitSlotStart = 7u;
+		mSamplerUnitSlotStart = 7u;
     }
 	HlmsColibri::HlmsColibri( Archive *dataFolder, ArchiveVec *libraryFolders,
 							  HlmsTypes type, const String &typeName ) :
 		HlmsUnlit( dataFolder, libraryFolders, type, typeName ),
-		mGlyphAtlasBuffer( 0 )
+		mInstanceBuffer( 0 ),
+		mGlyphSdf( false )
 	{
-		mTexUnitSlotStart = 3u;
-		mSamplerUnitSlotStart = 3u;
+		memset( mGlyphAtlasBuffers, 0, sizeof( mGlyphAtlasBuffers ) );
+		// Slots 2, 4, 5 & 6 are the glyph atlas pages (pixel shader),
+		// slot 3 the instance buffer (vertex shader)
+		mTexUnitSlotStart = 7u;
+		mSamplerUnitSlotStart = 7u;
     }
     //-----------------------------------------------------------------------------------
 	HlmsColibri::~HlmsColibri()
@@ -99,14 +107,31 @@ namespace Ogre
 		{
 			DescBindingRange *descBindingRanges = rootLayout.mDescBindingRanges[0];
 
+			const uint16 lastSlot = getGlyphAtlasSlot( MaxGlyphAtlasPages - 1u );
+
+			if( getProperty( "use_read_only_buffer" ) )
+			{
+				descBindingRanges[DescBindingTypes::ReadOnlyBuffer].end = lastSlot + 1u;
+			}
+			else
+			{
+				descBindingRanges[DescBindingTypes::TexBuffer].start = getGlyphAtlasSlot( 0u );
+				descBindingRanges[DescBindingTypes::TexBuffer].end = lastSlot + 1u;
+			}
+		}
+
+		if( getProperty( "colibri_instanced" ) )
+		{
+			DescBindingRange *descBindingRanges = rootLayout.mDescBindingRanges[0];
+
 			if( getProperty( "use_read_only_buffer" ) )
 			{
-				descBindingRanges[DescBindingTypes::ReadOnlyBuffer].end = 3u;
+				descBindingRanges[DescBindingTypes::ReadOnlyBuffer].end = 4u;
 			}
 			else
 			{
-				descBindingRanges[DescBindingTypes::TexBuffer].start = 2u;
-				descBindingRanges[DescBindingTypes::TexBuffer].end = 3u;
+				descBindingRanges[DescBindingTypes::TexBuffer].start = 3u;
+				descBindingRanges[DescBindingTypes::TexBuffer].end = 4u;
 			}
 		}
 	}
@@ -126,10 +151,20 @@ namespace Ogre
 		if( getProperty( "colibri_text" ) )
 		{
 			GpuProgramParametersSharedPtr psParams = retVal->pso.pixelShader->getDefaultParameters();
-			psParams->setNamedConstant( "glyphAtlas", 2 );
+			psParams->setNamedConstant( "glyphAtlas", getGlyphAtlasSlot( 0u ) );
+			psParams->setNamedConstant( "glyphAtlas1", getGlyphAtlasSlot( 1u ) );
+			psParams->setNamedConstant( "glyphAtlas2", getGlyphAtlasSlot( 2u ) );
+			psParams->setNamedConstant( "glyphAtlas3", getGlyphAtlasSlot( 3u ) );
 			mRenderSystem->bindGpuProgramParameters( GPT_FRAGMENT_PROGRAM, psParams, GPV_ALL );
 		}
 
+		if( getProperty( "colibri_instanced" ) )
+		{
+			GpuProgramParametersSharedPtr vsParams = retVal->pso.vertexShader->getDefaultParameters();
+			vsParams->setNamedConstant( "colibriInstances", 3 );
+			mRenderSystem->bindGpuProgramParameters( GPT_VERTEX_PROGRAM, vsParams, GPV_ALL );
+		}
+
 		return retVal;
 	}
 	//-----------------------------------------------------------------------------------
@@ -151,11 +186,29 @@ namespace Ogre
 										   OGRE_VERSION_PATCH ) );
 		}
 
+		// See Colibri::LabelBmp
+		if( customParams.find( 6374 ) != customParams.end() )
+			setProperty( "colibri_unindexed", 1 );
+
+		// See Colibri::ColibriManager::setInstancedWidgets. Text & LabelBmp are never instanced
+		if( customParams.find( 6375 ) != customParams.end() &&
+			customParams.find( 6374 ) == customParams.end() &&
+			customParams.find( 6373 ) == customParams.end() )
+		{
+			setProperty( "colibri_instanced", 1 );
+
+			if( needsReadOnlyBuffer( mRenderSystem->getCapabilities(), mRenderSystem->getVaoManager() ) )
+				setProperty( "use_read_only_buffer", 1 );
+		}
+
 		// See Colibri::Label
 		if( customParams.find( 6373 ) != customParams.end() )
 		{
 			setProperty( "colibri_text", 1 );
 
+			if( mGlyphSdf )
+				setProperty( "colibri_text_sdf", 1 );
+
 			setProperty( "ogre_version", ( OGRE_VERSION_MAJOR * 1000000 + OGRE_VERSION_MINOR * 1000 +
 										   OGRE_VERSION_PATCH ) );
 
@@ -164,9 +217,25 @@ namespace Ogre
 		}
 	}
 	//-----------------------------------------------------------------------------------
-	void HlmsColibri::setGlyphAtlasBuffer( BufferPacked *texBuffer )
+	void HlmsColibri::setGlyphAtlasBuffer( size_t pageIdx, BufferPacked *texBuffer )
+	{
+		assert( pageIdx < MaxGlyphAtlasPages );
+		mGlyphAtlasBuffers[pageIdx] = texBuffer;
+	}
+	//-----------------------------------------------------------------------------------
+	void HlmsColibri::setGlyphSdf( bool bSdf )
 	{
-		mGlyphAtlasBuffer = texBuffer;
+		mGlyphSdf = bSdf;
+	}
+	//-----------------------------------------------------------------------------------
+	uint16 HlmsColibri::getGlyphAtlasSlot( size_t pageIdx )
+	{
+		return static_cast<uint16>( pageIdx == 0u ? 2u : ( 3u + pageIdx ) );
+	}
+	//-----------------------------------------------------------------------------------
+	void HlmsColibri::setInstanceBuffer( BufferPacked *texBuffer )
+	{
+		mInstanceBuffer = texBuffer;
 	}
 	//-----------------------------------------------------------------------------------
 	bool HlmsColibri::needsReadOnlyBuffer( const RenderSystemCapabilities *caps,
@@ -229,21 +298,47 @@ namespace Ogre
                         CbShaderBuffer( PixelShader, 2, mConstBuffers[mCurrentConstBuffer], 0, 0 );
             }
 
-			//layout(binding = 3) uniform samplerBuffer glyphAtlas
-			if( mGlyphAtlasBuffer )
+			//layout(binding = 2, 4, 5, 6) uniform samplerBuffer glyphAtlas
+			//Pages not in use get the 1st page bound so the shader always reads valid memory
+			if( mGlyphAtlasBuffers[0] )
+			{
+				for( size_t i = 0u; i < MaxGlyphAtlasPages; ++i )
+				{
+					BufferPacked *glyphAtlasBuffer =
+						mGlyphAtlasBuffers[i] ? mGlyphAtlasBuffers[i] : mGlyphAtlasBuffers[0];
+					const uint16 slot = getGlyphAtlasSlot( i );
+#if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
+					if( glyphAtlasBuffer->getBufferPackedType() != Ogre::BP_TYPE_TEX )
+					{
+						*commandBuffer->addCommand<CbShaderBuffer>() = CbShaderBuffer(
+							PixelShader, slot,
+							static_cast<Ogre::ReadOnlyBufferPacked *>( glyphAtlasBuffer ), 0, 0 );
+					}
+					else
+#endif
+					{
+						*commandBuffer->addCommand<CbShaderBuffer>() = CbShaderBuffer(
+							PixelShader, slot, static_cast<Ogre::TexBufferPacked *>( glyphAtlasBuffer ),
+							0, 0 );
+					}
+				}
+			}
+
+			//layout(binding = 3) uniform samplerBuffer colibriInstances
+			if( mInstanceBuffer )
 			{
 #if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
-				if( mGlyphAtlasBuffer->getBufferPackedType() != Ogre::BP_TYPE_TEX )
+				if( mInstanceBuffer->getBufferPackedType() != Ogre::BP_TYPE_TEX )
 				{
 					*commandBuffer->addCommand<CbShaderBuffer>() = CbShaderBuffer(
-						PixelShader, 2, static_cast<Ogre::ReadOnlyBufferPacked *>( mGlyphAtlasBuffer ),
+						VertexShader, 3, static_cast<Ogre::ReadOnlyBufferPacked *>( mInstanceBuffer ),
 						0, 0 );
 				}
 				else
 #endif
 				{
 					*commandBuffer->addCommand<CbShaderBuffer>() = CbShaderBuffer(
-						PixelShader, 2, static_cast<Ogre::TexBufferPacked *>( mGlyphAtlasBuffer ), 0,
+						VertexShader, 3, static_cast<Ogre::TexBufferPacked *>( mInstanceBuffer ), 0,
 						0 );
 				}
 			}
@@ -0,0 +1,113 @@
+
+#include "ColibriGui/Text/ColibriAtlasAllocator.h"
+
+namespace Colibri
+{
+	AtlasAllocator::AtlasAllocator( size_t reservedBytes ) :
+		m_freeBytes( 0u ),
+		m_offsetPtr( reservedBytes ),
+		m_capacity( 0u )
+	{
+	}
+	//-------------------------------------------------------------------------
+	void AtlasAllocator::addFreeBlock( size_t offset, size_t sizeBytes )
+	{
+		m_freeByOffset[offset] = sizeBytes;
+		m_freeBySize.insert( std::pair<size_t, size_t>( sizeBytes, offset ) );
+		m_freeBytes += sizeBytes;
+	}
+	//-------------------------------------------------------------------------
+	void AtlasAllocator::removeFreeBlock( FreeBlockMap::iterator itor )
+	{
+		m_freeBySize.erase( std::pair<size_t, size_t>( itor->second, itor->first ) );
+		m_freeBytes -= itor->second;
+		m_freeByOffset.erase( itor );
+	}
+	//-------------------------------------------------------------------------
+	bool AtlasAllocator::allocate( size_t sizeBytes, size_t &outOffset )
+	{
+		if( sizeBytes == 0u )
+		{
+			outOffset = 0u;
+			return true;
+		}
+
+		// Smallest free block that can hold it (ties go to the lowest offset)
+		FreeBlockSet::const_iterator bestFit =
+			m_freeBySize.lower_bound( std::pair<size_t, size_t>( sizeBytes, 0u ) );
+
+		if( bestFit != m_freeBySize.end() )
+		{
+			const size_t blockOffset = bestFit->second;
+			const size_t blockSize = bestFit->first;
+
+			removeFreeBlock( m_freeByOffset.find( blockOffset ) );
+			if( blockSize > sizeBytes )
+				addFreeBlock( blockOffset + sizeBytes, blockSize - sizeBytes );
+
+			outOffset = blockOffset;
+			return true;
+		}
+
+		if( m_offsetPtr + sizeBytes <= m_capacity )
+		{
+			outOffset = m_offsetPtr;
+			m_offsetPtr += sizeBytes;
+			return true;
+		}
+
+		return false;
+	}
+	//-------------------------------------------------------------------------
+	void AtlasAllocator::deallocate( size_t offset, size_t sizeBytes )
+	{
+		if( sizeBytes == 0u )
+			return;
+
+		COLIBRI_ASSERT_LOW( offset + sizeBytes <= m_offsetPtr );
+
+		// Merge with the free block after us
+		FreeBlockMap::iterator next = m_freeByOffset.lower_bound( offset );
+		COLIBRI_ASSERT_MEDIUM( ( next == m_freeByOffset.end() || next->first >= offset + sizeBytes ) &&
+							   "Double free or overlapping blocks" );
+		if( next != m_freeByOffset.end() && next->first == offset + sizeBytes )
+		{
+			sizeBytes += next->second;
+			FreeBlockMap::iterator toRemove = next++;
+			removeFreeBlock( toRemove );
+		}
+
+		// Merge with the free block before us
+		if( next != m_freeByOffset.begin() )
+		{
+			FreeBlockMap::iterator prev = next;
+			--prev;
+			COLIBRI_ASSERT_MEDIUM( prev->first + prev->second <= offset &&
+								   "Double free or overlapping blocks" );
+			if( prev->first + prev->second == offset )
+			{
+				offset = prev->first;
+				sizeBytes += prev->second;
+				removeFreeBlock( prev );
+			}
+		}
+
+		if( offset + sizeBytes == m_offsetPtr )
+			m_offsetPtr = offset;  // Give it back to the end of the used region
+		else
+			addFreeBlock( offset, sizeBytes );
+	}
+	//-------------------------------------------------------------------------
+	bool AtlasAllocator::canAllocate( size_t sizeBytes ) const
+	{
+		return sizeBytes == 0u || m_offsetPtr + sizeBytes <= m_capacity ||
+			   m_freeBySize.lower_bound( std::pair<size_t, size_t>( sizeBytes, 0u ) ) !=
+				   m_freeBySize.end();
+	}
+	//-------------------------------------------------------------------------
+	void AtlasAllocator::setCapacity( size_t capacity )
+	{
+		COLIBRI_ASSERT_LOW( capacity >= m_capacity );
+		m_capacity = capacity;
+	}
+}  // namespace Colibri
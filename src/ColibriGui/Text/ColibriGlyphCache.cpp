@@ -0,0 +1,217 @@
+
+#include "ColibriGui/Text/ColibriGlyphCache.h"
+
+namespace Colibri
+{
+	/// Number of glyphs allocated at once
+	static const size_t c_glyphsPerBlock = 256u;
+	/// Initial number of slots in the hash table. Must be a power of 2
+	static const size_t c_initialCapacity = 256u;
+
+	GlyphCache::GlyphCache() :
+		m_numGlyphs( 0u ),
+		m_freeSlots( 0 ),
+		m_lruFirst( 0 ),
+		m_lruLast( 0 ),
+		m_numUnreferenced( 0u )
+	{
+		m_table.resize( c_initialCapacity, 0 );
+	}
+	//-------------------------------------------------------------------------
+	GlyphCache::~GlyphCache()
+	{
+		std::vector<CachedGlyph *>::const_iterator itor = m_blocks.begin();
+		std::vector<CachedGlyph *>::const_iterator endt = m_blocks.end();
+
+		while( itor != endt )
+			delete[] *itor++;
+
+		m_blocks.clear();
+	}
+	//-------------------------------------------------------------------------
+	inline size_t GlyphCache::hash( uint32_t codepoint, uint32_t ptSize, uint32_t font )
+	{
+		// ptSize is 26.6 fixed point and font is small, thus they fit together in 32 bits
+		// in practice. Collisions in the upper bits are harmless anyway.
+		uint64_t key = ( uint64_t( codepoint ) << 32u ) | ( ptSize ^ ( font << 24u ) );
+		// Finalizer of MurmurHash3
+		key ^= key >> 33u;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33u;
+		key *= 0xc4ceb9fe1a85ec53ULL;
+		key ^= key >> 33u;
+		return static_cast<size_t>( key );
+	}
+	//-------------------------------------------------------------------------
+	inline size_t GlyphCache::findSlot( uint32_t codepoint, uint32_t ptSize, uint32_t font ) const
+	{
+		const size_t mask = m_table.size() - 1u;
+		size_t slot = hash( codepoint, ptSize, font ) & mask;
+
+		// The table is never full, thus this always ends
+		while( true )
+		{
+			const CachedGlyph *glyph = m_table[slot];
+			if( !glyph || ( glyph->codepoint == codepoint && glyph->ptSize == ptSize &&
+							glyph->font == font ) )
+			{
+				return slot;
+			}
+			slot = ( slot + 1u ) & mask;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void GlyphCache::rehash( size_t newCapacity )
+	{
+		COLIBRI_ASSERT_LOW( ( newCapacity & ( newCapacity - 1u ) ) == 0u && newCapacity > m_numGlyphs );
+
+		std::vector<CachedGlyph *> oldTable;
+		oldTable.swap( m_table );
+		m_table.resize( newCapacity, 0 );
+
+		std::vector<CachedGlyph *>::const_iterator itor = oldTable.begin();
+		std::vector<CachedGlyph *>::const_iterator endt = oldTable.end();
+
+		while( itor != endt )
+		{
+			CachedGlyph *glyph = *itor;
+			if( glyph )
+				m_table[findSlot( glyph->codepoint, glyph->ptSize, glyph->font )] = glyph;
+			++itor;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void GlyphCache::lruPushBack( CachedGlyph *glyph )
+	{
+		glyph->lruPrev = m_lruLast;
+		glyph->lruNext = 0;
+		if( m_lruLast )
+			m_lruLast->lruNext = glyph;
+		else
+			m_lruFirst = glyph;
+		m_lruLast = glyph;
+		++m_numUnreferenced;
+	}
+	//-------------------------------------------------------------------------
+	void GlyphCache::lruRemove( CachedGlyph *glyph )
+	{
+		if( glyph->lruPrev )
+			glyph->lruPrev->lruNext = glyph->lruNext;
+		else
+			m_lruFirst = glyph->lruNext;
+
+		if( glyph->lruNext )
+			glyph->lruNext->lruPrev = glyph->lruPrev;
+		else
+			m_lruLast = glyph->lruPrev;
+
+		glyph->lruPrev = 0;
+		glyph->lruNext = 0;
+		--m_numUnreferenced;
+	}
+	//-------------------------------------------------------------------------
+	CachedGlyph *GlyphCache::find( uint32_t codepoint, uint32_t ptSize, uint32_t font ) const
+	{
+		return m_table[findSlot( codepoint, ptSize, font )];
+	}
+	//-------------------------------------------------------------------------
+	void GlyphCache::getAllGlyphs( std::vector<const CachedGlyph *> &outGlyphs ) const
+	{
+		outGlyphs.reserve( outGlyphs.size() + m_numGlyphs );
+
+		std::vector<CachedGlyph *>::const_iterator itor = m_table.begin();
+		std::vector<CachedGlyph *>::const_iterator endt = m_table.end();
+
+		while( itor != endt )
+		{
+			if( *itor )
+				outGlyphs.push_back( *itor );
+			++itor;
+		}
+	}
+	//-------------------------------------------------------------------------
+	CachedGlyph *GlyphCache::insert( const CachedGlyph &glyph )
+	{
+		COLIBRI_ASSERT_LOW( glyph.refCount == 0u );
+		COLIBRI_ASSERT_MEDIUM( !find( glyph.codepoint, glyph.ptSize, glyph.font ) &&
+							   "Glyph already in cache" );
+
+		// Keep the load factor below 3/4
+		if( ( m_numGlyphs + 1u ) * 4u > m_table.size() * 3u )
+			rehash( m_table.size() << 1u );
+
+		if( !m_freeSlots )
+		{
+			CachedGlyph *block = new CachedGlyph[c_glyphsPerBlock];
+			m_blocks.push_back( block );
+			for( size_t i = 0u; i < c_glyphsPerBlock; ++i )
+			{
+				block[i].lruNext = m_freeSlots;
+				m_freeSlots = &block[i];
+			}
+		}
+
+		CachedGlyph *newGlyph = m_freeSlots;
+		m_freeSlots = newGlyph->lruNext;
+
+		*newGlyph = glyph;
+		lruPushBack( newGlyph );
+
+		m_table[findSlot( glyph.codepoint, glyph.ptSize, glyph.font )] = newGlyph;
+		++m_numGlyphs;
+
+		return newGlyph;
+	}
+	//-------------------------------------------------------------------------
+	void GlyphCache::erase( CachedGlyph *glyph )
+	{
+		const size_t mask = m_table.size() - 1u;
+		size_t emptySlot = findSlot( glyph->codepoint, glyph->ptSize, glyph->font );
+		COLIBRI_ASSERT_LOW( m_table[emptySlot] == glyph && "Glyph not in cache" );
+
+		// Backward shift deletion: move back the glyphs after the removed one that
+		// would no longer be reachable from their ideal slot.
+		size_t slot = emptySlot;
+		while( true )
+		{
+			slot = ( slot + 1u ) & mask;
+			CachedGlyph *other = m_table[slot];
+			if( !other )
+				break;
+
+			const size_t idealSlot = hash( other->codepoint, other->ptSize, other->font ) & mask;
+			// Distance from the ideal slot, taking wrap around into account
+			if( ( ( slot - idealSlot ) & mask ) >= ( ( slot - emptySlot ) & mask ) )
+			{
+				m_table[emptySlot] = other;
+				emptySlot = slot;
+			}
+		}
+		m_table[emptySlot] = 0;
+		--m_numGlyphs;
+
+		if( glyph->refCount == 0u )
+			lruRemove( glyph );
+
+		glyph->lruNext = m_freeSlots;
+		m_freeSlots = glyph;
+	}
+	//-------------------------------------------------------------------------
+	void GlyphCache::addRef( CachedGlyph *glyph )
+	{
+		if( glyph->refCount == 0u )
+			lruRemove( glyph );
+		++glyph->refCount;
+	}
+	//-------------------------------------------------------------------------
+	void GlyphCache::release( CachedGlyph *glyph )
+	{
+		COLIBRI_ASSERT_LOW( glyph->refCount > 0u );
+		if( glyph->refCount > 0u )
+		{
+			--glyph->refCount;
+			if( glyph->refCount == 0u )
+				lruPushBack( glyph );
+		}
+	}
+}  // namespace Colibri
@@ -0,0 +1,123 @@
+
+#include "ColibriGui/Text/ColibriGlyphSdf.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Colibri
+{
+	static const float c_sdfInfinity = 1e20f;
+
+	void GlyphSdf::edt1d( float *grid, size_t offset, size_t stride, size_t length )
+	{
+		float *f = &m_f[0];
+		float *z = &m_z[0];
+		uint32_t *v = &m_v[0];
+
+		for( size_t q = 0u; q < length; ++q )
+			f[q] = grid[offset + q * stride];
+
+		// Lower envelope of the parabolas rooted at each sample
+		size_t k = 0u;
+		v[0] = 0u;
+		z[0] = -c_sdfInfinity;
+		z[1] = c_sdfInfinity;
+
+		for( size_t q = 1u; q < length; ++q )
+		{
+			const float fq = f[q] + float( q * q );
+			size_t r = v[k];
+			float s = ( fq - f[r] - float( r * r ) ) / ( 2.0f * float( q - r ) );
+			while( s <= z[k] )
+			{
+				--k;
+				r = v[k];
+				s = ( fq - f[r] - float( r * r ) ) / ( 2.0f * float( q - r ) );
+			}
+
+			++k;
+			v[k] = static_cast<uint32_t>( q );
+			z[k] = s;
+			z[k + 1u] = c_sdfInfinity;
+		}
+
+		k = 0u;
+		for( size_t q = 0u; q < length; ++q )
+		{
+			while( z[k + 1u] < float( q ) )
+				++k;
+			const size_t r = v[k];
+			const float dist = float( q ) - float( r );
+			grid[offset + q * stride] = dist * dist + f[r];
+		}
+	}
+	//-------------------------------------------------------------------------
+	void GlyphSdf::edt( std::vector<float> &grid, size_t width, size_t height )
+	{
+		float *data = &grid[0];
+		for( size_t x = 0u; x < width; ++x )
+			edt1d( data, x, width, height );
+		for( size_t y = 0u; y < height; ++y )
+			edt1d( data, y * width, 1u, width );
+	}
+	//-------------------------------------------------------------------------
+	void GlyphSdf::generate( const uint8_t *colibri_nullable coverage, size_t width, size_t height,
+							 int32_t pitch, size_t spread, std::vector<uint8_t> &outSdf )
+	{
+		const size_t sdfWidth = width + spread * 2u;
+		const size_t sdfHeight = height + spread * 2u;
+		const size_t numPixels = sdfWidth * sdfHeight;
+
+		outSdf.resize( numPixels );
+		if( numPixels == 0u )
+			return;
+
+		// The padding is outside the glyph
+		m_gridOuter.clear();
+		m_gridInner.clear();
+		m_gridOuter.resize( numPixels, c_sdfInfinity );
+		m_gridInner.resize( numPixels, 0.0f );
+
+		for( size_t y = 0u; y < height; ++y )
+		{
+			const uint8_t *row = coverage + int32_t( y ) * pitch;
+			for( size_t x = 0u; x < width; ++x )
+			{
+				const float alpha = row[x] / 255.0f;
+				if( alpha == 0.0f )
+					continue;
+
+				const size_t idx = ( y + spread ) * sdfWidth + x + spread;
+				if( alpha == 1.0f )
+				{
+					m_gridOuter[idx] = 0.0f;
+					m_gridInner[idx] = c_sdfInfinity;
+				}
+				else
+				{
+					// Partially covered pixels estimate where the edge is within them
+					const float d = 0.5f - alpha;
+					m_gridOuter[idx] = d > 0.0f ? d * d : 0.0f;
+					m_gridInner[idx] = d < 0.0f ? d * d : 0.0f;
+				}
+			}
+		}
+
+		const size_t maxDim = std::max( sdfWidth, sdfHeight );
+		m_f.resize( maxDim );
+		m_z.resize( maxDim + 1u );
+		m_v.resize( maxDim );
+
+		edt( m_gridOuter, sdfWidth, sdfHeight );
+		edt( m_gridInner, sdfWidth, sdfHeight );
+
+		const float invRange = spread > 0u ? 0.5f / float( spread ) : 0.5f;
+		for( size_t i = 0u; i < numPixels; ++i )
+		{
+			// Positive inside
+			const float dist = std::sqrt( m_gridInner[i] ) - std::sqrt( m_gridOuter[i] );
+			const float value = std::min( std::max( 0.5f + dist * invRange, 0.0f ), 1.0f );
+			outSdf[i] = static_cast<uint8_t>( value * 255.0f + 0.5f );
+		}
+	}
+}  // namespace Colibri
@@ -7,6 +7,9 @@
 
 #include "OgreLwString.h"
 
+#include "sds/sds_fstream.h"
+#include "sds/sds_fstreamApk.h"
+
 #include "ft2build.h"
 #include "freetype/freetype.h"
 
@@ -66,7 +69,10 @@ namespace Colibri
 		m_shaperManager( shaperManager ),
 		m_ptSize( 0u ),
 		m_fontIdx(
-			std::max<uint16_t>( static_cast<uint16_t>( shaperManager->getShapers().size() ), 1u ) )
+			std::max<uint16_t>( static_cast<uint16_t>( shaperManager->getShapers().size() ), 1u ) ),
+		m_fontLocation( fontLocation ),
+		m_fontFileHash( 0u ),
+		m_fontFileHashCalculated( false )
 	{
 #ifndef __ANDROID__
 		FT_Error errorCode = FT_New_Face( m_library, fontLocation, 0, &m_ftFont );
@@ -143,11 +149,13 @@ namespace Colibri
 	void Shaper::setFeatures( const std::vector<hb_feature_t> &features )
 	{
 		m_features = features;
+		m_shaperManager->clearShapingCache();
 	}
 	//-------------------------------------------------------------------------
 	void Shaper::addFeatures( const hb_feature_t &feature )
 	{
 		m_features.push_back( feature );
+		m_shaperManager->clearShapingCache();
 	}
 	//-------------------------------------------------------------------------
 	void Shaper::setFontSize( FontSize ptSize )
@@ -185,6 +193,40 @@ namespace Colibri
 		return m_ptSize;
 	}
 	//-------------------------------------------------------------------------
+	uint64_t Shaper::getFontFileHash()
+	{
+		if( !m_fontFileHashCalculated )
+		{
+			m_fontFileHashCalculated = true;
+
+			sds::PackageFstream fontFile( m_fontLocation.c_str(), sds::fstream::InputEnd );
+			if( !fontFile.is_open() )
+				return m_fontFileHash;
+
+			const size_t fileSize = fontFile.getFileSize( false );
+			if( fileSize == 0u )
+				return m_fontFileHash;
+			fontFile.seek( 0, sds::fstream::beg );
+
+			std::vector<char> fileData;
+			fileData.resize( fileSize );
+			fontFile.read( &fileData[0], fileSize );
+
+			// FNV-1a
+			uint64_t hash = 0xcbf29ce484222325ULL;
+			for( size_t i = 0u; i < fileSize; ++i )
+			{
+				hash ^= static_cast<uint8_t>( fileData[i] );
+				hash *= 0x100000001b3ULL;
+			}
+
+			// 0 is reserved for "couldn't be read"
+			m_fontFileHash = hash != 0u ? hash : 1u;
+		}
+
+		return m_fontFileHash;
+	}
+	//-------------------------------------------------------------------------
 	size_t Shaper::renderWithSubstituteFont( const uint16_t *utf16Str, size_t stringLength,
 											 hb_direction_t dir, uint32_t richTextIdx,
 											 uint32_t clusterOffset, ShapedGlyphVec &outShapes,
@@ -412,6 +454,8 @@ namespace Colibri
 				shapedGlyph.isPrivateArea = bIsPrivateArea;
 				shapedGlyph.richTextIdx = richTextIdx;
 				shapedGlyph.glyph = glyph;
+				shapedGlyph.glyphScale =
+					float( m_ptSize.value26d6 ) / float( std::max( glyph->ptSize, 1u ) );
 				shapesVec.push_back( shapedGlyph );
 			}
 		}
@@ -2,6 +2,7 @@
 #include "ColibriGui/Text/ColibriShaperManager.h"
 
 #include "ColibriGui/ColibriManager.h"
+#include "ColibriGui/ColibriWorkerPool.h"
 #include "ColibriGui/Text/ColibriBmpFont.h"
 #include "ColibriGui/Text/ColibriShaper.h"
 
@@ -10,6 +11,7 @@
 #if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
 #	include "Vao/OgreReadOnlyBufferPacked.h"
 #endif
+#include "Vao/OgreStagingBuffer.h"
 #include "Vao/OgreTexBufferPacked.h"
 #include "Vao/OgreVaoManager.h"
 
@@ -21,21 +23,128 @@
 #include "unicode/ubidi.h"
 #include "unicode/unistr.h"
 
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
 namespace Colibri
 {
+	/// Dirty ranges of the atlas closer than this many bytes are uploaded in the same copy.
+	/// Copying a few extra bytes is cheaper than issuing another copy.
+	static const size_t c_atlasUploadGapTolerance = 4096u;
+	/// Max glyphs rasterized by a single job of prewarmQueuedGlyphs
+	static const size_t c_prewarmGlyphsPerJob = 64u;
+	/// Longer strings aren't put in the shaping cache. They're unlikely to repeat and
+	/// would push out many short ones
+	static const uint32_t c_shapingCacheMaxStringBytes = 256u;
+	/// Pixels (at the reference size) covered by the distance fields around each glyph.
+	/// See setGlyphSdfReferenceSize
+	static const size_t c_glyphSdfSpread = 6u;
+
+	/// Identifies files written by saveGlyphCache ("CGGC"). Also catches endianness mismatches
+	static const uint32_t c_glyphCacheFileMagic = 0x43474743u;
+	/// Bump it whenever the layout of the file or the way glyphs are rasterized changes
+	static const uint32_t c_glyphCacheFileVersion = 1u;
+
+	struct GlyphCacheFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numGlyphs;
+		uint32_t bitmapBytes;
+	};
+
+	/// Followed by the pixels of all glyphs after the last entry
+	struct GlyphCacheFileEntry
+	{
+		uint64_t fontHash;
+		uint32_t ptSize;
+		uint32_t dpi;
+		uint32_t renderMode;
+		uint32_t glyphIdx;
+		float    bearingX;
+		float    bearingY;
+		float    newlineSize;
+		float    regionUp;
+		uint16_t width;
+		uint16_t height;
+		/// Relative to the first byte after the last entry
+		uint32_t bitmapStart;
+	};
+	static_assert( sizeof( GlyphCacheFileEntry ) == 48u, "Padding changes the file layout" );
+
+	/// Fills everything about the glyph that comes from the glyph slot & the font's size,
+	/// after the glyph has been rendered into font->glyph
+	static void fillGlyphMetrics( FT_Face font, CachedGlyph &outGlyph )
+	{
+		const FT_GlyphSlot slot = font->glyph;
+		outGlyph.bearingX	= static_cast<float>( slot->bitmap_left );
+		outGlyph.bearingY	= static_cast<float>( slot->bitmap_top );
+		outGlyph.width		= static_cast<uint16_t>( slot->bitmap.width );
+		outGlyph.height		= static_cast<uint16_t>( slot->bitmap.rows );
+		outGlyph.newlineSize = (float)font->size->metrics.height / 64.0f;
+		outGlyph.regionUp = (float)font->size->metrics.ascender /
+							float( font->size->metrics.ascender - font->size->metrics.descender );
+	}
+
+	/// Converts the glyph that was just rendered into font->glyph into a distance field.
+	/// Returns the pixels to place in the atlas, either from font->glyph or from outSdf
+	static const uint8_t *colibri_nullable makeGlyphSdf( FT_Face font, CachedGlyph &inOutGlyph,
+														 GlyphSdf &glyphSdf,
+														 std::vector<uint8_t> &outSdf )
+	{
+		const FT_Bitmap &ftBitmap = font->glyph->bitmap;
+
+		// Nothing to draw (e.g. whitespace)
+		if( inOutGlyph.getSizeBytes() == 0u )
+			return ftBitmap.buffer;
+
+		glyphSdf.generate( ftBitmap.buffer, ftBitmap.width, ftBitmap.rows, ftBitmap.pitch,
+						   c_glyphSdfSpread, outSdf );
+
+		// The field extends beyond the glyph
+		inOutGlyph.width = static_cast<uint16_t>( inOutGlyph.width + c_glyphSdfSpread * 2u );
+		inOutGlyph.height = static_cast<uint16_t>( inOutGlyph.height + c_glyphSdfSpread * 2u );
+		inOutGlyph.bearingX -= float( c_glyphSdfSpread );
+		inOutGlyph.bearingY += float( c_glyphSdfSpread );
+
+		return &outSdf[0];
+	}
+
+	/// Returns true if all bytes are below 0x80
+	static bool isAscii( const char *utf8Str, size_t length )
+	{
+		uint64_t orAll = 0u;
+
+		size_t i = 0u;
+		for( ; i + sizeof( uint64_t ) <= length; i += sizeof( uint64_t ) )
+		{
+			uint64_t bytes;
+			memcpy( &bytes, utf8Str + i, sizeof( bytes ) );
+			orAll |= bytes;
+		}
+		for( ; i < length; ++i )
+			orAll |= static_cast<uint8_t>( utf8Str[i] );
+
+		return ( orAll & 0x8080808080808080ULL ) == 0u;
+	}
+
 	ShaperManager::ShaperManager( ColibriManager *colibriManager ) :
 		m_ftLibrary( 0 ),
 		m_colibriManager( colibriManager ),
-		m_glyphAtlas( 0 ),
-		m_offsetPtr( 1 ),  // The 1st byte is taken. See ShaperManager::updateGpuBuffers
-		m_atlasCapacity( 0 ),
+		m_atlasPageSize( 4u * 1024u * 1024u ),
+		m_atlasStagingBuffer( 0 ),
+		m_shapingCacheMaxEntries( 2048u ),
+		m_shapingCacheMaxGlyphs( 32768u ),
+		m_simpleTextFastPath( true ),
+		m_atlasCompactionBudget( 0u ),
 		m_preferredVertReadingDir( VertReadingDir::Disabled ),
 		m_bidi( 0 ),
 		m_defaultDirection( UBIDI_DEFAULT_LTR /*Note: non-defaults like UBIDI_RTL work differently!*/ ),
 		m_useVerticalLayoutWhenAvailable( false ),
 		m_defaultBmpFontForRaster( std::numeric_limits<uint16_t>::max() ),
 		m_dpi( 96u ),
-		m_glyphAtlasBuffer( 0 ),
 		m_hlms( 0 ),
 		m_vaoManager( 0 )
 	{
@@ -58,6 +167,8 @@ namespace Colibri
 	//-------------------------------------------------------------------------
 	ShaperManager::~ShaperManager()
 	{
+		clearShapingCache();
+
 		if( !m_shapers.empty() )
 		{
 			ShaperVec::const_iterator itor = m_shapers.begin() + 1u;
@@ -78,13 +189,19 @@ namespace Colibri
 			m_bmpFonts.clear();
 		}
 
-		if( m_glyphAtlas )
+		setOgre( 0, 0 );
+
 		{
-			free( m_glyphAtlas );
-			m_glyphAtlas = 0;
-		}
+			AtlasPageVec::const_iterator itor = m_atlasPages.begin();
+			AtlasPageVec::const_iterator endt = m_atlasPages.end();
 
-		setOgre( 0, 0 );
+			while( itor != endt )
+			{
+				free( itor->data );
+				++itor;
+			}
+			m_atlasPages.clear();
+		}
 
 		ubidi_close( m_bidi );
 		m_bidi = 0;
@@ -97,22 +214,30 @@ namespace Colibri
 								 Ogre::VaoManager * colibri_nullable vaoManager )
 	{
 		if( m_hlms )
-			m_hlms->setGlyphAtlasBuffer( 0 );
-		if( m_vaoManager && m_glyphAtlasBuffer )
 		{
-#if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
-			if( m_glyphAtlasBuffer->getBufferPackedType() != Ogre::BP_TYPE_TEX )
+			for( size_t i = 0u; i < Ogre::HlmsColibri::MaxGlyphAtlasPages; ++i )
+				m_hlms->setGlyphAtlasBuffer( i, 0 );
+		}
+		if( m_vaoManager )
+		{
+			if( m_atlasStagingBuffer )
 			{
-				m_vaoManager->destroyReadOnlyBuffer(
-					static_cast<Ogre::ReadOnlyBufferPacked *>( m_glyphAtlasBuffer ) );
+				m_atlasStagingBuffer->removeReferenceCount();
+				m_atlasStagingBuffer = 0;
 			}
-			else
-#endif
+
+			AtlasPageVec::iterator itor = m_atlasPages.begin();
+			AtlasPageVec::iterator endt = m_atlasPages.end();
+
+			while( itor != endt )
 			{
-				m_vaoManager->destroyTexBuffer(
-					static_cast<Ogre::TexBufferPacked *>( m_glyphAtlasBuffer ) );
+				if( itor->buffer )
+				{
+					destroyAtlasBuffer( itor->buffer );
+					itor->buffer = 0;
+				}
+				++itor;
 			}
-			m_glyphAtlasBuffer = 0;
 		}
 
 		m_hlms = hlms;
@@ -129,9 +254,17 @@ namespace Colibri
 				( *itor )->setOgre( hlms, textureManager );
 				++itor;
 			}
+
+			hlms->setGlyphSdf( m_sdfReferenceSize.value26d6 != 0u );
 		}
 	}
 	//-------------------------------------------------------------------------
+	void ShaperManager::setGlyphAtlasPageSize( size_t pageSize )
+	{
+		COLIBRI_ASSERT_LOW( pageSize > 1u && pageSize <= 0xFFFFFFu );
+		m_atlasPageSize = std::min<size_t>( std::max<size_t>( pageSize, 2u ), 0xFFFFFFu );
+	}
+	//-------------------------------------------------------------------------
 	void ShaperManager::setDPI( uint32_t dpi )
 	{
 		LogListener *log = getLogListener();
@@ -157,6 +290,9 @@ namespace Colibri
 
 		m_shapers.push_back( shaper );
 
+		// Strings that asked for this font index fell back to the default one
+		clearShapingCache();
+
 		return shaper;
 	}
 	//-------------------------------------------------------------------------
@@ -176,6 +312,8 @@ namespace Colibri
 		case HorizReadingDir::RTL:		m_defaultDirection = UBIDI_RTL;			break;
 		}
 		m_useVerticalLayoutWhenAvailable = useVerticalLayoutWhenAvailable;
+
+		clearShapingCache();
 	}
 	//-------------------------------------------------------------------------
 	void ShaperManager::addBmpFont( const char *fontPath, bool bBilinearFilter )
@@ -185,7 +323,12 @@ namespace Colibri
 		m_bmpFonts.push_back( bmpFont );
 	}
 	//-------------------------------------------------------------------------
-	void ShaperManager::setDefaultBmpFontForRaster( uint16_t font ) { m_defaultBmpFontForRaster = font; }
+	void ShaperManager::setDefaultBmpFontForRaster( uint16_t font )
+	{
+		m_defaultBmpFontForRaster = font;
+		// Whether private area glyphs are dummies depends on it
+		clearShapingCache();
+	}
 	//-------------------------------------------------------------------------
 	uint16_t ShaperManager::getDefaultBmpFontForRasterIdx() const { return m_defaultBmpFontForRaster; }
 	//-------------------------------------------------------------------------
@@ -201,94 +344,147 @@ namespace Colibri
 		return m_colibriManager->getLogListener();
 	}
 	//-------------------------------------------------------------------------
-	void ShaperManager::growAtlas( size_t sizeBytes )
+	void ShaperManager::addAtlasPage( size_t sizeBytes )
 	{
-		m_atlasCapacity = std::max( m_offsetPtr + sizeBytes,
-									m_atlasCapacity + (m_atlasCapacity >> 1u) + 1u );
-		m_glyphAtlas = reinterpret_cast<uint8_t*>( realloc( m_glyphAtlas, m_atlasCapacity ) );
+		// Offsets in a page must fit in 24 bits. See CachedGlyph::offsetStart
+		AtlasPage page;
+		const size_t capacity =
+			std::min<size_t>( std::max( m_atlasPageSize, sizeBytes + 1u ), 0xFFFFFFu );
+		page.allocator.setCapacity( capacity );
+		page.data = reinterpret_cast<uint8_t *>( malloc( capacity ) );
+		m_atlasPages.push_back( page );
 	}
 	//-------------------------------------------------------------------------
-	size_t ShaperManager::getAtlasOffset( size_t sizeBytes )
+	void ShaperManager::removeLastAtlasPage()
 	{
-		//Get smallest available free range
-		RangeVec::iterator end = m_freeRanges.end();
-		RangeVec::iterator bestRange = end;
+		AtlasPage &page = m_atlasPages.back();
+		COLIBRI_ASSERT_LOW( page.glyphsByOffset.empty() );
 
+		if( page.buffer )
 		{
-			RangeVec::iterator itor = m_freeRanges.begin();
-			while( itor != end )
-			{
-				if( sizeBytes < itor->size && (bestRange == end || bestRange->size > itor->size) )
-					bestRange = itor;
-				++itor;
-			}
+			const size_t pageIdx = m_atlasPages.size() - 1u;
+			if( m_hlms )
+				m_hlms->setGlyphAtlasBuffer( pageIdx, 0 );
+			destroyAtlasBuffer( page.buffer );
+			page.buffer = 0;
+		}
+
+		free( page.data );
+		m_atlasPages.pop_back();
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::growLastAtlasPage( size_t sizeBytes )
+	{
+		AtlasPage &page = m_atlasPages.back();
+		const size_t atlasCapacity = page.allocator.getCapacity();
+		const size_t newCapacity =
+			std::min<size_t>( std::max( page.allocator.getUsedEnd() + sizeBytes,
+										atlasCapacity + ( atlasCapacity >> 1u ) + 1u ),
+							  0xFFFFFFu );
+		if( newCapacity > atlasCapacity )
+		{
+			page.allocator.setCapacity( newCapacity );
+			page.data = reinterpret_cast<uint8_t *>( realloc( page.data, newCapacity ) );
 		}
+	}
+	//-------------------------------------------------------------------------
+	bool ShaperManager::canAllocateFromAtlas( size_t sizeBytes ) const
+	{
+		AtlasPageVec::const_iterator itor = m_atlasPages.begin();
+		AtlasPageVec::const_iterator endt = m_atlasPages.end();
 
-		size_t retVal = 0;
+		while( itor != endt )
+		{
+			if( itor->allocator.canAllocate( sizeBytes ) )
+				return true;
+			++itor;
+		}
 
-		if( bestRange != end )
+		return false;
+	}
+	//-------------------------------------------------------------------------
+	bool ShaperManager::allocateFromAtlas( size_t sizeBytes, uint32_t &outOffset )
+	{
+		if( sizeBytes == 0u )
 		{
-			retVal = bestRange->offset;
-			bestRange->offset	+= sizeBytes;
-			bestRange->size		-= sizeBytes;
-			if( bestRange->size == 0 )
-				Ogre::efficientVectorRemove( m_freeRanges, bestRange );
+			outOffset = 0u;
+			return true;
 		}
-		else
+
+		const size_t numPages = m_atlasPages.size();
+		for( size_t i = 0u; i < numPages; ++i )
 		{
-			//Couldn't find free space in fragmented pool.
-			if( m_offsetPtr + sizeBytes > m_atlasCapacity )
+			size_t offset;
+			if( m_atlasPages[i].allocator.allocate( sizeBytes, offset ) )
 			{
-				//We're out of space. First check if we can steal another slot.
-				const CachedGlyphMap::iterator enGlyph = m_glyphCache.end();
-				CachedGlyphMap::iterator bestUnusedGlyph = enGlyph;
-
-				for( size_t i = 0; i < 2u && bestUnusedGlyph == enGlyph; ++i )
-				{
-					CachedGlyphMap::iterator itGlyph = m_glyphCache.begin();
-					while( itGlyph != enGlyph )
-					{
-						if( !itGlyph->second.refCount && itGlyph->second.getSizeBytes() >= sizeBytes &&
-							( bestUnusedGlyph == enGlyph ||
-							  itGlyph->second.getSizeBytes() < bestUnusedGlyph->second.getSizeBytes() ) )
-						{
-							bestUnusedGlyph = itGlyph;
-						}
-						++itGlyph;
-					}
+				outOffset = static_cast<uint32_t>( ( i << 24u ) | offset );
+				return true;
+			}
+		}
 
-					// Not found? Try again, this time with all unused glyphs removed and merged.
-					// We may have two contiguous unused glyphs that are big enough to hold
-					// this new glyph, but weren't big enough individually.
-					if( i == 0 && bestUnusedGlyph == enGlyph )
-						flushReleasedGlyphs();
-				}
+		return false;
+	}
+	//-------------------------------------------------------------------------
+	uint32_t ShaperManager::getAtlasOffset( size_t sizeBytes )
+	{
+		uint32_t retVal = 0;
 
-				if( bestUnusedGlyph == enGlyph )
-				{
-					// Cannot steal. Grow the atlas, advance the pointer and get a fresh region
-					growAtlas( sizeBytes );
-					retVal = m_offsetPtr;
-					m_offsetPtr += sizeBytes;
-				}
+		if( !allocateFromAtlas( sizeBytes, retVal ) )
+		{
+			//We're out of space. First try to steal the space of glyphs nobody uses,
+			//least recently released first. Contiguous stolen glyphs get merged,
+			//thus several small ones may make room for a bigger one.
+			CachedGlyph *unusedGlyph = m_glyphCache.getLeastRecentlyUsed();
+			while( !canAllocateFromAtlas( sizeBytes ) &&
+				   ( unusedGlyph || m_shapingCache.getNumEntries() != 0u ) )
+			{
+				if( unusedGlyph )
+					destroyGlyph( unusedGlyph );
 				else
 				{
-					//Steal successful! Put the unused glyph back into the pool and try again
-					destroyGlyph( bestUnusedGlyph );
-					retVal = getAtlasOffset( sizeBytes );
+					// Glyphs only kept alive by the shaping cache can be stolen too
+					trimShapingCache( m_shapingCache.getNumEntries() >> 1u,
+									  m_shapingCache.getNumGlyphs() );
 				}
+				unusedGlyph = m_glyphCache.getLeastRecentlyUsed();
 			}
-			else
+
+			// Cannot steal. Add a page (or grow the last one if we can't have more)
+			if( !canAllocateFromAtlas( sizeBytes ) )
 			{
-				//Advance the pointer and get a fresh region
-				retVal = m_offsetPtr;
-				m_offsetPtr += sizeBytes;
+				if( m_atlasPages.size() < Ogre::HlmsColibri::MaxGlyphAtlasPages )
+					addAtlasPage( sizeBytes );
+				else
+					growLastAtlasPage( sizeBytes );
+			}
+
+			if( !allocateFromAtlas( sizeBytes, retVal ) )
+			{
+				LogListener *log = getLogListener();
+				log->log( "Glyph atlas is full. Glyph will not be displayed. Too many glyphs "
+						  "in use, or too big",
+						  LogSeverity::Error );
+				retVal = std::numeric_limits<uint32_t>::max();
 			}
 		}
 
 		return retVal;
 	}
 	//-------------------------------------------------------------------------
+	void ShaperManager::destroyAtlasBuffer( Ogre::BufferPacked *buffer )
+	{
+#if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
+		if( buffer->getBufferPackedType() != Ogre::BP_TYPE_TEX )
+		{
+			m_vaoManager->destroyReadOnlyBuffer( static_cast<Ogre::ReadOnlyBufferPacked *>( buffer ) );
+		}
+		else
+#endif
+		{
+			m_vaoManager->destroyTexBuffer( static_cast<Ogre::TexBufferPacked *>( buffer ) );
+		}
+	}
+	//-------------------------------------------------------------------------
 	CachedGlyph *ShaperManager::createGlyph( FT_Face font, uint32_t codepoint, uint32_t ptSize,
 											 uint16_t fontIdx, bool bDummy )
 	{
@@ -307,44 +503,55 @@ namespace Colibri
 		}
 
 		//Rasterize the glyph
-		FT_GlyphSlot slot = font->glyph;
-		FT_Render_Glyph( slot, FT_RENDER_MODE_NORMAL );
-
-		FT_Bitmap ftBitmap = slot->bitmap;
+		FT_Render_Glyph( font->glyph, FT_RENDER_MODE_NORMAL );
 
 		//Create a cache entry
 		CachedGlyph newGlyph;
 		newGlyph.codepoint	= codepoint;
 		newGlyph.ptSize		= ptSize;
-		newGlyph.bearingX	= static_cast<float>( slot->bitmap_left );
-		newGlyph.bearingY	= static_cast<float>( slot->bitmap_top );
-		newGlyph.width		= static_cast<uint16_t>( ftBitmap.width );
-		newGlyph.height		= static_cast<uint16_t>( ftBitmap.rows );
-		newGlyph.offsetStart = (uint32_t)getAtlasOffset( newGlyph.getSizeBytes() );
-		newGlyph.newlineSize = (float)font->size->metrics.height / 64.0f;
-		newGlyph.regionUp = (float)font->size->metrics.ascender /
-							float( font->size->metrics.ascender - font->size->metrics.descender );
+		fillGlyphMetrics( font, newGlyph );
+
+		if( m_sdfReferenceSize.value26d6 != 0u )
+		{
+			const uint8_t *sdf = makeGlyphSdf( font, newGlyph, m_glyphSdf, m_sdfScratch );
+			return addGlyph( newGlyph, fontIdx, sdf );
+		}
+
+		return addGlyph( newGlyph, fontIdx, font->glyph->bitmap.buffer );
+	}
+	//-------------------------------------------------------------------------
+	CachedGlyph *ShaperManager::addGlyph( CachedGlyph &newGlyph, uint16_t fontIdx,
+										  const uint8_t *colibri_nullable bitmap )
+	{
+		newGlyph.offsetStart = getAtlasOffset( newGlyph.getSizeBytes() );
+		if( colibri_unlikely( newGlyph.offsetStart == std::numeric_limits<uint32_t>::max() ) )
+		{
+			// Out of atlas space. Display nothing
+			newGlyph.width = 0u;
+			newGlyph.height = 0u;
+			newGlyph.offsetStart = 0u;
+		}
 		newGlyph.font = fontIdx;
 		newGlyph.refCount	= 0;
 
-		const GlyphKey glyphKey( codepoint, ptSize, fontIdx );
-		std::pair<CachedGlyphMap::iterator, bool> pair =
-				m_glyphCache.emplace( glyphKey, newGlyph );
+		CachedGlyph *retVal = m_glyphCache.insert( newGlyph );
 
 		if( newGlyph.getSizeBytes() > 0 )
 		{
 			//Copy the rasterized results to our atlas
-			memcpy( m_glyphAtlas + newGlyph.offsetStart, ftBitmap.buffer, newGlyph.getSizeBytes() );
+			AtlasPage &page = m_atlasPages[newGlyph.getAtlasPage()];
+			memcpy( page.data + newGlyph.getOffsetInPage(), bitmap, newGlyph.getSizeBytes() );
+			page.glyphsByOffset[newGlyph.getOffsetInPage()] = retVal;
 			{
 				//Schedule a transfer to the GPU.
 				Range dirtyRange;
-				dirtyRange.offset	= newGlyph.offsetStart;
+				dirtyRange.offset	= newGlyph.getOffsetInPage();
 				dirtyRange.size		= newGlyph.getSizeBytes();
-				m_dirtyRanges.push_back( dirtyRange );
+				page.dirtyRanges.push_back( dirtyRange );
 			}
 		}
 
-		return &pair.first->second;
+		return retVal;
 	}
 	//-------------------------------------------------------------------------
 	CachedGlyph *ShaperManager::createRasterGlyph( FT_Face font, uint32_t codepoint, uint32_t ptSize,
@@ -376,161 +583,539 @@ namespace Colibri
 
 		releaseGlyph( dummyCodepoint );
 
-		const GlyphKey glyphKey( codepoint, ptSize, fontIdx );
-		std::pair<CachedGlyphMap::iterator, bool> pair =
-				m_glyphCache.emplace( glyphKey, newGlyph );
+		return m_glyphCache.insert( newGlyph );
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::destroyGlyph( CachedGlyph *glyph )
+	{
+		if( glyph->getSizeBytes() > 0u )
+		{
+			AtlasPage &page = m_atlasPages[glyph->getAtlasPage()];
+			page.allocator.deallocate( glyph->getOffsetInPage(), glyph->getSizeBytes() );
+			page.glyphsByOffset.erase( glyph->getOffsetInPage() );
+		}
+		m_glyphCache.erase( glyph );
+	}
+	//-------------------------------------------------------------------------
+	const CachedGlyph *ShaperManager::acquireGlyph( FT_Face font, uint32_t codepoint, uint32_t ptSize,
+													uint16_t fontIdx, bool bDummy )
+	{
+		COLIBRI_ASSERT_MEDIUM( fontIdx != 0 );
+
+		const bool bRaster = bDummy && getDefaultBmpFontForRaster();
+
+		// Distance fields are shared by all sizes. See setGlyphSdfReferenceSize
+		const uint32_t cachedPtSize =
+			( m_sdfReferenceSize.value26d6 != 0u && !bRaster ) ? m_sdfReferenceSize.value26d6 : ptSize;
+
+		CachedGlyph *retVal = m_glyphCache.find( codepoint, cachedPtSize, fontIdx );
+
+		if( !retVal )
+		{
+			if( !bRaster )
+			{
+				if( cachedPtSize != ptSize )
+				{
+					FT_Set_Char_Size( font, 0, (FT_F26Dot6)cachedPtSize, m_dpi, m_dpi );
+					retVal = createGlyph( font, codepoint, cachedPtSize, fontIdx, bDummy );
+					// The Shaper that owns the font expects it at its size
+					FT_Set_Char_Size( font, 0, (FT_F26Dot6)ptSize, m_dpi, m_dpi );
+				}
+				else
+				{
+					retVal = createGlyph( font, codepoint, ptSize, fontIdx, bDummy );
+				}
+			}
+			else
+				retVal = createRasterGlyph( font, codepoint, ptSize, fontIdx );
+		}
+
+		m_glyphCache.addRef( retVal );
+
+		return retVal;
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::addRefCount( const CachedGlyph *cachedGlyph )
+	{
+		COLIBRI_ASSERT_MEDIUM( m_glyphCache.find( cachedGlyph->codepoint, cachedGlyph->ptSize,
+												  cachedGlyph->font ) == cachedGlyph &&
+							   "Invalid glyph cache entry. Use-after-free perhaps?" );
+
+		CachedGlyph *nonConstCachedGlyph = const_cast<CachedGlyph*>( cachedGlyph );
+		m_glyphCache.addRef( nonConstCachedGlyph );
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::releaseGlyph( uint32_t codepoint, uint32_t ptSize, uint16_t fontIdx )
+	{
+		CachedGlyph *glyph = m_glyphCache.find( codepoint, ptSize, fontIdx );
 
-		return &pair.first->second;
+		COLIBRI_ASSERT_LOW( glyph &&
+							"Invalid glyph cache entry not found. Use-after-free perhaps?" );
+		COLIBRI_ASSERT_LOW( glyph->refCount > 0 );
+
+		if( glyph && glyph->refCount > 0 )
+			m_glyphCache.release( glyph );
 	}
 	//-------------------------------------------------------------------------
-	void ShaperManager::destroyGlyph( CachedGlyphMap::iterator glyphIt )
+	void ShaperManager::releaseGlyph( const CachedGlyph *cachedGlyph )
 	{
-		CachedGlyph &glyph = glyphIt->second;
+		COLIBRI_ASSERT_MEDIUM( m_glyphCache.find( cachedGlyph->codepoint, cachedGlyph->ptSize,
+												  cachedGlyph->font ) == cachedGlyph &&
+							   "Invalid glyph cache entry. Use-after-free perhaps?" );
+		COLIBRI_ASSERT_LOW( cachedGlyph->refCount > 0 );
 
-		if( glyph.offsetStart + glyph.getSizeBytes() == m_offsetPtr )
+		CachedGlyph *nonConstCachedGlyph = const_cast<CachedGlyph*>( cachedGlyph );
+		if( nonConstCachedGlyph->refCount > 0 )
+			m_glyphCache.release( nonConstCachedGlyph );
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::flushReleasedGlyphs()
+	{
+		CachedGlyph *unusedGlyph = m_glyphCache.getLeastRecentlyUsed();
+		while( unusedGlyph )
 		{
-			//Easy case. LIFO.
-			m_offsetPtr -= glyph.getSizeBytes();
+			destroyGlyph( unusedGlyph );
+			unusedGlyph = m_glyphCache.getLeastRecentlyUsed();
 		}
-		else
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::queueGlyphPrewarm( uint16_t font, FontSize ptSize, uint32_t firstCodepoint,
+										   uint32_t lastCodepoint )
+	{
+		COLIBRI_ASSERT_LOW( firstCodepoint <= lastCodepoint );
+
+		PrewarmGlyph prewarmGlyph;
+		prewarmGlyph.ptSize = ptSize.value26d6;
+		prewarmGlyph.font = font;
+
+		for( uint32_t codepoint = firstCodepoint; codepoint <= lastCodepoint; ++codepoint )
 		{
-			Range freeRange;
-			freeRange.offset= glyph.offsetStart;
-			freeRange.size	= glyph.getSizeBytes();
-			m_freeRanges.push_back( freeRange );
-			mergeContiguousBlocks( m_freeRanges.end() - 1u, m_freeRanges );
+			prewarmGlyph.codepoint = codepoint;
+			m_prewarmQueue.push_back( prewarmGlyph );
+
+			if( codepoint == std::numeric_limits<uint32_t>::max() )
+				break;
 		}
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::queueGlyphPrewarm( uint16_t font, FontSize ptSize, const char *utf8Str )
+	{
+		PrewarmGlyph prewarmGlyph;
+		prewarmGlyph.ptSize = ptSize.value26d6;
+		prewarmGlyph.font = font;
 
-		m_glyphCache.erase( glyphIt );
+		UnicodeString uStr = UnicodeString::fromUTF8( utf8Str );
+
+		const int32_t length = uStr.length();
+		for( int32_t i = 0; i < length; i = uStr.moveIndex32( i, 1 ) )
+		{
+			prewarmGlyph.codepoint = static_cast<uint32_t>( uStr.char32At( i ) );
+			m_prewarmQueue.push_back( prewarmGlyph );
+		}
 	}
 	//-------------------------------------------------------------------------
-	void ShaperManager::mergeContiguousBlocks( RangeVec::iterator blockToMerge,
-											   RangeVec &blocks )
+	namespace
 	{
-		RangeVec::iterator itor = blocks.begin();
-		RangeVec::iterator end  = blocks.end();
+		struct GlyphToPrewarm
+		{
+			Shaper *shaper;
+			uint32_t glyphIdx;
+			uint32_t ptSize;
 
-		while( itor != end )
+			bool operator < ( const GlyphToPrewarm &other ) const
+			{
+				if( this->shaper->getFontIdx() != other.shaper->getFontIdx() )
+					return this->shaper->getFontIdx() < other.shaper->getFontIdx();
+				if( this->ptSize != other.ptSize )
+					return this->ptSize < other.ptSize;
+				return this->glyphIdx < other.glyphIdx;
+			}
+			bool operator == ( const GlyphToPrewarm &other ) const
+			{
+				return this->shaper->getFontIdx() == other.shaper->getFontIdx() &&
+					   this->ptSize == other.ptSize && this->glyphIdx == other.glyphIdx;
+			}
+		};
+
+		struct PrewarmJobResult
+		{
+			std::vector<CachedGlyph> glyphs;
+			/// Where the pixels of each glyph start in bitmaps
+			std::vector<size_t>		 bitmapStarts;
+			std::vector<uint8_t>	 bitmaps;
+		};
+
+		/// Rasterizes a range of glyphs that share font & size
+		class GlyphPrewarmJob final : public WorkerPool::Job
 		{
-			if( itor->offset + itor->size == blockToMerge->offset )
+			const std::vector<GlyphToPrewarm> &m_glyphs;
+			const std::vector<size_t> &m_jobStarts;
+			std::vector<PrewarmJobResult> &m_results;
+			uint32_t m_dpi;
+			/// When false the Shapers' own faces are used, thus the jobs must run serially
+			bool m_useOwnFaces;
+			/// See ShaperManager::setGlyphSdfReferenceSize
+			bool m_sdf;
+
+		public:
+			GlyphPrewarmJob( const std::vector<GlyphToPrewarm> &glyphs,
+							 const std::vector<size_t> &jobStarts,
+							 std::vector<PrewarmJobResult> &results, uint32_t dpi,
+							 bool useOwnFaces, bool sdf ) :
+				m_glyphs( glyphs ),
+				m_jobStarts( jobStarts ),
+				m_results( results ),
+				m_dpi( dpi ),
+				m_useOwnFaces( useOwnFaces ),
+				m_sdf( sdf )
 			{
-				itor->size += blockToMerge->size;
-				ptrdiff_t idx = itor - blocks.begin();
+			}
+
+			void execute( size_t jobIdx ) override
+			{
+				const size_t start = m_jobStarts[jobIdx];
+				const size_t end = m_jobStarts[jobIdx + 1u];
+
+				Shaper *shaper = m_glyphs[start].shaper;
+				const uint32_t ptSize = m_glyphs[start].ptSize;
+
+				// FreeType objects can't be shared across threads
+				FT_Library library = 0;
+				FT_Face face = 0;
+				if( m_useOwnFaces )
+				{
+					if( FT_Init_FreeType( &library ) )
+						return;
+					if( FT_New_Face( library, shaper->getFontLocation().c_str(), 0, &face ) ||
+						FT_Set_Char_Size( face, 0, (FT_F26Dot6)ptSize, m_dpi, m_dpi ) )
+					{
+						// Those that couldn't be prewarmed will be rasterized when needed
+						FT_Done_FreeType( library );
+						return;
+					}
+				}
+				else
+				{
+					shaper->setFontSize( FontSize( ptSize ) );
+					face = shaper->getFreeTypeFace();
+				}
 
-				//When blockToMerge is the last one, its index won't be the same
-				//after removing the other iterator, they will swap.
-				if( idx == ptrdiff_t( blocks.size() - 1u ) )
-					idx = blockToMerge - blocks.begin();
+				PrewarmJobResult &result = m_results[jobIdx];
 
-				Ogre::efficientVectorRemove( blocks, blockToMerge );
+				GlyphSdf glyphSdf;
+				std::vector<uint8_t> sdf;
 
-				blockToMerge = blocks.begin() + idx;
-				itor = blocks.begin();
-				end  = blocks.end();
+				for( size_t i = start; i < end; ++i )
+				{
+					if( FT_Load_Glyph( face, m_glyphs[i].glyphIdx, FT_LOAD_DEFAULT ) ||
+						FT_Render_Glyph( face->glyph, FT_RENDER_MODE_NORMAL ) )
+					{
+						continue;
+					}
+
+					CachedGlyph newGlyph;
+					newGlyph.codepoint = m_glyphs[i].glyphIdx;
+					newGlyph.ptSize = ptSize;
+					newGlyph.font = shaper->getFontIdx();
+					fillGlyphMetrics( face, newGlyph );
+
+					const uint8_t *bitmap = face->glyph->bitmap.buffer;
+					if( m_sdf )
+						bitmap = makeGlyphSdf( face, newGlyph, glyphSdf, sdf );
+					result.bitmapStarts.push_back( result.bitmaps.size() );
+					result.bitmaps.insert( result.bitmaps.end(), bitmap,
+										   bitmap + newGlyph.getSizeBytes() );
+					result.glyphs.push_back( newGlyph );
+				}
+
+				// FT_Done_FreeType also destroys the face
+				if( library )
+					FT_Done_FreeType( library );
 			}
-			else if( blockToMerge->offset + blockToMerge->size == itor->offset )
-			{
-				blockToMerge->size += itor->size;
-				ptrdiff_t idx = blockToMerge - blocks.begin();
+		};
+	}  // namespace
 
-				//When blockToMerge is the last one, its index won't be the same
-				//after removing the other iterator, they will swap.
-				if( idx == ptrdiff_t( blocks.size() - 1u ) )
-					idx = itor - blocks.begin();
+	void ShaperManager::prewarmQueuedGlyphs()
+	{
+		// Turn codepoints into glyph indices, which is what the cache works with
+		std::vector<GlyphToPrewarm> glyphs;
+		glyphs.reserve( m_prewarmQueue.size() );
 
-				Ogre::efficientVectorRemove( blocks, itor );
+		PrewarmGlyphVec::const_iterator itor = m_prewarmQueue.begin();
+		PrewarmGlyphVec::const_iterator endt = m_prewarmQueue.end();
 
-				blockToMerge = blocks.begin() + idx;
-				itor = blocks.begin();
-				end  = blocks.end();
+		while( itor != endt )
+		{
+			if( colibri_likely( itor->font < m_shapers.size() ) )
+			{
+				GlyphToPrewarm glyph;
+				glyph.shaper = m_shapers[itor->font];
+				glyph.glyphIdx = FT_Get_Char_Index( glyph.shaper->getFreeTypeFace(), itor->codepoint );
+				glyph.ptSize = m_sdfReferenceSize.value26d6 != 0u ? m_sdfReferenceSize.value26d6
+																   : itor->ptSize;
+
+				// Glyph 0 means the font doesn't have it
+				if( glyph.glyphIdx != 0u &&
+					!m_glyphCache.find( glyph.glyphIdx, glyph.ptSize, glyph.shaper->getFontIdx() ) )
+				{
+					glyphs.push_back( glyph );
+				}
 			}
-			else
+			++itor;
+		}
+		m_prewarmQueue.clear();
+
+		if( glyphs.empty() )
+			return;
+
+		std::sort( glyphs.begin(), glyphs.end() );
+		glyphs.erase( std::unique( glyphs.begin(), glyphs.end() ), glyphs.end() );
+
+		// Split in jobs. All glyphs in a job share font & size
+		std::vector<size_t> jobStarts;
+		jobStarts.push_back( 0u );
+		for( size_t i = 1u; i < glyphs.size(); ++i )
+		{
+			if( glyphs[i].shaper->getFontIdx() != glyphs[i - 1u].shaper->getFontIdx() ||
+				glyphs[i].ptSize != glyphs[i - 1u].ptSize ||
+				i - jobStarts.back() >= c_prewarmGlyphsPerJob )
 			{
-				++itor;
+				jobStarts.push_back( i );
 			}
 		}
-	}
-	//-------------------------------------------------------------------------
-	const CachedGlyph *ShaperManager::acquireGlyph( FT_Face font, uint32_t codepoint, uint32_t ptSize,
-													uint16_t fontIdx, bool bDummy )
-	{
-		CachedGlyph *retVal = 0;
+		const size_t numJobs = jobStarts.size();
+		jobStarts.push_back( glyphs.size() );
 
-		const GlyphKey glyphKey( codepoint, ptSize, fontIdx );
-		CachedGlyphMap::iterator itor = m_glyphCache.find( glyphKey );
+		std::vector<PrewarmJobResult> results( numJobs );
 
-		if( itor != m_glyphCache.end() )
+		WorkerPool *workerPool = m_colibriManager->getWorkerPool();
+#ifdef __ANDROID__
+		// Fonts are read from the APK through a custom stream, we can't open them again
+		workerPool = 0;
+#endif
+		GlyphPrewarmJob job( glyphs, jobStarts, results, m_dpi, workerPool != 0,
+							 m_sdfReferenceSize.value26d6 != 0u );
+		if( workerPool )
 		{
-			retVal = &itor->second;
+			workerPool->parallelFor( &job, numJobs );
 		}
 		else
 		{
-			if( !bDummy || !getDefaultBmpFontForRaster() )
-				retVal = createGlyph( font, codepoint, ptSize, fontIdx, bDummy );
-			else
-				retVal = createRasterGlyph( font, codepoint, ptSize, fontIdx );
+			for( size_t i = 0u; i < numJobs; ++i )
+				job.execute( i );
 		}
 
-		++retVal->refCount;
+		// Atlas & cache are only touched from this thread
+		std::vector<PrewarmJobResult>::iterator itResult = results.begin();
+		std::vector<PrewarmJobResult>::iterator enResult = results.end();
 
-		return retVal;
+		while( itResult != enResult )
+		{
+			const size_t numGlyphs = itResult->glyphs.size();
+			for( size_t i = 0u; i < numGlyphs; ++i )
+			{
+				CachedGlyph &newGlyph = itResult->glyphs[i];
+				const uint8_t *bitmap = newGlyph.getSizeBytes() > 0u
+											? &itResult->bitmaps[itResult->bitmapStarts[i]]
+											: 0;
+				addGlyph( newGlyph, newGlyph.font, bitmap );
+			}
+			++itResult;
+		}
 	}
 	//-------------------------------------------------------------------------
-	void ShaperManager::addRefCount( const CachedGlyph *cachedGlyph )
+	bool ShaperManager::saveGlyphCache( const char *filePath )
 	{
-		const GlyphKey glyphKey( cachedGlyph->codepoint, cachedGlyph->ptSize, cachedGlyph->font );
+		// Cache entries identify fonts by index, files identify them by contents
+		std::map<uint16_t, uint64_t> fontHashes;
+		{
+			ShaperVec::const_iterator itor = m_shapers.begin();
+			ShaperVec::const_iterator endt = m_shapers.end();
 
-		COLIBRI_ASSERT_MEDIUM( m_glyphCache.find( glyphKey ) != m_glyphCache.end() &&
-							   "Invalid glyph cache entry. Use-after-free perhaps?" );
+			while( itor != endt )
+			{
+				// Glyphs of fonts we can't identify by contents aren't saved
+				const uint64_t fontHash = ( *itor )->getFontFileHash();
+				if( fontHash != 0u )
+					fontHashes[( *itor )->getFontIdx()] = fontHash;
+				++itor;
+			}
+		}
 
-		CachedGlyph *nonConstCachedGlyph = const_cast<CachedGlyph*>( cachedGlyph );
-		++nonConstCachedGlyph->refCount;
-	}
-	//-------------------------------------------------------------------------
-	void ShaperManager::releaseGlyph( uint32_t codepoint, uint32_t ptSize, uint16_t fontIdx )
-	{
-		const GlyphKey glyphKey( codepoint, ptSize, fontIdx );
+		std::vector<const CachedGlyph *> glyphs;
+		m_glyphCache.getAllGlyphs( glyphs );
 
-		CachedGlyphMap::iterator itor = m_glyphCache.find( glyphKey );
+		std::vector<GlyphCacheFileEntry> entries;
+		entries.reserve( glyphs.size() );
+		std::vector<uint8_t> bitmaps;
 
-		COLIBRI_ASSERT_LOW( itor != m_glyphCache.end() &&
-							"Invalid glyph cache entry not found. Use-after-free perhaps?" );
-		COLIBRI_ASSERT_LOW( itor->second.refCount > 0 );
+		std::vector<const CachedGlyph *>::const_iterator itor = glyphs.begin();
+		std::vector<const CachedGlyph *>::const_iterator endt = glyphs.end();
 
-		if( itor != m_glyphCache.end() && itor->second.refCount > 0 )
-			--itor->second.refCount;
-	}
-	//-------------------------------------------------------------------------
-	void ShaperManager::releaseGlyph( const CachedGlyph *cachedGlyph )
-	{
-		const GlyphKey glyphKey( cachedGlyph->codepoint, cachedGlyph->ptSize, cachedGlyph->font );
+		while( itor != endt )
+		{
+			const CachedGlyph *glyph = *itor;
+			std::map<uint16_t, uint64_t>::const_iterator itHash = fontHashes.find( glyph->font );
 
-		COLIBRI_ASSERT_MEDIUM( m_glyphCache.find( glyphKey ) != m_glyphCache.end() &&
-							   "Invalid glyph cache entry. Use-after-free perhaps?" );
-		COLIBRI_ASSERT_LOW( cachedGlyph->refCount > 0 );
+			// Glyphs rendered by BmpFonts don't have pixels in our atlas
+			if( itHash != fontHashes.end() && !glyph->isCodepointInPrivateArea() )
+			{
+				GlyphCacheFileEntry entry;
+				memset( &entry, 0, sizeof( entry ) );
+				entry.fontHash = itHash->second;
+				entry.ptSize = glyph->ptSize;
+				entry.dpi = m_dpi;
+				entry.renderMode = getGlyphRenderMode();
+				entry.glyphIdx = glyph->codepoint;
+				entry.bearingX = glyph->bearingX;
+				entry.bearingY = glyph->bearingY;
+				entry.newlineSize = glyph->newlineSize;
+				entry.regionUp = glyph->regionUp;
+				entry.width = glyph->width;
+				entry.height = glyph->height;
+				entry.bitmapStart = static_cast<uint32_t>( bitmaps.size() );
+				entries.push_back( entry );
+
+				if( glyph->getSizeBytes() > 0u )
+				{
+					const uint8_t *bitmap =
+						m_atlasPages[glyph->getAtlasPage()].data + glyph->getOffsetInPage();
+					bitmaps.insert( bitmaps.end(), bitmap, bitmap + glyph->getSizeBytes() );
+				}
+			}
+			++itor;
+		}
 
-		CachedGlyph *nonConstCachedGlyph = const_cast<CachedGlyph*>( cachedGlyph );
-		if( nonConstCachedGlyph->refCount > 0 )
-			--nonConstCachedGlyph->refCount;
+		GlyphCacheFileHeader header;
+		header.magic = c_glyphCacheFileMagic;
+		header.version = c_glyphCacheFileVersion;
+		header.numGlyphs = static_cast<uint32_t>( entries.size() );
+		header.bitmapBytes = static_cast<uint32_t>( bitmaps.size() );
+
+		// The cache is written to & read from writable storage, never from the package
+		FILE *file = fopen( filePath, "wb" );
+		if( !file )
+		{
+			LogListener *log = getLogListener();
+			char tmpBuffer[512];
+			Ogre::LwString errorMsg( Ogre::LwString::FromEmptyPointer( tmpBuffer, sizeof(tmpBuffer) ) );
+
+			errorMsg.clear();
+			errorMsg.a( "[ShaperManager::saveGlyphCache] Could not open ", filePath, " for writing" );
+			log->log( errorMsg.c_str(), LogSeverity::Warning );
+			return false;
+		}
+
+		bool bSuccess = fwrite( &header, sizeof( header ), 1u, file ) == 1u;
+		if( bSuccess && !entries.empty() )
+		{
+			bSuccess = fwrite( &entries[0], sizeof( GlyphCacheFileEntry ), entries.size(), file ) ==
+					   entries.size();
+		}
+		if( bSuccess && !bitmaps.empty() )
+			bSuccess = fwrite( &bitmaps[0], 1u, bitmaps.size(), file ) == bitmaps.size();
+		bSuccess &= fclose( file ) == 0;
+
+		return bSuccess;
 	}
 	//-------------------------------------------------------------------------
-	void ShaperManager::flushReleasedGlyphs()
+	size_t ShaperManager::loadGlyphCache( const char *filePath )
 	{
-		CachedGlyphMap::iterator itor = m_glyphCache.begin();
-		CachedGlyphMap::iterator end  = m_glyphCache.end();
-
-		while( itor != end )
+		std::vector<uint8_t> fileData;
 		{
-			if( !itor->second.refCount )
+			FILE *file = fopen( filePath, "rb" );
+			if( !file )
+				return 0u;
+
+			fseek( file, 0, SEEK_END );
+			const long fileSize = ftell( file );
+			fseek( file, 0, SEEK_SET );
+
+			if( fileSize > 0 )
 			{
-				CachedGlyphMap::iterator toDelete = itor++;
-				destroyGlyph( toDelete );
+				fileData.resize( static_cast<size_t>( fileSize ) );
+				if( fread( &fileData[0], 1u, fileData.size(), file ) != fileData.size() )
+					fileData.clear();
 			}
-			else
+			fclose( file );
+		}
+
+		LogListener *log = getLogListener();
+		char tmpBuffer[512];
+		Ogre::LwString errorMsg( Ogre::LwString::FromEmptyPointer( tmpBuffer, sizeof(tmpBuffer) ) );
+
+		GlyphCacheFileHeader header;
+		if( fileData.size() >= sizeof( header ) )
+			memcpy( &header, &fileData[0], sizeof( header ) );
+
+		if( fileData.size() < sizeof( header ) || header.magic != c_glyphCacheFileMagic ||
+			header.version != c_glyphCacheFileVersion ||
+			fileData.size() != sizeof( header ) +
+									size_t( header.numGlyphs ) * sizeof( GlyphCacheFileEntry ) +
+									header.bitmapBytes )
+		{
+			errorMsg.clear();
+			errorMsg.a( "[ShaperManager::loadGlyphCache] Ignoring ", filePath,
+						". It's corrupt or from a different version" );
+			log->log( errorMsg.c_str(), LogSeverity::Warning );
+			return 0u;
+		}
+
+		std::map<uint64_t, uint16_t> fontIndices;
+		{
+			ShaperVec::const_iterator itor = m_shapers.begin();
+			ShaperVec::const_iterator endt = m_shapers.end();
+
+			while( itor != endt )
 			{
+				// Fonts we can't identify by contents don't get any glyphs from the file
+				const uint64_t fontHash = ( *itor )->getFontFileHash();
+				if( fontHash != 0u )
+					fontIndices[fontHash] = ( *itor )->getFontIdx();
 				++itor;
 			}
 		}
+
+		const uint8_t *entriesStart = &fileData[0] + sizeof( header );
+		const uint8_t *bitmaps =
+			entriesStart + size_t( header.numGlyphs ) * sizeof( GlyphCacheFileEntry );
+
+		size_t numLoaded = 0u;
+
+		for( size_t i = 0u; i < header.numGlyphs; ++i )
+		{
+			GlyphCacheFileEntry entry;
+			memcpy( &entry, entriesStart + i * sizeof( GlyphCacheFileEntry ), sizeof( entry ) );
+
+			std::map<uint64_t, uint16_t>::const_iterator itFont = fontIndices.find( entry.fontHash );
+
+			CachedGlyph newGlyph;
+			newGlyph.codepoint = entry.glyphIdx;
+			newGlyph.ptSize = entry.ptSize;
+			newGlyph.bearingX = entry.bearingX;
+			newGlyph.bearingY = entry.bearingY;
+			newGlyph.width = entry.width;
+			newGlyph.height = entry.height;
+			newGlyph.newlineSize = entry.newlineSize;
+			newGlyph.regionUp = entry.regionUp;
+
+			// Stale entries are skipped. They'll be rasterized when needed
+			if( itFont != fontIndices.end() && entry.dpi == m_dpi &&
+				entry.renderMode == getGlyphRenderMode() &&
+				size_t( entry.bitmapStart ) + newGlyph.getSizeBytes() <= header.bitmapBytes &&
+				!m_glyphCache.find( entry.glyphIdx, entry.ptSize, itFont->second ) )
+			{
+				addGlyph( newGlyph, itFont->second, bitmaps + entry.bitmapStart );
+				++numLoaded;
+			}
+		}
+
+		errorMsg.clear();
+		errorMsg.a( "[ShaperManager::loadGlyphCache] Loaded ", (uint32_t)numLoaded, " of ",
+					header.numGlyphs, " glyphs from ", filePath );
+		log->log( errorMsg.c_str(), LogSeverity::Info );
+
+		return numLoaded;
 	}
 	//-------------------------------------------------------------------------
 	TextHorizAlignment::TextHorizAlignment ShaperManager::renderString(
@@ -542,8 +1127,6 @@ namespace Colibri
 
 		UBiDiDirection retVal = UBIDI_NEUTRAL;
 
-		UnicodeString uStr( utf8Str, (int32_t)richText.length );
-
 		UBiDiLevel textHorizDir = m_defaultDirection;
 
 		switch( richText.readingDir )
@@ -555,23 +1138,51 @@ namespace Colibri
 		case HorizReadingDir::RTL:		textHorizDir = UBIDI_RTL;			break;
 		}
 
-		UErrorCode errorCode = U_ZERO_ERROR;
-		ubidi_setPara( m_bidi, uStr.getBuffer(), uStr.length(), textHorizDir, 0, &errorCode );
+		const bool bVertical =
+			( vertReadingDir == VertReadingDir::IfNeededTTB && m_useVerticalLayoutWhenAvailable ) ||
+			vertReadingDir == VertReadingDir::ForceTTB ||
+			vertReadingDir == VertReadingDir::ForceTTBLTR;
+
+		ShapingCacheKey cacheKey;
+		cacheKey.utf8Str = utf8Str;
+		cacheKey.length = richText.length;
+		cacheKey.ptSize = richText.ptSize.value26d6;
+		cacheKey.font = richText.font;
+		cacheKey.horizDir = textHorizDir;
+		cacheKey.vertical = bVertical;
 
-		if( colibri_unlikely( !U_SUCCESS(errorCode) ) )
+		const bool bUseShapingCache =
+			m_shapingCacheMaxEntries != 0u && richText.length <= c_shapingCacheMaxStringBytes;
+
+		if( bUseShapingCache )
 		{
-			LogListener *log = this->getLogListener();
-			char tmpBuffer[512];
-			Ogre::LwString errorMsg( Ogre::LwString::FromEmptyPointer( tmpBuffer, sizeof(tmpBuffer) ) );
+			const ShapingCacheEntry *entry = m_shapingCache.find( cacheKey );
+			if( entry )
+			{
+				++m_shapingCacheStats.numHits;
 
-			errorMsg.clear();
-			errorMsg.a( "[UBiDi error] Error analyzing text. Error code: ", errorCode,
-						" Desc: ", u_errorName( errorCode ), "\n[UBiDi error] String:" );
-			log->log( errorMsg.c_str(), LogSeverity::Warning );
-			log->log( utf8Str, LogSeverity::Warning );
-			return getDefaultTextDirection();
+				const size_t prevNumShapes = outShapes.size();
+				outShapes.insert( outShapes.end(), entry->shapes.begin(), entry->shapes.end() );
+
+				ShapedGlyphVec::iterator itor = outShapes.begin() + ptrdiff_t( prevNumShapes );
+				ShapedGlyphVec::iterator endt = outShapes.end();
+
+				while( itor != endt )
+				{
+					itor->richTextIdx = richTextIdx;
+					addRefCount( itor->glyph );
+					++itor;
+				}
+
+				bOutHasPrivateUse = entry->hasPrivateUse;
+				return entry->actualDir;
+			}
+
+			++m_shapingCacheStats.numMisses;
 		}
 
+		const size_t prevNumShapes = outShapes.size();
+
 		Shaper *shaper = 0;
 		if( colibri_unlikely( richText.font >= m_shapers.size() ) )
 		{
@@ -589,38 +1200,72 @@ namespace Colibri
 		else
 			shaper = m_shapers[richText.font];
 
-		UnicodeString uniStr( false, ubidi_getText( m_bidi ), ubidi_getLength( m_bidi ) );
-
-		const int32_t numBlocks = ubidi_countRuns( m_bidi, &errorCode );
-		for( int32_t i=0; i<numBlocks; ++i )
+		if( m_simpleTextFastPath && richText.length > 0u &&
+			( textHorizDir == UBIDI_LTR || textHorizDir == UBIDI_DEFAULT_LTR ) &&
+			isAscii( utf8Str, richText.length ) )
 		{
-			int32_t logicalStart, length;
-			UBiDiDirection dir = ubidi_getVisualRun( m_bidi, i, &logicalStart, &length );
+			// ASCII has no RTL characters, thus BiDi analysis would return a single LTR run.
+			// Skip it and widen to UTF-16 ourselves (which is trivial) instead of using ICU
+			m_utf16Scratch.resize( richText.length );
+			for( size_t i = 0u; i < richText.length; ++i )
+				m_utf16Scratch[i] = static_cast<uint8_t>( utf8Str[i] );
 
-			UnicodeString temp = uniStr.tempSubString( logicalStart, length );
+			shaper->setFontSize( richText.ptSize );
+			shaper->renderString( &m_utf16Scratch[0], richText.length,
+								  bVertical ? HB_DIRECTION_TTB : HB_DIRECTION_LTR, richTextIdx, 0u,
+								  outShapes, bOutHasPrivateUse, true );
+			retVal = UBIDI_LTR;
+		}
+		else
+		{
+			UnicodeString uStr( utf8Str, (int32_t)richText.length );
 
-			hb_direction_t hbDir = dir == UBIDI_LTR ? HB_DIRECTION_LTR : HB_DIRECTION_RTL;
+			UErrorCode errorCode = U_ZERO_ERROR;
+			ubidi_setPara( m_bidi, uStr.getBuffer(), uStr.length(), textHorizDir, 0, &errorCode );
 
-			if( (vertReadingDir == VertReadingDir::IfNeededTTB && m_useVerticalLayoutWhenAvailable) ||
-				vertReadingDir == VertReadingDir::ForceTTB ||
-				vertReadingDir == VertReadingDir::ForceTTBLTR )
+			if( colibri_unlikely( !U_SUCCESS(errorCode) ) )
 			{
-				hbDir = HB_DIRECTION_TTB;
+				LogListener *log = this->getLogListener();
+				char tmpBuffer[512];
+				Ogre::LwString errorMsg( Ogre::LwString::FromEmptyPointer( tmpBuffer, sizeof(tmpBuffer) ) );
+
+				errorMsg.clear();
+				errorMsg.a( "[UBiDi error] Error analyzing text. Error code: ", errorCode,
+							" Desc: ", u_errorName( errorCode ), "\n[UBiDi error] String:" );
+				log->log( errorMsg.c_str(), LogSeverity::Warning );
+				log->log( utf8Str, LogSeverity::Warning );
+				return getDefaultTextDirection();
 			}
 
-			if( retVal == UBIDI_NEUTRAL )
-				retVal = dir;
-			/*else if( retVal != dir )
-				retVal = UBIDI_MIXED;*/
+			UnicodeString uniStr( false, ubidi_getText( m_bidi ), ubidi_getLength( m_bidi ) );
+
+			const int32_t numBlocks = ubidi_countRuns( m_bidi, &errorCode );
+			for( int32_t i=0; i<numBlocks; ++i )
+			{
+				int32_t logicalStart, length;
+				UBiDiDirection dir = ubidi_getVisualRun( m_bidi, i, &logicalStart, &length );
+
+				UnicodeString temp = uniStr.tempSubString( logicalStart, length );
+
+				hb_direction_t hbDir = dir == UBIDI_LTR ? HB_DIRECTION_LTR : HB_DIRECTION_RTL;
+
+				if( bVertical )
+					hbDir = HB_DIRECTION_TTB;
+
+				if( retVal == UBIDI_NEUTRAL )
+					retVal = dir;
+				/*else if( retVal != dir )
+					retVal = UBIDI_MIXED;*/
 
 #if U_SIZEOF_WCHAR_T == 2
-			const uint16_t *utf16Str = reinterpret_cast<const uint16_t*>( temp.getBuffer() );
+				const uint16_t *utf16Str = reinterpret_cast<const uint16_t*>( temp.getBuffer() );
 #else
-			const uint16_t *utf16Str = temp.getBuffer();
+				const uint16_t *utf16Str = temp.getBuffer();
 #endif
-			shaper->setFontSize( richText.ptSize );
-			shaper->renderString( utf16Str, (size_t)temp.length(), hbDir, richTextIdx,
-								  (uint32_t)logicalStart, outShapes, bOutHasPrivateUse, true );
+				shaper->setFontSize( richText.ptSize );
+				shaper->renderString( utf16Str, (size_t)temp.length(), hbDir, richTextIdx,
+									  (uint32_t)logicalStart, outShapes, bOutHasPrivateUse, true );
+			}
 		}
 
 		TextHorizAlignment::TextHorizAlignment finalRetVal;
@@ -636,9 +1281,67 @@ namespace Colibri
 			break;
 		}
 
+		if( bUseShapingCache )
+		{
+			const ShapingCacheEntry *entry = m_shapingCache.insert(
+				cacheKey, outShapes.begin() + ptrdiff_t( prevNumShapes ), outShapes.end(),
+				finalRetVal, bOutHasPrivateUse );
+
+			// The entry holds its own reference to each glyph
+			ShapedGlyphVec::const_iterator itor = entry->shapes.begin();
+			ShapedGlyphVec::const_iterator endt = entry->shapes.end();
+
+			while( itor != endt )
+			{
+				addRefCount( itor->glyph );
+				++itor;
+			}
+
+			trimShapingCache( m_shapingCacheMaxEntries, m_shapingCacheMaxGlyphs );
+		}
+
 		return finalRetVal;
 	}
 	//-------------------------------------------------------------------------
+	void ShaperManager::trimShapingCache( size_t maxEntries, size_t maxGlyphs )
+	{
+		while( m_shapingCache.getNumEntries() > maxEntries ||
+			   m_shapingCache.getNumGlyphs() > maxGlyphs )
+		{
+			ShapingCacheEntry *entry = m_shapingCache.getLeastRecentlyUsed();
+
+			ShapedGlyphVec::const_iterator itor = entry->shapes.begin();
+			ShapedGlyphVec::const_iterator endt = entry->shapes.end();
+
+			while( itor != endt )
+			{
+				releaseGlyph( itor->glyph );
+				++itor;
+			}
+
+			m_shapingCache.erase( entry );
+		}
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::setShapingCacheLimits( size_t maxEntries, size_t maxGlyphs )
+	{
+		m_shapingCacheMaxEntries = maxEntries;
+		m_shapingCacheMaxGlyphs = maxGlyphs;
+		trimShapingCache( maxEntries, maxGlyphs );
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::clearShapingCache()
+	{
+		trimShapingCache( 0u, 0u );
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::setSimpleTextFastPath( bool bEnable )
+	{
+		m_simpleTextFastPath = bEnable;
+		// Results should be the same, but make sure profiling measures the new setting
+		clearShapingCache();
+	}
+	//-------------------------------------------------------------------------
 	TextHorizAlignment::TextHorizAlignment ShaperManager::getDefaultTextDirection() const
 	{
 		return (m_defaultDirection == UBIDI_DEFAULT_LTR || m_defaultDirection == UBIDI_LTR) ?
@@ -650,80 +1353,286 @@ namespace Colibri
 		return m_preferredVertReadingDir;
 	}
 	//-------------------------------------------------------------------------
+	void ShaperManager::mergeDirtyRanges( RangeVec &inOutRanges, size_t gapTolerance )
+	{
+		if( inOutRanges.size() <= 1u )
+			return;
+
+		std::sort( inOutRanges.begin(), inOutRanges.end() );
+
+		RangeVec::iterator merged = inOutRanges.begin();
+		RangeVec::const_iterator itor = inOutRanges.begin() + 1u;
+		RangeVec::const_iterator endt = inOutRanges.end();
+
+		while( itor != endt )
+		{
+			const size_t mergedEnd = merged->offset + merged->size;
+			if( itor->offset <= mergedEnd + gapTolerance )
+			{
+				merged->size = std::max( mergedEnd, itor->offset + itor->size ) - merged->offset;
+			}
+			else
+			{
+				++merged;
+				*merged = *itor;
+			}
+			++itor;
+		}
+
+		inOutRanges.erase( merged + 1u, inOutRanges.end() );
+	}
+	//-------------------------------------------------------------------------
 	void ShaperManager::updateGpuBuffers()
 	{
-		if( (!m_glyphAtlasBuffer ||
-			 m_atlasCapacity !=
-			 m_glyphAtlasBuffer->getTotalSizeBytes()) &&
-			m_atlasCapacity > 0u )
+		m_lastAtlasUploadStats = AtlasUploadStats();
+
+		size_t totalBytes = 0u;
+
+		const size_t numPages = m_atlasPages.size();
+		for( size_t i = 0u; i < numPages; ++i )
 		{
-			// Local buffer has changed (i.e. growAtlas was called). Realloc the GPU buffer.
-			if( m_glyphAtlasBuffer )
+			AtlasPage &page = m_atlasPages[i];
+			const size_t atlasCapacity = page.allocator.getCapacity();
+
+			if( !page.buffer || atlasCapacity != page.buffer->getTotalSizeBytes() )
 			{
+				// New page (or growLastAtlasPage was called). Create its GPU buffer.
+				if( page.buffer )
+					destroyAtlasBuffer( page.buffer );
+
 #if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
-				if( m_glyphAtlasBuffer->getBufferPackedType() != Ogre::BP_TYPE_TEX )
+				if( Ogre::HlmsColibri::needsReadOnlyBuffer(
+						m_hlms->getRenderSystem()->getCapabilities(), m_vaoManager ) )
 				{
-					m_vaoManager->destroyReadOnlyBuffer(
-						static_cast<Ogre::ReadOnlyBufferPacked *>( m_glyphAtlasBuffer ) );
+					page.buffer = m_vaoManager->createReadOnlyBuffer(
+						Ogre::PFG_R8_UNORM, atlasCapacity, Ogre::BT_DEFAULT, 0, false );
 				}
 				else
 #endif
 				{
-					m_vaoManager->destroyTexBuffer(
-						static_cast<Ogre::TexBufferPacked *>( m_glyphAtlasBuffer ) );
+					page.buffer = m_vaoManager->createTexBuffer( Ogre::PFG_R8_UNORM, atlasCapacity,
+																 Ogre::BT_DEFAULT, 0, false );
 				}
+				m_hlms->setGlyphAtlasBuffer( i, page.buffer );
+
+				// The 1st byte is taken. We use this byte to render arbitrary fixed-colour
+				// stuff without having to switch shaders and would complicate rendering.
+				// It's mostly used for the background colour by Label.
+				page.data[0] = 0xff;
+
+				// Upload everything
+				Range fullRange;
+				fullRange.offset = 0u;
+				fullRange.size = page.allocator.getUsedEnd();
+				page.dirtyRanges.clear();
+				page.dirtyRanges.push_back( fullRange );
 			}
 
-#if OGRE_VERSION >= OGRE_MAKE_VERSION( 2, 3, 0 )
-			if( Ogre::HlmsColibri::needsReadOnlyBuffer( m_hlms->getRenderSystem()->getCapabilities(),
-														m_vaoManager ) )
+			m_lastAtlasUploadStats.numDirtyRanges += page.dirtyRanges.size();
+
+#ifdef OGRE_VK_WORKAROUND_PVR_ALIGNMENT
+			if( Ogre::Workarounds::mPowerVRAlignment )
 			{
-				m_glyphAtlasBuffer = m_vaoManager->createReadOnlyBuffer(
-					Ogre::PFG_R8_UNORM, m_atlasCapacity, Ogre::BT_DEFAULT, 0, false );
+				RangeVec::iterator itor = page.dirtyRanges.begin();
+				RangeVec::iterator endt = page.dirtyRanges.end();
+
+				while( itor != endt )
+				{
+					const size_t newOffset =
+						Ogre::alignToPreviousMult( itor->offset, Ogre::Workarounds::mPowerVRAlignment );
+					itor->size += itor->offset - newOffset;
+					itor->offset = newOffset;
+					++itor;
+				}
 			}
-			else
 #endif
+			mergeDirtyRanges( page.dirtyRanges, c_atlasUploadGapTolerance );
+
+			RangeVec::const_iterator itor = page.dirtyRanges.begin();
+			RangeVec::const_iterator endt = page.dirtyRanges.end();
+
+			while( itor != endt )
+			{
+				totalBytes += itor->size;
+				++itor;
+			}
+
+			m_lastAtlasUploadStats.numCopies += page.dirtyRanges.size();
+		}
+
+		if( totalBytes > 0u )
+		{
+			if( m_atlasStagingBuffer && m_atlasStagingBuffer->getMaxSize() < totalBytes )
 			{
-				m_glyphAtlasBuffer = m_vaoManager->createTexBuffer( Ogre::PFG_R8_UNORM, m_atlasCapacity,
-																	Ogre::BT_DEFAULT, 0, false );
+				m_atlasStagingBuffer->removeReferenceCount();
+				m_atlasStagingBuffer = 0;
 			}
-			m_hlms->setGlyphAtlasBuffer( m_glyphAtlasBuffer );
+			if( !m_atlasStagingBuffer )
+				m_atlasStagingBuffer = m_vaoManager->getStagingBuffer( totalBytes, true );
 
-			// The 1st byte is taken. We use this byte to render arbitrary fixed-colour
-			// stuff without having to switch shaders and would complicate rendering.
-			// It's mostly used for the background colour by Label.
-			m_glyphAtlas[0] = 0xff;
+			// Copy everything into the staging buffer, then issue all copies at once
+			uint8_t *stagingData =
+				reinterpret_cast<uint8_t *>( m_atlasStagingBuffer->map( totalBytes ) );
 
-			m_glyphAtlasBuffer->upload( m_glyphAtlas, 0, m_offsetPtr );
-			m_dirtyRanges.clear();
+			Ogre::StagingBuffer::DestinationVec destinations;
+			destinations.reserve( m_lastAtlasUploadStats.numCopies );
+
+			size_t srcOffset = 0u;
+			for( size_t i = 0u; i < numPages; ++i )
+			{
+				AtlasPage &page = m_atlasPages[i];
+
+				RangeVec::const_iterator itor = page.dirtyRanges.begin();
+				RangeVec::const_iterator endt = page.dirtyRanges.end();
+
+				while( itor != endt )
+				{
+					memcpy( stagingData + srcOffset, page.data + itor->offset, itor->size );
+					destinations.push_back( Ogre::StagingBuffer::Destination(
+						page.buffer, itor->offset, srcOffset, itor->size ) );
+					srcOffset += itor->size;
+					++itor;
+				}
+
+				page.dirtyRanges.clear();
+			}
+
+			m_atlasStagingBuffer->unmap( destinations );
 		}
-		else
+
+		m_lastAtlasUploadStats.numBytes = totalBytes;
+
+		m_totalAtlasUploadStats.numDirtyRanges += m_lastAtlasUploadStats.numDirtyRanges;
+		m_totalAtlasUploadStats.numCopies += m_lastAtlasUploadStats.numCopies;
+		m_totalAtlasUploadStats.numBytes += m_lastAtlasUploadStats.numBytes;
+	}
+	//-------------------------------------------------------------------------
+	size_t ShaperManager::compactAtlas( size_t maxBytes )
+	{
+		m_relocatedGlyphs.clear();
+
+		size_t bytesMoved = 0u;
+
+		while( bytesMoved < maxBytes && !m_atlasPages.empty() )
 		{
-			RangeVec::const_iterator itor = m_dirtyRanges.begin();
-			RangeVec::const_iterator endt = m_dirtyRanges.end();
+			const size_t srcPageIdx = m_atlasPages.size() - 1u;
+			AtlasPage &srcPage = m_atlasPages.back();
 
-			while( itor != endt )
+			if( srcPage.glyphsByOffset.empty() )
 			{
-				size_t offset = itor->offset;
-				size_t size = itor->size;
-#ifdef OGRE_VK_WORKAROUND_PVR_ALIGNMENT
-				if( Ogre::Workarounds::mPowerVRAlignment && offset > 0u )
+				// Page 0 is always kept
+				if( srcPageIdx == 0u )
+					break;
+				removeLastAtlasPage();
+				continue;
+			}
+
+			// The glyph at the very end of the last page
+			std::map<uint32_t, CachedGlyph *>::iterator lastGlyph = srcPage.glyphsByOffset.end();
+			--lastGlyph;
+			CachedGlyph *glyph = lastGlyph->second;
+			const size_t srcOffset = lastGlyph->first;
+			const size_t sizeBytes = glyph->getSizeBytes();
+
+			// Try to move it into an earlier page first, which will let us remove this one
+			size_t dstPageIdx = 0u;
+			size_t dstOffset = 0u;
+			bool bFound = false;
+			while( dstPageIdx < srcPageIdx && !bFound )
+			{
+				bFound = m_atlasPages[dstPageIdx].allocator.allocate( sizeBytes, dstOffset );
+				if( !bFound )
+					++dstPageIdx;
+			}
+
+			srcPage.glyphsByOffset.erase( lastGlyph );
+
+			if( bFound )
+			{
+				memcpy( m_atlasPages[dstPageIdx].data + dstOffset, srcPage.data + srcOffset,
+						sizeBytes );
+				srcPage.allocator.deallocate( srcOffset, sizeBytes );
+			}
+			else
+			{
+				// Try to move it closer to the beginning of its own page
+				srcPage.allocator.deallocate( srcOffset, sizeBytes );
+				srcPage.allocator.allocate( sizeBytes, dstOffset );
+				if( dstOffset >= srcOffset )
 				{
-					const size_t newOffset =
-						Ogre::alignToPreviousMult( offset, Ogre::Workarounds::mPowerVRAlignment );
-					size += offset - newOffset;
-					offset = newOffset;
+					// Can't go lower. The page is as compact as we can make it.
+					// The allocator is best fit, so it can only return the same spot
+					COLIBRI_ASSERT_MEDIUM( dstOffset == srcOffset );
+					srcPage.glyphsByOffset[static_cast<uint32_t>( srcOffset )] = glyph;
+					break;
 				}
-#endif
-				m_glyphAtlasBuffer->upload( m_glyphAtlas + offset, offset, size );
-				++itor;
+				// Regions may overlap if the glyph slid into a free block right before it
+				memmove( srcPage.data + dstOffset, srcPage.data + srcOffset, sizeBytes );
+				dstPageIdx = srcPageIdx;
 			}
 
-			m_dirtyRanges.clear();
+			AtlasPage &dstPage = m_atlasPages[dstPageIdx];
+			dstPage.glyphsByOffset[static_cast<uint32_t>( dstOffset )] = glyph;
+			glyph->offsetStart = static_cast<uint32_t>( ( dstPageIdx << 24u ) | dstOffset );
+
+			Range dirtyRange;
+			dirtyRange.offset = dstOffset;
+			dirtyRange.size = sizeBytes;
+			dstPage.dirtyRanges.push_back( dirtyRange );
+
+			m_relocatedGlyphs.push_back( glyph );
+			bytesMoved += sizeBytes;
+		}
+
+		if( !m_relocatedGlyphs.empty() )
+		{
+			std::sort( m_relocatedGlyphs.begin(), m_relocatedGlyphs.end() );
+			m_colibriManager->_notifyGlyphsRelocated( m_relocatedGlyphs );
 		}
+
+		return bytesMoved;
 	}
 	//-------------------------------------------------------------------------
-	void ShaperManager::prepareToRender() { m_hlms->setGlyphAtlasBuffer( m_glyphAtlasBuffer ); }
+	void ShaperManager::setAtlasCompactionBudget( size_t bytesPerFrame )
+	{
+		m_atlasCompactionBudget = bytesPerFrame;
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::setGlyphSdfReferenceSize( FontSize ptSize )
+	{
+		if( m_sdfReferenceSize == ptSize )
+			return;
+
+		// Existing glyphs were rasterized the other way
+		clearShapingCache();
+		flushReleasedGlyphs();
+		if( m_glyphCache.getNumGlyphs() != 0u )
+		{
+			LogListener *log = getLogListener();
+			log->log( "[ShaperManager::setGlyphSdfReferenceSize] Glyphs are in use. It must be "
+					  "called before creating Labels. Ignoring",
+					  LogSeverity::Error );
+			return;
+		}
+
+		m_sdfReferenceSize = ptSize;
+		if( m_hlms )
+			m_hlms->setGlyphSdf( ptSize.value26d6 != 0u );
+	}
+	//-------------------------------------------------------------------------
+	uint32_t ShaperManager::getGlyphRenderMode() const
+	{
+		if( m_sdfReferenceSize.value26d6 != 0u )
+			return 0x100u | static_cast<uint32_t>( c_glyphSdfSpread );
+		return FT_RENDER_MODE_NORMAL;
+	}
+	//-------------------------------------------------------------------------
+	void ShaperManager::prepareToRender()
+	{
+		const size_t numPages = m_atlasPages.size();
+		for( size_t i = 0u; i < Ogre::HlmsColibri::MaxGlyphAtlasPages; ++i )
+			m_hlms->setGlyphAtlasBuffer( i, i < numPages ? m_atlasPages[i].buffer : 0 );
+	}
 	//-------------------------------------------------------------------------
 	const char* ShaperManager::getErrorMessage( FT_Error errorCode )
 	{
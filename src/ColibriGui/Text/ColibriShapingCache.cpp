@@ -0,0 +1,181 @@
+
+#include "ColibriGui/Text/ColibriShapingCache.h"
+
+#include <string.h>
+
+namespace Colibri
+{
+	/// Initial number of buckets. Must be a power of 2
+	static const size_t c_initialNumBuckets = 256u;
+
+	ShapingCache::ShapingCache() :
+		m_numEntries( 0u ),
+		m_numGlyphs( 0u ),
+		m_lruFirst( 0 ),
+		m_lruLast( 0 )
+	{
+		m_buckets.resize( c_initialNumBuckets, 0 );
+	}
+	//-------------------------------------------------------------------------
+	ShapingCache::~ShapingCache()
+	{
+		COLIBRI_ASSERT_LOW( m_numEntries == 0u &&
+							"ShaperManager must release the glyphs of all entries first" );
+		while( m_lruFirst )
+			erase( m_lruFirst );
+	}
+	//-------------------------------------------------------------------------
+	uint64_t ShapingCache::hash( const ShapingCacheKey &key )
+	{
+		// FNV-1a
+		uint64_t retVal = 0xcbf29ce484222325ULL;
+		for( uint32_t i = 0u; i < key.length; ++i )
+		{
+			retVal ^= static_cast<uint8_t>( key.utf8Str[i] );
+			retVal *= 0x100000001b3ULL;
+		}
+
+		retVal ^= ( uint64_t( key.ptSize ) << 32u ) | ( uint64_t( key.font ) << 16u ) |
+				  ( uint64_t( key.horizDir ) << 1u ) | ( key.vertical ? 1u : 0u );
+		// Finalizer of MurmurHash3
+		retVal ^= retVal >> 33u;
+		retVal *= 0xff51afd7ed558ccdULL;
+		retVal ^= retVal >> 33u;
+		retVal *= 0xc4ceb9fe1a85ec53ULL;
+		retVal ^= retVal >> 33u;
+		return retVal;
+	}
+	//-------------------------------------------------------------------------
+	inline bool ShapingCache::equals( const ShapingCacheEntry &entry, const ShapingCacheKey &key,
+									  uint64_t keyHash )
+	{
+		return entry.hash == keyHash && entry.ptSize == key.ptSize && entry.font == key.font &&
+			   entry.horizDir == key.horizDir && entry.vertical == key.vertical &&
+			   entry.utf8Str.size() == key.length &&
+			   memcmp( entry.utf8Str.data(), key.utf8Str, key.length ) == 0;
+	}
+	//-------------------------------------------------------------------------
+	void ShapingCache::rehash( size_t newNumBuckets )
+	{
+		COLIBRI_ASSERT_LOW( ( newNumBuckets & ( newNumBuckets - 1u ) ) == 0u );
+
+		std::vector<ShapingCacheEntry *> oldBuckets;
+		oldBuckets.swap( m_buckets );
+		m_buckets.resize( newNumBuckets, 0 );
+
+		const size_t mask = newNumBuckets - 1u;
+
+		std::vector<ShapingCacheEntry *>::const_iterator itor = oldBuckets.begin();
+		std::vector<ShapingCacheEntry *>::const_iterator endt = oldBuckets.end();
+
+		while( itor != endt )
+		{
+			ShapingCacheEntry *entry = *itor;
+			while( entry )
+			{
+				ShapingCacheEntry *next = entry->nextInBucket;
+				ShapingCacheEntry *&bucket = m_buckets[entry->hash & mask];
+				entry->nextInBucket = bucket;
+				bucket = entry;
+				entry = next;
+			}
+			++itor;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void ShapingCache::lruPushBack( ShapingCacheEntry *entry )
+	{
+		entry->lruPrev = m_lruLast;
+		entry->lruNext = 0;
+		if( m_lruLast )
+			m_lruLast->lruNext = entry;
+		else
+			m_lruFirst = entry;
+		m_lruLast = entry;
+	}
+	//-------------------------------------------------------------------------
+	void ShapingCache::lruRemove( ShapingCacheEntry *entry )
+	{
+		if( entry->lruPrev )
+			entry->lruPrev->lruNext = entry->lruNext;
+		else
+			m_lruFirst = entry->lruNext;
+
+		if( entry->lruNext )
+			entry->lruNext->lruPrev = entry->lruPrev;
+		else
+			m_lruLast = entry->lruPrev;
+
+		entry->lruPrev = 0;
+		entry->lruNext = 0;
+	}
+	//-------------------------------------------------------------------------
+	ShapingCacheEntry *ShapingCache::find( const ShapingCacheKey &key )
+	{
+		const uint64_t keyHash = hash( key );
+
+		ShapingCacheEntry *entry = m_buckets[keyHash & ( m_buckets.size() - 1u )];
+		while( entry && !equals( *entry, key, keyHash ) )
+			entry = entry->nextInBucket;
+
+		if( entry && entry != m_lruLast )
+		{
+			lruRemove( entry );
+			lruPushBack( entry );
+		}
+
+		return entry;
+	}
+	//-------------------------------------------------------------------------
+	ShapingCacheEntry *ShapingCache::insert( const ShapingCacheKey &key,
+											 ShapedGlyphVec::const_iterator shapesBegin,
+											 ShapedGlyphVec::const_iterator shapesEnd,
+											 TextHorizAlignment::TextHorizAlignment actualDir,
+											 bool hasPrivateUse )
+	{
+		COLIBRI_ASSERT_MEDIUM( !find( key ) && "Entry already in cache" );
+
+		if( m_numEntries + 1u > m_buckets.size() )
+			rehash( m_buckets.size() << 1u );
+
+		ShapingCacheEntry *entry = new ShapingCacheEntry();
+		entry->utf8Str.assign( key.utf8Str, key.length );
+		entry->ptSize = key.ptSize;
+		entry->font = key.font;
+		entry->horizDir = key.horizDir;
+		entry->vertical = key.vertical;
+		entry->hash = hash( key );
+		entry->shapes.assign( shapesBegin, shapesEnd );
+		entry->actualDir = actualDir;
+		entry->hasPrivateUse = hasPrivateUse;
+
+		ShapingCacheEntry *&bucket = m_buckets[entry->hash & ( m_buckets.size() - 1u )];
+		entry->nextInBucket = bucket;
+		bucket = entry;
+
+		lruPushBack( entry );
+
+		++m_numEntries;
+		m_numGlyphs += entry->shapes.size();
+
+		return entry;
+	}
+	//-------------------------------------------------------------------------
+	void ShapingCache::erase( ShapingCacheEntry *entry )
+	{
+		ShapingCacheEntry **prev = &m_buckets[entry->hash & ( m_buckets.size() - 1u )];
+		while( *prev != entry )
+		{
+			COLIBRI_ASSERT_LOW( *prev && "Entry not in cache" );
+			prev = &( *prev )->nextInBucket;
+		}
+		*prev = entry->nextInBucket;
+
+		lruRemove( entry );
+
+		--m_numEntries;
+		m_numGlyphs -= entry->shapes.size();
+
+		delete entry;
+	}
+}  // namespace Colibri
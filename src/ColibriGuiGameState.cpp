@@ -23,6 +23,8 @@
 #include "SdlInputHandler.h"
 
 #include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "OgreTimer.h"
 
 #include "ColibriGui/ColibriManager.h"
 #include "ColibriGui/ColibriWindow.h"
@@ -33,11 +35,15 @@
 #include "ColibriGui/ColibriSpinner.h"
 #include "ColibriGui/ColibriProgressbar.h"
 #include "ColibriGui/ColibriSlider.h"
+#include "ColibriGui/ColibriSimd.h"
+#include "ColibriGui/Text/ColibriShaperManager.h"
 
 #include "ColibriGui/Layouts/ColibriLayoutLine.h"
 #include "ColibriGui/Layouts/ColibriLayoutMultiline.h"
 #include "ColibriGui/Layouts/ColibriLayoutTableSameSize.h"
 
+#include <string.h>
+
 using namespace Demo;
 
 namespace Demo
@@ -93,6 +99,191 @@ namespace Demo
 	};
 	DemoWidgetListener* demoActionListener;
 
+	/// Vertex fill benchmark (F6). See startFillBenchmark
+	Colibri::Window *fillBenchWindow = 0;
+	size_t fillBenchNumWidgets = 0u;
+	size_t fillBenchFrame = 0u;
+	uint64_t fillBenchTotalUs[2] = { 0u, 0u };
+	bool fillBenchPrevSimd = true;
+	/// Frames timed with the SIMD path, then with the scalar path
+	const size_t c_fillBenchFramesPerPath = 120u;
+
+	/// Creates a window full of buttons. updateFillBenchmark then makes it refill every frame,
+	/// first with the SIMD path then with the scalar one, and logs how long both took
+	static void startFillBenchmark()
+	{
+		if( fillBenchWindow )
+			return;
+
+		fillBenchWindow = colibriManager->createWindow( 0 );
+		fillBenchWindow->setSize( colibriManager->getCanvasSize() );
+
+		const size_t c_columns = 40u;
+		const size_t c_rows = 50u;
+		const Ogre::Vector2 cellSize = colibriManager->getCanvasSize() /
+									   Ogre::Vector2( Ogre::Real( c_columns ), Ogre::Real( c_rows ) );
+
+		for( size_t y = 0u; y < c_rows; ++y )
+		{
+			for( size_t x = 0u; x < c_columns; ++x )
+			{
+				Colibri::Button *button =
+					colibriManager->createWidget<Colibri::Button>( fillBenchWindow );
+				button->setTransform( Ogre::Vector2( Ogre::Real( x ), Ogre::Real( y ) ) * cellSize,
+									  cellSize );
+				button->getLabel()->setText( std::to_string( y * c_columns + x ) );
+			}
+		}
+
+		fillBenchNumWidgets = c_columns * c_rows;
+		fillBenchFrame = 0u;
+		fillBenchTotalUs[0] = 0u;
+		fillBenchTotalUs[1] = 0u;
+		fillBenchPrevSimd = colibriManager->getSimdVertexFill();
+	}
+
+	static void updateFillBenchmark()
+	{
+		// getLastVertexFillMicroseconds is from the previous frame's prepareRenderCommands.
+		// The first fill with each path is discarded, because all windows were filled
+		if( fillBenchFrame > 0u )
+		{
+			const size_t fillIdx = fillBenchFrame - 1u;
+			if( fillIdx % c_fillBenchFramesPerPath != 0u )
+			{
+				fillBenchTotalUs[fillIdx / c_fillBenchFramesPerPath] +=
+					colibriManager->getLastVertexFillMicroseconds();
+			}
+		}
+
+		if( fillBenchFrame == c_fillBenchFramesPerPath * 2u )
+		{
+			const Ogre::Real numSamples = Ogre::Real( c_fillBenchFramesPerPath - 1u );
+			const Ogre::Real simdUs = Ogre::Real( fillBenchTotalUs[0] ) / numSamples;
+			const Ogre::Real scalarUs = Ogre::Real( fillBenchTotalUs[1] ) / numSamples;
+
+			Ogre::LogManager &logManager = Ogre::LogManager::getSingleton();
+			logManager.logMessage(
+				"[Fill benchmark] " + std::to_string( fillBenchNumWidgets ) +
+				" buttons. SIMD: " + Ogre::StringConverter::toString( simdUs, 4u ) +
+				" us per fill. Scalar: " + Ogre::StringConverter::toString( scalarUs, 4u ) +
+				" us per fill. Speedup: " +
+				Ogre::StringConverter::toString( scalarUs / simdUs, 3u ) + "x" );
+#ifndef COLIBRI_SIMD
+			logManager.logMessage( "[Fill benchmark] Built without SIMD. Both ran the scalar path" );
+#endif
+
+			colibriManager->setSimdVertexFill( fillBenchPrevSimd );
+			colibriManager->destroyWindow( fillBenchWindow );
+			fillBenchWindow = 0;
+			return;
+		}
+
+		colibriManager->setSimdVertexFill( fillBenchFrame < c_fillBenchFramesPerPath );
+		fillBenchWindow->_setVisualsDirty();
+		++fillBenchFrame;
+	}
+
+	/// Shaping benchmark (F7). Typical ASCII UI strings, see startShapingBenchmark
+	static const char *const c_shapingBenchStrings[] = {
+		"OK",
+		"Cancel",
+		"Options",
+		"Loading...",
+		"Volume: 100%",
+		"Press any key to continue",
+		"Player 1 - Score: 1234567",
+		"The quick brown fox jumps over the lazy dog",
+		"Are you sure you want to quit? Unsaved progress will be lost.",
+		"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor",
+	};
+	const size_t c_numShapingBenchStrings =
+		sizeof( c_shapingBenchStrings ) / sizeof( c_shapingBenchStrings[0] );
+	/// Times each string is shaped with each path
+	const size_t c_shapingBenchIterations = 500u;
+
+	/// Shapes all of c_shapingBenchStrings numIterations times, the same way Label does.
+	/// Returns how long it took in microseconds
+	static uint64_t shapeBenchmarkStrings( size_t numIterations )
+	{
+		Colibri::ShaperManager *shaperManager = colibriManager->getShaperManager();
+
+		Colibri::RichText richText;
+		richText.ptSize = colibriManager->getDefaultFontSize26d6();
+		richText.offset = 0u;
+		richText.length = 0u;
+		richText.readingDir = Colibri::HorizReadingDir::Default;
+		richText.rgba32 = 0xFFFFFFFFu;
+		richText.backgroundRgba32 = 0u;
+		richText.font = 0u;
+		richText.noBackground = true;
+		richText.glyphStart = richText.glyphEnd = 0u;
+
+		Colibri::ShapedGlyphVec shapes;
+		bool bHasPrivateUse = false;
+
+		Ogre::Timer timer;
+		for( size_t i = 0u; i < numIterations; ++i )
+		{
+			for( size_t j = 0u; j < c_numShapingBenchStrings; ++j )
+			{
+				richText.length = static_cast<uint32_t>( strlen( c_shapingBenchStrings[j] ) );
+				shaperManager->renderString( c_shapingBenchStrings[j], richText, 0u,
+											 Colibri::VertReadingDir::Disabled, shapes,
+											 bHasPrivateUse );
+
+				// Glyphs stay in the glyph cache (unreferenced) so the next iteration
+				// doesn't rasterize them again
+				Colibri::ShapedGlyphVec::const_iterator itor = shapes.begin();
+				Colibri::ShapedGlyphVec::const_iterator endt = shapes.end();
+				while( itor != endt )
+				{
+					shaperManager->releaseGlyph( itor->glyph );
+					++itor;
+				}
+				shapes.clear();
+			}
+		}
+		return timer.getMicroseconds();
+	}
+
+	/// Shapes c_shapingBenchStrings with ShaperManager::setSimpleTextFastPath enabled and
+	/// then disabled, and logs the cost per label. The shaping cache is turned off meanwhile,
+	/// otherwise we would only be measuring cache hits
+	static void startShapingBenchmark()
+	{
+		Colibri::ShaperManager *shaperManager = colibriManager->getShaperManager();
+
+		const bool prevFastPath = shaperManager->getSimpleTextFastPath();
+		const size_t prevCacheMaxEntries = shaperManager->getShapingCacheMaxEntries();
+		const size_t prevCacheMaxGlyphs = shaperManager->getShapingCacheMaxGlyphs();
+		shaperManager->setShapingCacheLimits( 0u, prevCacheMaxGlyphs );
+
+		uint64_t totalUs[2];
+		for( size_t i = 0u; i < 2u; ++i )
+		{
+			shaperManager->setSimpleTextFastPath( i == 0u );
+			// Warm up (glyph rasterization, scratch buffers, etc)
+			shapeBenchmarkStrings( 1u );
+			totalUs[i] = shapeBenchmarkStrings( c_shapingBenchIterations );
+		}
+
+		shaperManager->setSimpleTextFastPath( prevFastPath );
+		shaperManager->setShapingCacheLimits( prevCacheMaxEntries, prevCacheMaxGlyphs );
+
+		const Ogre::Real numLabels = Ogre::Real( c_numShapingBenchStrings * c_shapingBenchIterations );
+		const Ogre::Real fastUs = Ogre::Real( totalUs[0] ) / numLabels;
+		const Ogre::Real slowUs = Ogre::Real( totalUs[1] ) / numLabels;
+
+		Ogre::LogManager::getSingleton().logMessage(
+			"[Shaping benchmark] " + std::to_string( c_numShapingBenchStrings ) + " ASCII labels x " +
+			std::to_string( c_shapingBenchIterations ) +
+			". Fast path: " + Ogre::StringConverter::toString( fastUs, 4u ) +
+			" us per label. BiDi + ICU: " + Ogre::StringConverter::toString( slowUs, 4u ) +
+			" us per label. Speedup: " + Ogre::StringConverter::toString( slowUs / fastUs, 3u ) +
+			"x" );
+	}
+
 	ColibriGuiGameState::ColibriGuiGameState( const Ogre::String &helpDescription ) :
 		TutorialGameState( helpDescription )
 	{
@@ -451,6 +642,11 @@ namespace Demo
 		colibriManager->destroyWindow( vertWindow );
 		colibriManager->destroyWindow( overlapWindow1 );
 		colibriManager->destroyWindow( overlapWindow2 );
+		if( fillBenchWindow )
+		{
+			colibriManager->destroyWindow( fillBenchWindow );
+			fillBenchWindow = 0;
+		}
 		delete demoActionListener;
 		delete colibriManager;
 	}
@@ -469,6 +665,9 @@ namespace Demo
 
 		colibriManager->update( timeSinceLast );
 
+		if( fillBenchWindow )
+			updateFillBenchmark();
+
 		const bool isTextInputActive = SDL_IsTextInputActive();
 
 		if( colibriManager->focusedWantsTextInput() && !isTextInputActive )
@@ -598,6 +797,11 @@ namespace Demo
 			return;
 		}
 
+		if( arg.keysym.sym == SDLK_F6 )
+			startFillBenchmark();
+		else if( arg.keysym.sym == SDLK_F7 )
+			startShapingBenchmark();
+
 		const bool isTextInputActive = SDL_IsTextInputActive();
 		const bool isTextMultiline = colibriManager->isTextMultiline();
 